@@ -1,4 +1,4 @@
-QT       += core gui sql
+QT       += core gui sql concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -12,25 +12,67 @@ INCLUDEPATH += "C:\Program Files\MySQL\MySQL Server 8.0\include"
 LIBS += -L"C:\Program Files\MySQL\MySQL Server 8.0\lib" -llibmysql
 
 SOURCES += \
+    attendance.cpp \
+    attendancewidget.cpp \
     basewindow.cpp \
     configmanager.cpp \
+    coursetreemodel.cpp \
     database.cpp \
+    degreeaudit.cpp \
+    dimensioncache.cpp \
+    enrollmentcube.cpp \
+    examscheduler.cpp \
+    gradeanalytics.cpp \
+    gradebookwidget.cpp \
+    jobscheduler.cpp \
+    jobswidget.cpp \
     main.cpp \
     mainwindow.cpp \
+    pivotwidget.cpp \
+    prerequisitegraph.cpp \
+    rankingservice.cpp \
+    scheduler.cpp \
+    searchindex.cpp \
     user.cpp \
     logindialog.cpp \
+    statisticswidget.cpp \
     studentwindow.cpp \
-    teacherwindow.cpp
+    tablesorter.cpp \
+    teacherwindow.cpp \
+    timetable.cpp \
+    transaction.cpp \
+    waitlist.cpp
 
 HEADERS += \
+    attendance.h \
+    attendancewidget.h \
     basewindow.h \
     configmanager.h \
+    coursetreemodel.h \
     database.h \
+    degreeaudit.h \
+    dimensioncache.h \
+    enrollmentcube.h \
+    examscheduler.h \
+    gradeanalytics.h \
+    gradebookwidget.h \
+    jobscheduler.h \
+    jobswidget.h \
     mainwindow.h \
+    pivotwidget.h \
+    prerequisitegraph.h \
+    rankingservice.h \
+    scheduler.h \
+    searchindex.h \
     user.h \
     logindialog.h \
+    statisticswidget.h \
     studentwindow.h \
-    teacherwindow.h
+    tablesorter.h \
+    teacherwindow.h \
+    timetable.h \
+    transaction.h \
+    waitlist.h
 
 FORMS += \
     logindialog.ui
@@ -0,0 +1,394 @@
+#include "attendance.h"
+#include "database.h"
+#include "transaction.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QtEndian>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+const int kSessionBatch = 200;      // 每条 INSERT 的课次数
+const int kStatsBatch = 1000;       // 每条汇总 upsert 的行数
+
+QByteArray encodeStudents(const std::vector<int>& students)
+{
+    QByteArray bytes(static_cast<int>(students.size() * sizeof(qint32)), Qt::Uninitialized);
+    for (size_t i = 0; i < students.size(); i++) {
+        qToLittleEndian<qint32>(students[i], bytes.data() + i * sizeof(qint32));
+    }
+    return bytes;
+}
+
+std::vector<int> decodeStudents(const QByteArray& bytes)
+{
+    std::vector<int> students(bytes.size() / sizeof(qint32));
+    for (size_t i = 0; i < students.size(); i++) {
+        students[i] = qFromLittleEndian<qint32>(bytes.constData() + i * sizeof(qint32));
+    }
+    return students;
+}
+
+inline bool testBit(const QByteArray& bits, size_t i)
+{
+    const int byte = static_cast<int>(i >> 3);
+    return byte < bits.size() && (static_cast<uchar>(bits[byte]) >> (i & 7)) & 1;
+}
+
+// 考勤的分区学期：已有考勤时取名单上记录的学期（课程之后改了学期也不变），否则取课程当前学期
+int semesterOf(QSqlQuery& query, int courseId)
+{
+    query.prepare("SELECT COALESCE("
+                  "(SELECT semester_id FROM attendance_rosters WHERE course_id = ? "
+                  " AND semester_id IS NOT NULL ORDER BY version LIMIT 1), "
+                  "(SELECT semester_id FROM courses WHERE course_id = ?), 0)");
+    query.addBindValue(courseId);
+    query.addBindValue(courseId);
+    return query.exec() && query.next() ? query.value(0).toInt() : 0;
+}
+
+struct Delta {
+    int sessions = 0;
+    int expected = 0;
+    int absences = 0;
+    int lates = 0;
+    bool isZero() const { return sessions == 0 && expected == 0 && absences == 0 && lates == 0; }
+};
+
+QVariant attendanceRate(int sessions, int absences)
+{
+    return sessions > 0 ? QVariant(qRound((sessions - absences) * 1000.0 / sessions) / 10.0) : QVariant();
+}
+
+} // namespace
+
+AttendanceStore& AttendanceStore::getInstance()
+{
+    static AttendanceStore instance;
+    return instance;
+}
+
+QList<QMap<QString, QVariant>> AttendanceStore::roster(int courseId)
+{
+    // 成绩册查询已按学号升序列出选课学生
+    return Database::getInstance().getCourseGradebook(courseId);
+}
+
+int AttendanceStore::nextSessionNo(int courseId)
+{
+    QSqlQuery query(Database::getInstance().connection());
+    const int semesterId = semesterOf(query, courseId);
+    query.prepare("SELECT COALESCE(MAX(session_no), 0) + 1 FROM attendance_sessions "
+                  "WHERE semester_id = ? AND course_id = ?");
+    query.addBindValue(semesterId);
+    query.addBindValue(courseId);
+    return query.exec() && query.next() ? query.value(0).toInt() : 1;
+}
+
+const std::vector<int>* AttendanceStore::rosterVersion(int courseId, int version)
+{
+    auto it = m_versions.constFind(key(courseId, version));
+    if (it != m_versions.constEnd()) return &it.value();
+
+    QSqlQuery query(Database::getInstance().connection());
+    query.prepare("SELECT students FROM attendance_rosters WHERE course_id = ? AND version = ?");
+    query.addBindValue(courseId);
+    query.addBindValue(version);
+    if (!query.exec() || !query.next()) {
+        qWarning() << "载入考勤名单失败: 课程" << courseId << "版本" << version;
+        return nullptr;
+    }
+    return &m_versions.insert(key(courseId, version), decodeStudents(query.value(0).toByteArray())).value();
+}
+
+int AttendanceStore::resolveRoster(int courseId, int semesterId, const std::vector<int>& students, bool& ok)
+{
+    // 最新版本号在事务内加锁读取，其他客户端同时写入同一课程时排队，不会撞主键
+    QSqlQuery query(Database::getInstance().connection());
+    query.prepare("SELECT MAX(version) FROM attendance_rosters WHERE course_id = ? FOR UPDATE");
+    query.addBindValue(courseId);
+    if (!query.exec() || !query.next()) {
+        ok = false;
+        return 0;
+    }
+    const int latest = query.value(0).toInt();
+
+    // 退选、加选之间的课次共用同一份名单，只在名单变化时新增版本
+    if (latest > 0) {
+        const std::vector<int>* current = rosterVersion(courseId, latest);
+        if (!current) {
+            ok = false;
+            return 0;
+        }
+        if (*current == students) return latest;
+    }
+
+    query.prepare("INSERT INTO attendance_rosters (course_id, version, semester_id, student_count, students) "
+                  "VALUES (?, ?, ?, ?, ?)");
+    query.addBindValue(courseId);
+    query.addBindValue(latest + 1);
+    query.addBindValue(semesterId);
+    query.addBindValue(static_cast<int>(students.size()));
+    query.addBindValue(encodeStudents(students));
+    if (!query.exec()) {
+        qWarning() << "保存考勤名单失败:" << query.lastError().text();
+        ok = false;
+        return 0;
+    }
+    m_versions.insert(key(courseId, latest + 1), students);
+    return latest + 1;
+}
+
+AttendanceStore::Session AttendanceStore::loadSession(int courseId, int sessionNo)
+{
+    Session session;
+    session.courseId = courseId;
+    session.sessionNo = sessionNo;
+
+    QSqlQuery query(Database::getInstance().connection());
+    const int semesterId = semesterOf(query, courseId);
+    query.prepare("SELECT roster_version, session_date, absent, late FROM attendance_sessions "
+                  "WHERE semester_id = ? AND course_id = ? AND session_no = ?");
+    query.addBindValue(semesterId);
+    query.addBindValue(courseId);
+    query.addBindValue(sessionNo);
+    if (!query.exec() || !query.next()) return session;
+
+    const int version = query.value(0).toInt();
+    session.date = query.value(1).toDate();
+    const QByteArray absent = query.value(2).toByteArray();
+    const QByteArray late = query.value(3).toByteArray();
+
+    const std::vector<int>* students = rosterVersion(courseId, version);
+    if (!students) return session;
+    session.students = *students;
+    session.statuses.resize(students->size());
+    for (size_t i = 0; i < students->size(); i++) {
+        session.statuses[i] = testBit(absent, i) ? Absent : testBit(late, i) ? Late : Present;
+    }
+    return session;
+}
+
+bool AttendanceStore::recordSessions(const QList<Session>& input, int recordedBy)
+{
+    if (input.isEmpty()) return true;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 同一批中重复的课次以最后一次为准
+    QList<Session> sessions;
+    QHash<quint64, int> positions;
+    for (const Session& session : input) {
+        const quint64 sessionKey = key(session.courseId, session.sessionNo);
+        if (positions.contains(sessionKey)) {
+            sessions[positions.value(sessionKey)] = session;
+        } else {
+            positions.insert(sessionKey, sessions.size());
+            sessions << session;
+        }
+    }
+
+    QSqlDatabase db = Database::getInstance().connection();
+    QSqlQuery query(db);
+
+    QHash<int, int> semesters;
+    for (const Session& session : sessions) {
+        if (!semesters.contains(session.courseId)) {
+            semesters.insert(session.courseId, semesterOf(query, session.courseId));
+        }
+    }
+
+    QHash<quint64, Delta> studentDeltas;    // (课程, 学号)
+    QHash<int, Delta> courseDeltas;
+
+    Transaction transaction;
+    auto fail = [&](const QString& what) {
+        qWarning() << what << query.lastError().text();
+        transaction.rollback();
+        // 回滚后缓存的名单版本可能并未写入
+        m_versions.clear();
+        return false;
+    };
+
+    // 覆盖已记录的课次：先按旧记录减去其对汇总的贡献
+    QStringList keys;
+    for (const Session& session : sessions) {
+        keys << QString("(%1,%2,%3)").arg(semesters.value(session.courseId))
+                    .arg(session.courseId).arg(session.sessionNo);
+    }
+    if (!query.exec("SELECT course_id, roster_version, absent, late FROM attendance_sessions "
+                    "WHERE (semester_id, course_id, session_no) IN (" + keys.join(",") + ") FOR UPDATE")) {
+        return fail("读取已有考勤失败:");
+    }
+    struct Previous { int courseId; int version; QByteArray absent; QByteArray late; };
+    QList<Previous> previous;
+    while (query.next()) {
+        previous.append({query.value(0).toInt(), query.value(1).toInt(),
+                         query.value(2).toByteArray(), query.value(3).toByteArray()});
+    }
+    for (const Previous& old : previous) {
+        const std::vector<int>* students = rosterVersion(old.courseId, old.version);
+        if (!students) return fail("载入旧考勤名单失败:");
+        Delta& course = courseDeltas[old.courseId];
+        course.sessions--;
+        course.expected -= static_cast<int>(students->size());
+        for (size_t i = 0; i < students->size(); i++) {
+            Delta& delta = studentDeltas[key(old.courseId, (*students)[i])];
+            delta.sessions--;
+            if (testBit(old.absent, i)) { delta.absences--; course.absences--; }
+            else if (testBit(old.late, i)) { delta.lates--; course.lates--; }
+        }
+    }
+
+    struct Encoded { int version; QByteArray absent; QByteArray late; int absentCount; int lateCount; };
+    std::vector<Encoded> encoded;
+    encoded.reserve(sessions.size());
+    for (const Session& session : sessions) {
+        bool ok = true;
+        const int version = resolveRoster(session.courseId, semesters.value(session.courseId),
+                                          session.students, ok);
+        if (!ok) return fail("保存考勤名单失败:");
+
+        const int n = static_cast<int>(session.students.size());
+        Encoded bits{version, QByteArray((n + 7) / 8, 0), QByteArray((n + 7) / 8, 0), 0, 0};
+        Delta& course = courseDeltas[session.courseId];
+        course.sessions++;
+        course.expected += n;
+        for (int i = 0; i < n; i++) {
+            Delta& delta = studentDeltas[key(session.courseId, session.students[i])];
+            delta.sessions++;
+            const char status = i < static_cast<int>(session.statuses.size()) ? session.statuses[i] : Present;
+            if (status == Absent) {
+                bits.absent[i >> 3] = static_cast<char>(bits.absent[i >> 3] | (1 << (i & 7)));
+                bits.absentCount++;
+                delta.absences++;
+                course.absences++;
+            } else if (status == Late) {
+                bits.late[i >> 3] = static_cast<char>(bits.late[i >> 3] | (1 << (i & 7)));
+                bits.lateCount++;
+                delta.lates++;
+                course.lates++;
+            }
+        }
+        encoded.push_back(bits);
+    }
+
+    for (int start = 0; start < sessions.size(); start += kSessionBatch) {
+        const int end = qMin(static_cast<int>(sessions.size()), start + kSessionBatch);
+        QStringList rows;
+        for (int i = start; i < end; i++) rows << "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+        query.prepare("INSERT INTO attendance_sessions (semester_id, course_id, session_no, session_date, "
+                      "roster_version, absent, late, absent_count, late_count, recorded_by) VALUES "
+                      + rows.join(", ") +
+                      " ON DUPLICATE KEY UPDATE session_date = VALUES(session_date), "
+                      "roster_version = VALUES(roster_version), absent = VALUES(absent), "
+                      "late = VALUES(late), absent_count = VALUES(absent_count), "
+                      "late_count = VALUES(late_count), recorded_by = VALUES(recorded_by), "
+                      "recorded_at = CURRENT_TIMESTAMP");
+        for (int i = start; i < end; i++) {
+            const Session& session = sessions[i];
+            const Encoded& bits = encoded[i];
+            query.addBindValue(semesters.value(session.courseId));
+            query.addBindValue(session.courseId);
+            query.addBindValue(session.sessionNo);
+            query.addBindValue(session.date.isValid() ? session.date : QDate::currentDate());
+            query.addBindValue(bits.version);
+            query.addBindValue(bits.absent);
+            query.addBindValue(bits.late);
+            query.addBindValue(bits.absentCount);
+            query.addBindValue(bits.lateCount);
+            query.addBindValue(recordedBy > 0 ? QVariant(recordedBy) : QVariant());
+        }
+        if (!query.exec()) return fail("写入考勤失败:");
+    }
+
+    // 汇总全是整数增量，拼成多行 upsert
+    QStringList rows;
+    auto flushStudents = [&]() {
+        if (rows.isEmpty()) return true;
+        const bool ok = query.exec("INSERT INTO attendance_stats (course_id, student_id, sessions, absences, lates) "
+                                   "VALUES " + rows.join(",") +
+                                   " ON DUPLICATE KEY UPDATE sessions = sessions + VALUES(sessions), "
+                                   "absences = absences + VALUES(absences), lates = lates + VALUES(lates)");
+        rows.clear();
+        return ok;
+    };
+    for (auto it = studentDeltas.constBegin(); it != studentDeltas.constEnd(); ++it) {
+        if (it.value().isZero()) continue;
+        rows << QString("(%1,%2,%3,%4,%5)").arg(static_cast<int>(it.key() >> 32))
+                    .arg(static_cast<int>(it.key() & 0xffffffffu))
+                    .arg(it.value().sessions).arg(it.value().absences).arg(it.value().lates);
+        if (rows.size() >= kStatsBatch && !flushStudents()) return fail("更新学生考勤汇总失败:");
+    }
+    if (!flushStudents()) return fail("更新学生考勤汇总失败:");
+
+    for (auto it = courseDeltas.constBegin(); it != courseDeltas.constEnd(); ++it) {
+        if (it.value().isZero()) continue;
+        rows << QString("(%1,%2,%3,%4,%5)").arg(it.key()).arg(it.value().sessions)
+                    .arg(it.value().expected).arg(it.value().absences).arg(it.value().lates);
+    }
+    if (!rows.isEmpty()
+        && !query.exec("INSERT INTO attendance_course_stats (course_id, sessions, expected, absences, lates) "
+                       "VALUES " + rows.join(",") +
+                       " ON DUPLICATE KEY UPDATE sessions = sessions + VALUES(sessions), "
+                       "expected = expected + VALUES(expected), "
+                       "absences = absences + VALUES(absences), lates = lates + VALUES(lates)")) {
+        return fail("更新课程考勤汇总失败:");
+    }
+
+    if (!transaction.commit()) {
+        qWarning() << "提交考勤事务失败:" << transaction.lastError().text();
+        m_versions.clear();
+        return false;
+    }
+    qDebug() << "考勤写入: 课次" << sessions.size() << "汇总" << studentDeltas.size()
+             << "行, 耗时" << timer.elapsed() << "毫秒";
+    return true;
+}
+
+QMap<int, QMap<QString, QVariant>> AttendanceStore::studentStats(int courseId)
+{
+    QMap<int, QMap<QString, QVariant>> stats;
+    QSqlQuery query(Database::getInstance().connection());
+    query.prepare("SELECT student_id, sessions, absences, lates FROM attendance_stats "
+                  "WHERE course_id = ?");
+    query.addBindValue(courseId);
+    if (!query.exec()) {
+        qWarning() << "载入考勤汇总失败:" << query.lastError().text();
+        return stats;
+    }
+    while (query.next()) {
+        const int sessions = query.value(1).toInt();
+        const int absences = query.value(2).toInt();
+        QMap<QString, QVariant> row;
+        row["student_id"] = query.value(0);
+        row["sessions"] = sessions;
+        row["absences"] = absences;
+        row["lates"] = query.value(3);
+        row["rate"] = attendanceRate(sessions, absences);
+        stats.insert(query.value(0).toInt(), row);
+    }
+    return stats;
+}
+
+QMap<QString, QVariant> AttendanceStore::courseStats(int courseId)
+{
+    QMap<QString, QVariant> row;
+    QSqlQuery query(Database::getInstance().connection());
+    query.prepare("SELECT sessions, expected, absences, lates FROM attendance_course_stats "
+                  "WHERE course_id = ?");
+    query.addBindValue(courseId);
+    if (!query.exec() || !query.next()) return row;
+
+    const int expected = query.value(1).toInt();
+    const int absences = query.value(2).toInt();
+    row["sessions"] = query.value(0);
+    row["expected"] = expected;
+    row["absences"] = absences;
+    row["lates"] = query.value(3);
+    row["rate"] = attendanceRate(expected, absences);
+    return row;
+}
@@ -0,0 +1,61 @@
+#ifndef ATTENDANCE_H
+#define ATTENDANCE_H
+
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QVariant>
+#include <vector>
+
+// 课堂考勤存储：每个课次一行，按名单快照下标编码为缺勤/迟到两个位图，
+// 批量写入时在同一事务里增量更新学生和课程两级汇总，报表不扫描课次原始数据
+class AttendanceStore
+{
+public:
+    static AttendanceStore& getInstance();
+
+    enum Status : char { Present = 0, Late = 1, Absent = 2 };
+
+    struct Session {
+        int courseId = 0;
+        int sessionNo = 0;                  // 课程内从1开始的课次
+        QDate date;
+        std::vector<int> students;          // 点名名单，学号升序
+        std::vector<char> statuses;         // 与 students 一一对应
+    };
+
+    // 当前选课学生（student_id, student_name, ...），学号升序
+    QList<QMap<QString, QVariant>> roster(int courseId);
+    int nextSessionNo(int courseId);
+    // 已记录课次按名单展开；不存在时 students 为空
+    Session loadSession(int courseId, int sessionNo);
+
+    // 一个事务写入全部课次，重复的课次覆盖旧记录并修正汇总；失败时整体回滚
+    bool recordSessions(const QList<Session>& sessions, int recordedBy);
+
+    // 学生汇总：student_id, sessions, absences, lates, rate（出勤率，迟到计为出勤）
+    QMap<int, QMap<QString, QVariant>> studentStats(int courseId);
+    // 课程汇总：sessions, expected, absences, lates, rate
+    QMap<QString, QVariant> courseStats(int courseId);
+
+private:
+    AttendanceStore() = default;
+    AttendanceStore(const AttendanceStore&) = delete;
+    AttendanceStore& operator=(const AttendanceStore&) = delete;
+
+    // 名单快照按 (课程, 版本) 缓存；版本一经写入不再修改
+    const std::vector<int>* rosterVersion(int courseId, int version);
+    // 返回与 students 相同的最新名单版本，名单有变化时新增版本（记下考勤所在学期）；须在事务内调用
+    int resolveRoster(int courseId, int semesterId, const std::vector<int>& students, bool& ok);
+
+    static quint64 key(int courseId, int other)
+    {
+        return (static_cast<quint64>(static_cast<quint32>(courseId)) << 32) |
+               static_cast<quint32>(other);
+    }
+
+    QHash<quint64, std::vector<int>> m_versions;        // (课程, 版本) → 名单
+};
+
+#endif // ATTENDANCE_H
@@ -0,0 +1,269 @@
+#include "attendancewidget.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QSplitter>
+#include <QHeaderView>
+#include <QMessageBox>
+
+namespace {
+const int kStatusColumn = 2;
+const int kRateColumn = 3;
+
+QString statusText(char status)
+{
+    switch (status) {
+    case AttendanceStore::Late: return "迟到";
+    case AttendanceStore::Absent: return "缺勤";
+    default: return "出勤";
+    }
+}
+
+QColor statusColor(char status)
+{
+    switch (status) {
+    case AttendanceStore::Late: return QColor(255, 243, 205);
+    case AttendanceStore::Absent: return QColor(248, 215, 218);
+    default: return QColor();
+    }
+}
+}
+
+AttendanceWidget::AttendanceWidget(int teacherId, QWidget *parent)
+    : QWidget(parent)
+    , m_teacherId(teacherId)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    QLabel *titleLabel = new QLabel("课堂点名");
+    titleLabel->setAlignment(Qt::AlignCenter);
+    titleLabel->setStyleSheet("font-size: 14px; font-weight: bold;");
+    layout->addWidget(titleLabel);
+
+    QSplitter *splitter = new QSplitter(Qt::Horizontal);
+
+    courseList = new QListWidget();
+    courseList->setMaximumWidth(260);
+    splitter->addWidget(courseList);
+
+    QWidget *rollPanel = new QWidget();
+    QVBoxLayout *rollLayout = new QVBoxLayout(rollPanel);
+    rollLayout->setContentsMargins(0, 0, 0, 0);
+
+    QHBoxLayout *sessionLayout = new QHBoxLayout();
+    sessionLayout->addWidget(new QLabel("课次:"));
+    sessionSpin = new QSpinBox();
+    sessionSpin->setRange(1, 999);
+    sessionLayout->addWidget(sessionSpin);
+    sessionLayout->addWidget(new QLabel("日期:"));
+    dateEdit = new QDateEdit(QDate::currentDate());
+    dateEdit->setCalendarPopup(true);
+    sessionLayout->addWidget(dateEdit);
+    QPushButton *loadButton = new QPushButton("载入该课次");
+    QPushButton *allPresentButton = new QPushButton("全部出勤");
+    sessionLayout->addWidget(loadButton);
+    sessionLayout->addWidget(allPresentButton);
+    sessionLayout->addStretch();
+    rollLayout->addLayout(sessionLayout);
+
+    rollTable = new QTableWidget();
+    rollTable->setColumnCount(4);
+    rollTable->setHorizontalHeaderLabels({"学生学号", "学生姓名", "状态", "出勤率"});
+    rollTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    rollTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    rollTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    rollLayout->addWidget(rollTable);
+
+    summaryLabel = new QLabel();
+    rollLayout->addWidget(summaryLabel);
+
+    splitter->addWidget(rollPanel);
+    splitter->setStretchFactor(1, 1);
+    layout->addWidget(splitter);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    queueButton = new QPushButton("记录本课次");
+    submitButton = new QPushButton("提交考勤");
+    submitButton->setStyleSheet("background-color: #228B22; color: white; padding: 5px;");
+    buttonLayout->addWidget(queueButton);
+    buttonLayout->addWidget(submitButton);
+    buttonLayout->addStretch();
+    statusLabel = new QLabel();
+    buttonLayout->addWidget(statusLabel);
+    layout->addLayout(buttonLayout);
+
+    connect(courseList, &QListWidget::currentRowChanged, this, &AttendanceWidget::onCourseSelected);
+    connect(loadButton, &QPushButton::clicked, this, &AttendanceWidget::onLoadSession);
+    connect(allPresentButton, &QPushButton::clicked, this, &AttendanceWidget::onAllPresent);
+    connect(rollTable, &QTableWidget::itemClicked, this, &AttendanceWidget::onStatusClicked);
+    connect(queueButton, &QPushButton::clicked, this, &AttendanceWidget::onQueue);
+    connect(submitButton, &QPushButton::clicked, this, &AttendanceWidget::onSubmit);
+
+    updateStatus();
+}
+
+void AttendanceWidget::setCourses(const QList<QMap<QString, QVariant>>& teachings)
+{
+    const int previousCourseId = m_currentCourseId;
+
+    courseList->blockSignals(true);
+    courseList->clear();
+    int selectRow = -1;
+    for (const auto& teaching : teachings) {
+        const int courseId = teaching["course_id"].toInt();
+        QListWidgetItem *item = new QListWidgetItem(
+            QString("%1（%2）").arg(teaching["course_name"].toString(),
+                                   teaching["semester"].toString()));
+        item->setData(Qt::UserRole, courseId);
+        courseList->addItem(item);
+        if (courseId == previousCourseId) {
+            selectRow = courseList->count() - 1;
+        }
+    }
+    courseList->blockSignals(false);
+
+    m_currentCourseId = 0;
+    rollTable->setRowCount(0);
+    if (selectRow >= 0) {
+        courseList->setCurrentRow(selectRow);
+    }
+}
+
+void AttendanceWidget::onCourseSelected()
+{
+    QListWidgetItem *item = courseList->currentItem();
+    if (!item) return;
+    m_currentCourseId = item->data(Qt::UserRole).toInt();
+
+    // 新课次：当前选课名单，默认全部出勤
+    AttendanceStore& store = AttendanceStore::getInstance();
+    AttendanceStore::Session session;
+    session.courseId = m_currentCourseId;
+    for (const auto& student : store.roster(m_currentCourseId)) {
+        session.students.push_back(student["student_id"].toInt());
+    }
+    session.statuses.assign(session.students.size(), AttendanceStore::Present);
+
+    int next = store.nextSessionNo(m_currentCourseId);
+    for (const auto& pending : m_pending) {
+        if (pending.courseId == m_currentCourseId) next = qMax(next, pending.sessionNo + 1);
+    }
+    sessionSpin->setValue(next);
+    dateEdit->setDate(QDate::currentDate());
+    showRoster(session);
+}
+
+void AttendanceWidget::onLoadSession()
+{
+    if (m_currentCourseId == 0) return;
+
+    const AttendanceStore::Session session =
+        AttendanceStore::getInstance().loadSession(m_currentCourseId, sessionSpin->value());
+    if (session.students.empty()) {
+        QMessageBox::information(this, "载入课次", "该课次尚未记录考勤");
+        return;
+    }
+    dateEdit->setDate(session.date);
+    showRoster(session);
+}
+
+void AttendanceWidget::showRoster(const AttendanceStore::Session& session)
+{
+    AttendanceStore& store = AttendanceStore::getInstance();
+    QHash<int, QString> names;
+    for (const auto& student : store.roster(m_currentCourseId)) {
+        names.insert(student["student_id"].toInt(), student["student_name"].toString());
+    }
+    const auto stats = store.studentStats(m_currentCourseId);
+
+    m_students = session.students;
+    m_statuses = session.statuses;
+
+    rollTable->setUpdatesEnabled(false);
+    rollTable->setRowCount(static_cast<int>(m_students.size()));
+    for (int row = 0; row < static_cast<int>(m_students.size()); row++) {
+        const int studentId = m_students[row];
+        rollTable->setItem(row, 0, new QTableWidgetItem(QString::number(studentId)));
+        // 历史课次的名单中可能有已退选的学生
+        rollTable->setItem(row, 1, new QTableWidgetItem(names.value(studentId, "（已退选）")));
+        rollTable->setItem(row, kStatusColumn, new QTableWidgetItem());
+        const QVariant rate = stats.value(studentId).value("rate");
+        rollTable->setItem(row, kRateColumn, new QTableWidgetItem(
+            rate.isNull() ? QString("-") : QString("%1%").arg(rate.toDouble(), 0, 'f', 1)));
+        setRowStatus(row, m_statuses[row]);
+    }
+    rollTable->setUpdatesEnabled(true);
+
+    const QMap<QString, QVariant> course = store.courseStats(m_currentCourseId);
+    summaryLabel->setText(course.isEmpty()
+        ? QString("尚无考勤记录")
+        : QString("已记录 %1 次课，出勤率 %2%，缺勤 %3 人次，迟到 %4 人次")
+              .arg(course["sessions"].toInt()).arg(course["rate"].toDouble(), 0, 'f', 1)
+              .arg(course["absences"].toInt()).arg(course["lates"].toInt()));
+}
+
+void AttendanceWidget::setRowStatus(int row, char status)
+{
+    m_statuses[row] = status;
+    QTableWidgetItem *item = rollTable->item(row, kStatusColumn);
+    item->setText(statusText(status));
+    item->setBackground(statusColor(status));
+}
+
+void AttendanceWidget::onStatusClicked(QTableWidgetItem *item)
+{
+    if (item->column() != kStatusColumn) return;
+    const int row = item->row();
+    setRowStatus(row, static_cast<char>((m_statuses[row] + 1) % 3));
+}
+
+void AttendanceWidget::onAllPresent()
+{
+    for (int row = 0; row < static_cast<int>(m_statuses.size()); row++) {
+        setRowStatus(row, AttendanceStore::Present);
+    }
+}
+
+void AttendanceWidget::onQueue()
+{
+    if (m_currentCourseId == 0 || m_students.empty()) {
+        QMessageBox::warning(this, "课堂点名", "请先选择有学生的课程");
+        return;
+    }
+
+    AttendanceStore::Session session;
+    session.courseId = m_currentCourseId;
+    session.sessionNo = sessionSpin->value();
+    session.date = dateEdit->date();
+    session.students = m_students;
+    session.statuses = m_statuses;
+    m_pending << session;
+
+    // 接着点下一课次
+    sessionSpin->setValue(session.sessionNo + 1);
+    onAllPresent();
+    updateStatus();
+}
+
+void AttendanceWidget::onSubmit()
+{
+    if (m_pending.isEmpty()) return;
+
+    if (!AttendanceStore::getInstance().recordSessions(m_pending, m_teacherId)) {
+        QMessageBox::warning(this, "提交失败", "考勤提交失败，已记录的课次保留在待提交队列中");
+        return;
+    }
+    const int submitted = m_pending.size();
+    m_pending.clear();
+    updateStatus();
+    if (m_currentCourseId != 0) {
+        onCourseSelected();
+    }
+    QMessageBox::information(this, "提交成功", QString("已提交 %1 个课次的考勤").arg(submitted));
+}
+
+void AttendanceWidget::updateStatus()
+{
+    submitButton->setEnabled(!m_pending.isEmpty());
+    statusLabel->setText(m_pending.isEmpty() ? QString("没有待提交的考勤")
+                                             : QString("待提交: %1 个课次").arg(m_pending.size()));
+}
@@ -0,0 +1,54 @@
+#ifndef ATTENDANCEWIDGET_H
+#define ATTENDANCEWIDGET_H
+
+#include "attendance.h"
+#include <QWidget>
+#include <QListWidget>
+#include <QTableWidget>
+#include <QPushButton>
+#include <QLabel>
+#include <QSpinBox>
+#include <QDateEdit>
+
+// 教师课堂点名：选择课程和课次，点击状态列在 出勤/迟到/缺勤 间切换；
+// 点名结果先加入待提交队列，提交时所有课次一个事务批量写入
+class AttendanceWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit AttendanceWidget(int teacherId, QWidget *parent = nullptr);
+
+    // 教师授课列表（字段同 Database::getTeacherTeachings）
+    void setCourses(const QList<QMap<QString, QVariant>>& teachings);
+
+private slots:
+    void onCourseSelected();
+    void onLoadSession();
+    void onStatusClicked(QTableWidgetItem *item);
+    void onAllPresent();
+    void onQueue();
+    void onSubmit();
+
+private:
+    void showRoster(const AttendanceStore::Session& session);
+    void setRowStatus(int row, char status);
+    void updateStatus();
+
+    QListWidget *courseList;
+    QSpinBox *sessionSpin;
+    QDateEdit *dateEdit;
+    QTableWidget *rollTable;
+    QPushButton *queueButton;
+    QPushButton *submitButton;
+    QLabel *summaryLabel;
+    QLabel *statusLabel;
+
+    int m_teacherId;
+    int m_currentCourseId = 0;
+    std::vector<int> m_students;                        // 当前表格的名单
+    std::vector<char> m_statuses;
+    QList<AttendanceStore::Session> m_pending;
+};
+
+#endif // ATTENDANCEWIDGET_H
@@ -1,4 +1,5 @@
 #include "basewindow.h"
+#include "tablesorter.h"
 #include <QMessageBox>
 #include <QHeaderView>
 #include <QDebug>
@@ -109,6 +110,8 @@ void BaseWindow::setupTable(QTableWidget* table, const QStringList& headers)
     table->setAlternatingRowColors(true);
     table->setSelectionBehavior(QAbstractItemView::SelectRows);
     table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    // 点击表头排序（Shift+点击追加次要排序列）
+    TableSorter::attach(table);
 }
 
 void BaseWindow::loadTableData(QTableWidget* table, const QList<QMap<QString, QVariant>>& data)
@@ -0,0 +1,188 @@
+#include "coursetreemodel.h"
+#include "database.h"
+#include "dimensioncache.h"
+#include <QFont>
+
+CourseTreeModel::CourseTreeModel(Kind kind, QObject *parent)
+    : QAbstractItemModel(parent)
+    , m_kind(kind)
+{
+    if (kind == Kind::Teachings) {
+        m_columns = {
+            {"课程ID / 教师工号", "course_id", "teacher_id"},
+            {"课程名称 / 教师姓名", "course_name", "teacher_name"},
+            {"学期", "semester", ""},
+            {"上课时间", "", "class_time"},
+            {"教室", "", "classroom"},
+            {"授课教师", "children", ""},
+            {"选课人数", "enrolled", ""},
+            {"平均分", "avg_score", ""},
+        };
+    } else {
+        m_columns = {
+            {"课程ID / 学生学号", "course_id", "student_id"},
+            {"课程名称 / 学生姓名", "course_name", "student_name"},
+            {"学期", "semester", ""},
+            {"成绩", "", "score"},
+            {"选课人数", "enrolled", ""},
+            {"平均分", "avg_score", ""},
+        };
+    }
+}
+
+void CourseTreeModel::reload(int semesterId)
+{
+    Database& db = Database::getInstance();
+    setGroups(m_kind == Kind::Teachings ? db.getTeachingGroups(semesterId)
+                                        : db.getEnrollmentGroups(semesterId));
+}
+
+void CourseTreeModel::setGroups(const QList<QMap<QString, QVariant>>& groups)
+{
+    beginResetModel();
+    m_groups.clear();
+    m_groups.reserve(groups.size());
+    for (const auto& row : groups) {
+        Group group;
+        group.values = row;
+        group.expected = row["children"].toInt();
+        m_groups.append(group);
+    }
+    endResetModel();
+}
+
+QMap<QString, QVariant> CourseTreeModel::rowValues(const QModelIndex &index) const
+{
+    if (!index.isValid()) return {};
+    if (isGroup(index)) return m_groups[index.row()].values;
+
+    const Group& group = m_groups[static_cast<int>(index.internalId()) - 1];
+    QMap<QString, QVariant> values = group.children[index.row()];
+    values["course_id"] = group.values["course_id"];
+    return values;
+}
+
+QModelIndex CourseTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent)) return QModelIndex();
+    if (!parent.isValid()) return createIndex(row, column, quintptr(0));
+    if (isGroup(parent)) return createIndex(row, column, quintptr(parent.row() + 1));
+    return QModelIndex();
+}
+
+QModelIndex CourseTreeModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid() || child.internalId() == 0) return QModelIndex();
+    return createIndex(static_cast<int>(child.internalId()) - 1, 0, quintptr(0));
+}
+
+int CourseTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) return 0;
+    if (!parent.isValid()) return m_groups.size();
+    if (isGroup(parent)) return m_groups[parent.row()].children.size();
+    return 0;
+}
+
+int CourseTreeModel::columnCount(const QModelIndex &) const
+{
+    return m_columns.size();
+}
+
+bool CourseTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) return !m_groups.isEmpty();
+    if (!isGroup(parent) || parent.column() > 0) return false;
+
+    // 未展开过的课程按汇总中的子行数显示展开标记，不预先查询
+    const Group& group = m_groups[parent.row()];
+    return group.fetched ? !group.children.isEmpty() : group.expected > 0;
+}
+
+bool CourseTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    return isGroup(parent) && !m_groups[parent.row()].fetched;
+}
+
+void CourseTreeModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent)) return;
+
+    Group& group = m_groups[parent.row()];
+    group.fetched = true;
+
+    Database& db = Database::getInstance();
+    const int courseId = group.values["course_id"].toInt();
+    const bool narrow = db.isClientJoinEnabled();
+    QList<QMap<QString, QVariant>> rows;
+    if (m_kind == Kind::Teachings) {
+        rows = db.getCourseTeachings(courseId, narrow);
+        if (narrow) rows = DimensionCache::getInstance().joinTeachings(rows);
+    } else {
+        rows = db.getCourseEnrollments(courseId, narrow);
+        if (narrow) rows = DimensionCache::getInstance().joinEnrollments(rows);
+    }
+    if (rows.isEmpty()) return;
+
+    beginInsertRows(parent.sibling(parent.row(), 0), 0, rows.size() - 1);
+    group.children = rows;
+    endInsertRows();
+}
+
+QVariant CourseTreeModel::displayValue(const QMap<QString, QVariant>& row,
+                                       const QString& field) const
+{
+    if (field.isEmpty()) return QVariant();
+    const QVariant value = row.value(field);
+    if (field == "avg_score") {
+        return value.isNull() ? QString("-") : QString::number(value.toDouble(), 'f', 1);
+    }
+    return value.toString();
+}
+
+QVariant CourseTreeModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) return QVariant();
+    const Column& column = m_columns[index.column()];
+
+    if (isGroup(index)) {
+        const Group& group = m_groups[index.row()];
+        if (role == Qt::DisplayRole) return displayValue(group.values, column.groupField);
+        if (role == Qt::FontRole) {
+            QFont font;
+            font.setBold(true);
+            return font;
+        }
+        return QVariant();
+    }
+
+    if (role == Qt::DisplayRole) {
+        const Group& group = m_groups[static_cast<int>(index.internalId()) - 1];
+        return displayValue(group.children[index.row()], column.childField);
+    }
+    return QVariant();
+}
+
+QVariant CourseTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole
+        && section >= 0 && section < m_columns.size()) {
+        return m_columns[section].header;
+    }
+    return QVariant();
+}
+
+void GroupBandDelegate::initStyleOption(QStyleOptionViewItem *option,
+                                        const QModelIndex &index) const
+{
+    QStyledItemDelegate::initStyleOption(option, index);
+
+    // 模型自己给出背景时不覆盖
+    if (option->backgroundBrush.style() != Qt::NoBrush) return;
+
+    QModelIndex top = index;
+    while (top.parent().isValid()) top = top.parent();
+    if (top.row() % 2 == 1) {
+        option->backgroundBrush = option->palette.brush(QPalette::AlternateBase);
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef COURSETREEMODEL_H
+#define COURSETREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <QStyledItemDelegate>
+#include <QList>
+#include <QMap>
+#include <QStringList>
+#include <QVariant>
+
+// 授课/选课分组树：顶层每门课程（含学期）一行，带选课人数、平均分等汇总，
+// 子行（授课教师或选课学生）在展开时通过 fetchMore 按课程单独查询
+class CourseTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum class Kind { Teachings, Enrollments };
+
+    explicit CourseTreeModel(Kind kind, QObject *parent = nullptr);
+
+    // 重新查询分组汇总；已展开的子行全部丢弃
+    void reload(int semesterId = 0);
+    // 使用已取回的分组行（字段与 Database::getTeachingGroups()/getEnrollmentGroups() 一致）
+    void setGroups(const QList<QMap<QString, QVariant>>& groups);
+    // 课程行返回汇总字段，子行返回明细字段（补上所属课程的 course_id）
+    QMap<QString, QVariant> rowValues(const QModelIndex &index) const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+private:
+    struct Column {
+        QString header;
+        QString groupField;     // 课程行显示的字段，为空时留白
+        QString childField;     // 子行显示的字段
+    };
+
+    struct Group {
+        QMap<QString, QVariant> values;
+        int expected = 0;                           // 汇总中的子行数，用于未展开时显示展开标记
+        bool fetched = false;
+        QList<QMap<QString, QVariant>> children;
+    };
+
+    // 子行的 internalId 为所属课程行号+1，课程行为0
+    bool isGroup(const QModelIndex &index) const { return index.isValid() && index.internalId() == 0; }
+    QVariant displayValue(const QMap<QString, QVariant>& row, const QString& field) const;
+
+    Kind m_kind;
+    QList<Column> m_columns;
+    QList<Group> m_groups;
+};
+
+// 按顶层行号交替着色：同一课程的课程行和子行使用同一底色，
+// 在绘制时计算，不需要给每个单元格设置背景
+class GroupBandDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+
+protected:
+    void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const override;
+};
+
+#endif // COURSETREEMODEL_H
@@ -1,4 +1,6 @@
 #include "database.h"
+#include "transaction.h"
+#include "timetable.h"
 #include <QMessageBox>
 #include <QApplication>
 #include <QDebug>
@@ -7,6 +9,182 @@
 #include <QElapsedTimer>
 #include <QSettings>
 #include <QFileInfo>
+#include <QDate>
+#include <QRegularExpression>
+#include <QSet>
+#include <QThread>
+#include <QtConcurrent>
+#include <QThreadPool>
+#include <atomic>
+
+namespace {
+
+// 非主线程使用的数据库连接，随线程退出关闭并移除
+struct ThreadConnection {
+    QString name;
+    ~ThreadConnection()
+    {
+        if (name.isEmpty()) return;
+        {
+            QSqlDatabase db = QSqlDatabase::database(name, false);
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(name);
+    }
+};
+
+thread_local ThreadConnection t_threadConnection;
+std::atomic<int> g_threadConnectionSerial{0};
+
+} // namespace
+
+// 各窗口的查询语句集中在这里，普通查询和初始化存储过程共用同一份SQL
+namespace {
+
+const char* const kStudentsSql =
+    "SELECT student_id, name, age, credits, attempted_credits, gpa, row_version "
+    "FROM students ORDER BY student_id";
+
+const char* const kTeachersSql =
+    "SELECT teacher_id, name, age, row_version FROM teachers ORDER BY teacher_id";
+
+const char* const kCoursesSql =
+    "SELECT course_id, name, credit, semester, semester_id, capacity, enrolled_count, "
+    "row_version FROM courses ORDER BY course_id";
+
+const char* const kSemestersSql =
+    "SELECT semester_id, name, start_date, end_date, is_current "
+    "FROM semesters ORDER BY semester_id DESC";
+
+// 学期排序和过滤都走 courses.idx_semester_course 上的整数键 semester_id，
+// 带 %1 的语句由 semesterWhere() 填入学期过滤条件（可为空），明细语句填入课程条件
+
+// 表头顺序：{"教师工号", "教师姓名", "课程ID", "课程名称", "学期", "上课时间", "教室"}
+const char* const kTeachingsSql =
+    "SELECT "
+    "t.teacher_id, "           // 教师工号 - 列0
+    "te.name as teacher_name, " // 教师姓名 - 列1
+    "t.course_id, "            // 课程ID - 列2
+    "c.name as course_name, "  // 课程名称 - 列3
+    "c.semester, "             // 学期 - 列4
+    "t.class_time, "           // 上课时间 - 列5
+    "t.classroom "             // 教室 - 列6
+    "FROM teachings t "
+    "LEFT JOIN teachers te ON t.teacher_id = te.teacher_id "
+    "LEFT JOIN courses c ON t.course_id = c.course_id "
+    "%1 "
+    // 排序规则：先按照学期逆序，然后按照课程ID顺序，再按照教师ID顺序
+    "ORDER BY c.semester_id DESC, t.course_id ASC, t.teacher_id ASC";
+
+// 选课网格读取物化表 enrollment_view（由触发器增量维护），
+// 排序与 idx_view_semester 一致，一次索引范围扫描即可
+// 表头顺序：{"学生学号", "学生姓名", "课程ID", "课程名称", "学期", "成绩"}
+const char* const kEnrollmentsSql =
+    "SELECT "
+    "v.student_id, "           // 学生学号 - 列0
+    "v.student_name, "         // 学生姓名 - 列1
+    "v.course_id, "            // 课程ID - 列2
+    "v.course_name, "          // 课程名称 - 列3
+    "v.semester, "             // 学期 - 列4
+    "v.score "                 // 成绩 - 列5
+    "FROM enrollment_view v "
+    "%1 "
+    // 排序规则：先按照学期逆序，然后按照课程ID顺序，再按照学生ID顺序
+    "ORDER BY v.semester_id DESC, v.course_id ASC, v.student_id ASC";
+
+// 窄事实行：只含ID和事实字段，名称等由 DimensionCache 在本地关联
+const char* const kTeachingFactsSql =
+    "SELECT teacher_id, course_id, class_time, classroom FROM teachings %1";
+
+const char* const kEnrollmentFactsSql =
+    "SELECT student_id, course_id, score FROM enrollments %1";
+
+// 分组汇总都读 enrollment_cube（每门课程只有几个年龄段行），不扫描选课明细
+// children 为展开后的子行数，授课树为授课教师数，选课树为选课人数
+const char* const kTeachingGroupsSql =
+    "SELECT c.course_id, c.name as course_name, c.semester, c.semester_id, "
+    "t.teachers AS children, c.enrolled_count AS enrolled, "
+    "k.score_sum / NULLIF(k.scored, 0) AS avg_score "
+    "FROM (SELECT course_id, COUNT(*) AS teachers FROM teachings GROUP BY course_id) t "
+    "JOIN courses c ON c.course_id = t.course_id "
+    "LEFT JOIN (SELECT course_id, SUM(scored) AS scored, SUM(score_sum) AS score_sum "
+    "           FROM enrollment_cube GROUP BY course_id) k ON k.course_id = c.course_id "
+    "%1 "
+    "ORDER BY c.semester_id DESC, c.course_id";
+
+const char* const kEnrollmentGroupsSql =
+    "SELECT c.course_id, c.name as course_name, c.semester, c.semester_id, "
+    "SUM(k.enrollments) AS children, SUM(k.enrollments) AS enrolled, "
+    "SUM(k.score_sum) / NULLIF(SUM(k.scored), 0) AS avg_score "
+    "FROM enrollment_cube k "
+    "JOIN courses c ON c.course_id = k.course_id "
+    "%1 "
+    "GROUP BY c.course_id "
+    "HAVING children > 0 "
+    "ORDER BY c.semester_id DESC, c.course_id";
+
+// 学生选课列表：当前学期的课程（未设置当前学期时列出全部），%1 为学号
+const char* const kRegistrationCoursesSql =
+    "SELECT c.course_id, c.name as course_name, c.semester, c.credit, "
+    "c.capacity, c.enrolled_count, "
+    "(SELECT GROUP_CONCAT(te.name SEPARATOR ', ') FROM teachings t "
+    " JOIN teachers te ON t.teacher_id = te.teacher_id WHERE t.course_id = c.course_id) "
+    "AS teacher_name, "
+    "(SELECT GROUP_CONCAT(t.class_time SEPARATOR ', ') FROM teachings t "
+    " WHERE t.course_id = c.course_id) AS class_time, "
+    "e.score, (e.id IS NOT NULL) AS enrolled, (w.id IS NOT NULL) AS waitlisted "
+    "FROM courses c "
+    "LEFT JOIN enrollments e ON e.course_id = c.course_id AND e.student_id = %1 "
+    "LEFT JOIN waitlist w ON w.course_id = c.course_id AND w.student_id = %1 "
+    "WHERE c.semester_id = (SELECT semester_id FROM semesters WHERE is_current = 1 LIMIT 1) "
+    "   OR NOT EXISTS (SELECT 1 FROM semesters WHERE is_current = 1) "
+    "ORDER BY c.semester_id DESC, c.course_id";
+
+const char* const kUsersSql =
+    "SELECT user_id, account, password, role FROM users ORDER BY user_id";
+
+// 以下模板中的 %1 为教师工号/学生学号，存储过程里替换为参数名
+const char* const kTeacherInfoSql =
+    "SELECT teacher_id, name, age FROM teachers WHERE teacher_id = %1";
+
+const char* const kTeacherTeachingsSql =
+    "SELECT t.course_id, c.name as course_name, "
+    "c.semester, t.class_time, t.classroom "
+    "FROM teachings t "
+    "LEFT JOIN courses c ON t.course_id = c.course_id "
+    "WHERE t.teacher_id = %1 "
+    "ORDER BY c.semester_id DESC, t.course_id";
+
+// 成绩册按课程打开时才加载，%1 为课程ID，走 enrollment_view.idx_view_course 范围扫描
+const char* const kCourseGradebookSql =
+    "SELECT student_id, student_name, score "
+    "FROM enrollment_view "
+    "WHERE course_id = %1 "
+    "ORDER BY student_id";
+
+const char* const kStudentInfoSql =
+    "SELECT student_id, name, age, credits, attempted_credits, gpa "
+    "FROM students WHERE student_id = %1";
+
+const char* const kStudentEnrollmentsSql =
+    "SELECT e.course_id, c.semester_id, c.name as course_name, "
+    "te.name as teacher_name, c.semester, "
+    "t.class_time, t.classroom, c.credit, e.score "
+    "FROM enrollments e "
+    "LEFT JOIN courses c ON e.course_id = c.course_id "
+    "LEFT JOIN teachings t ON e.course_id = t.course_id "
+    "LEFT JOIN teachers te ON t.teacher_id = te.teacher_id "
+    "WHERE e.student_id = %1 "
+    "ORDER BY c.semester_id DESC, e.course_id";
+
+QString semesterWhere(int semesterId, const char* column = "c.semester_id")
+{
+    return semesterId > 0
+        ? QString("WHERE %1 = %2").arg(QString(column)).arg(semesterId)
+        : QString();
+}
+
+} // namespace
 
 Database::Database(QObject *parent) : QObject(parent)
 {
@@ -24,6 +202,19 @@ Database::Database(QObject *parent) : QObject(parent)
     m_username = "root";
     m_password = "123456";
     m_port = 3306;
+
+    // 经 Database 的写入都会发出以下信号之一，读缓存随之失效（直接调用，可能来自工作线程）
+    QSettings settings("TeachingSystem", "TeachingManager");
+    m_readCacheMs = settings.value("Performance/ReadCacheMs", 500).toInt();
+    m_readClock.start();
+    QObject::connect(this, &Database::recordChanged, this,
+                     [this]() { invalidateReadCache(); }, Qt::DirectConnection);
+    QObject::connect(this, &Database::enrollmentScoreChanged, this,
+                     [this]() { invalidateReadCache(); }, Qt::DirectConnection);
+    QObject::connect(this, &Database::enrollmentDataInvalidated, this,
+                     [this]() { invalidateReadCache(); }, Qt::DirectConnection);
+    QObject::connect(this, &Database::seatsReleased, this,
+                     [this]() { invalidateReadCache(); }, Qt::DirectConnection);
 }
 
 Database& Database::getInstance()
@@ -110,22 +301,49 @@ void Database::createTables()
         "student_id INT PRIMARY KEY, "
         "name VARCHAR(100) NOT NULL, "
         "age INT, "
-        "credits INT DEFAULT 0"
+        "program_id INT NULL, "                               // 所属专业，外键在 migrateSchema 中添加
+        // 学分/GPA汇总由 enrollments 上的触发器增量维护，见 sp_apply_enrollment_delta
+        "credits DECIMAL(6,1) NOT NULL DEFAULT 0, "           // 已获学分（及格课程）
+        "attempted_credits DECIMAL(6,1) NOT NULL DEFAULT 0, " // 已修学分（已评分课程）
+        "grade_points DECIMAL(8,2) NOT NULL DEFAULT 0, "      // Σ 学分 × 绩点
+        "gpa DECIMAL(4,3) AS (IF(attempted_credits > 0, "
+        "grade_points / attempted_credits, 0)) STORED, "
+        "row_version INT NOT NULL DEFAULT 0"                  // 可编辑字段变化时递增，见 *_row_version 触发器
         ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
 
         // 教师表
         "CREATE TABLE IF NOT EXISTS teachers ("
         "teacher_id INT PRIMARY KEY, "
         "name VARCHAR(100) NOT NULL, "
-        "age INT"
+        "age INT, "
+        "unavailable_time VARCHAR(255) NULL, "         // 不能排课的时间，格式同 teachings.class_time
+        "row_version INT NOT NULL DEFAULT 0"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        // 学期表 - 主键为整数排序键 year*10+term（如 2024-2025学年第1学期 = 20241）
+        "CREATE TABLE IF NOT EXISTS semesters ("
+        "semester_id INT PRIMARY KEY, "
+        "name VARCHAR(20) NOT NULL, "
+        "start_date DATE, "
+        "end_date DATE, "
+        "is_current TINYINT NOT NULL DEFAULT 0, "
+        "UNIQUE KEY uk_semester_name (name), "
+        "KEY idx_current (is_current)"
         ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
 
-        // 课程表
+        // 课程表 - semester 保留为显示名称，排序和过滤使用 semester_id
         "CREATE TABLE IF NOT EXISTS courses ("
         "course_id INT PRIMARY KEY, "
         "name VARCHAR(200) NOT NULL, "
         "credit DECIMAL(4,1), "
-        "semester VARCHAR(20)"
+        "semester VARCHAR(20), "
+        "semester_id INT NULL, "
+        "capacity INT NULL, "                          // 选课容量，NULL 表示不限
+        "enrolled_count INT NOT NULL DEFAULT 0, "      // 已选人数，由 enrollment_seat_* 触发器维护
+        "row_version INT NOT NULL DEFAULT 0, "
+        "KEY idx_semester_course (semester_id DESC, course_id), "
+        "CONSTRAINT fk_course_semester FOREIGN KEY (semester_id) "
+        "REFERENCES semesters(semester_id) ON DELETE SET NULL"
         ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
 
         // 授课表 - 添加自增主键
@@ -136,6 +354,7 @@ void Database::createTables()
         "class_time VARCHAR(50), "
         "classroom VARCHAR(50), "
         "UNIQUE KEY uk_teacher_course (teacher_id, course_id), "
+        "KEY idx_course_teacher (course_id, teacher_id), "
         "FOREIGN KEY (teacher_id) REFERENCES teachers(teacher_id) ON DELETE CASCADE, "
         "FOREIGN KEY (course_id) REFERENCES courses(course_id) ON DELETE CASCADE"
         ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
@@ -147,13 +366,193 @@ void Database::createTables()
         "course_id INT, "
         "score DECIMAL(4,1) DEFAULT 0, "
         "UNIQUE KEY uk_student_course (student_id, course_id), "
+        "KEY idx_course_student (course_id, student_id), "
         "FOREIGN KEY (student_id) REFERENCES students(student_id) ON DELETE CASCADE, "
         "FOREIGN KEY (course_id) REFERENCES courses(course_id) ON DELETE CASCADE"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        // 选课读模型 - enrollments × students × courses 的物化结果，由触发器增量维护
+        // idx_view_semester 对应管理员选课网格，idx_view_course 对应教师学生成绩页
+        "CREATE TABLE IF NOT EXISTS enrollment_view ("
+        "enrollment_id INT PRIMARY KEY, "
+        "student_id INT NOT NULL, "
+        "student_name VARCHAR(100), "
+        "course_id INT NOT NULL, "
+        "course_name VARCHAR(200), "
+        "semester VARCHAR(20), "
+        "semester_id INT, "
+        "score DECIMAL(4,1), "
+        "KEY idx_view_semester (semester_id DESC, course_id, student_id), "
+        "KEY idx_view_course (course_id, semester_id, student_id), "
+        "KEY idx_view_student (student_id)"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        // 教室表 - 自动排课用，capacity 为 NULL 表示不限
+        "CREATE TABLE IF NOT EXISTS classrooms ("
+        "classroom_id INT PRIMARY KEY AUTO_INCREMENT, "
+        "name VARCHAR(50) NOT NULL, "
+        "capacity INT NULL, "
+        "UNIQUE KEY uk_classroom_name (name)"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        // 期末考试安排 - 每门课程一个考试场次，按学期整体替换
+        "CREATE TABLE IF NOT EXISTS exam_schedule ("
+        "course_id INT PRIMARY KEY, "
+        "semester_id INT NULL, "
+        "slot INT NOT NULL, "
+        "KEY idx_exam_semester_slot (semester_id, slot), "
+        "CONSTRAINT fk_exam_course FOREIGN KEY (course_id) "
+        "REFERENCES courses(course_id) ON DELETE CASCADE"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        // 课程先修关系 - 环检测在 PrerequisiteGraph 中完成
+        "CREATE TABLE IF NOT EXISTS course_prerequisites ("
+        "course_id INT NOT NULL, "
+        "prerequisite_id INT NOT NULL, "
+        "PRIMARY KEY (course_id, prerequisite_id), "
+        "KEY idx_prerequisite (prerequisite_id), "
+        "CONSTRAINT fk_prereq_course FOREIGN KEY (course_id) "
+        "REFERENCES courses(course_id) ON DELETE CASCADE, "
+        "CONSTRAINT fk_prereq_prerequisite FOREIGN KEY (prerequisite_id) "
+        "REFERENCES courses(course_id) ON DELETE CASCADE"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        // 专业及培养要求 - 学位审核用
+        "CREATE TABLE IF NOT EXISTS programs ("
+        "program_id INT PRIMARY KEY AUTO_INCREMENT, "
+        "name VARCHAR(100) NOT NULL, "
+        "UNIQUE KEY uk_program_name (name)"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        // kind = credits：所列课程（未列时为全部课程）已获学分不少于 min_credits
+        // kind = courses：所列课程须全部通过
+        "CREATE TABLE IF NOT EXISTS degree_requirements ("
+        "requirement_id INT PRIMARY KEY AUTO_INCREMENT, "
+        "program_id INT NOT NULL, "
+        "name VARCHAR(100) NOT NULL, "
+        "kind ENUM('credits', 'courses') NOT NULL DEFAULT 'credits', "
+        "min_credits DECIMAL(5,1) NULL, "
+        "KEY idx_requirement_program (program_id), "
+        "CONSTRAINT fk_requirement_program FOREIGN KEY (program_id) "
+        "REFERENCES programs(program_id) ON DELETE CASCADE"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        "CREATE TABLE IF NOT EXISTS requirement_courses ("
+        "requirement_id INT NOT NULL, "
+        "course_id INT NOT NULL, "
+        "PRIMARY KEY (requirement_id, course_id), "
+        "CONSTRAINT fk_requirement_course_requirement FOREIGN KEY (requirement_id) "
+        "REFERENCES degree_requirements(requirement_id) ON DELETE CASCADE, "
+        "CONSTRAINT fk_requirement_course_course FOREIGN KEY (course_id) "
+        "REFERENCES courses(course_id) ON DELETE CASCADE"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        // 学位审核结果 - 由 DegreeAudit 整表或按学生替换，不加外键以便批量写入
+        "CREATE TABLE IF NOT EXISTS degree_audit ("
+        "student_id INT NOT NULL, "
+        "requirement_id INT NOT NULL, "
+        "satisfied TINYINT(1) NOT NULL, "
+        "earned DECIMAL(6,1) NOT NULL, "
+        "PRIMARY KEY (student_id, requirement_id), "
+        "KEY idx_audit_requirement (requirement_id, satisfied)"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        // 选课候补 - idx_waitlist_order 即递补顺序
+        "CREATE TABLE IF NOT EXISTS waitlist ("
+        "id BIGINT PRIMARY KEY AUTO_INCREMENT, "
+        "course_id INT NOT NULL, "
+        "student_id INT NOT NULL, "
+        "priority TINYINT NOT NULL DEFAULT 1, "        // 0 = 专业培养要求所列课程，1 = 其他
+        "requested_at TIMESTAMP(3) NOT NULL DEFAULT CURRENT_TIMESTAMP(3), "
+        "UNIQUE KEY uk_waitlist_course_student (course_id, student_id), "
+        "KEY idx_waitlist_order (course_id, priority, requested_at, id), "
+        "KEY idx_waitlist_student (student_id), "
+        "CONSTRAINT fk_waitlist_course FOREIGN KEY (course_id) "
+        "REFERENCES courses(course_id) ON DELETE CASCADE, "
+        "CONSTRAINT fk_waitlist_student FOREIGN KEY (student_id) "
+        "REFERENCES students(student_id) ON DELETE CASCADE"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        // 考勤名单快照 - 学号升序的 int32 数组，名单不变的课次共用同一版本
+        "CREATE TABLE IF NOT EXISTS attendance_rosters ("
+        "course_id INT NOT NULL, "
+        "version SMALLINT NOT NULL, "
+        "semester_id INT NULL, "                       // 课程首次记录考勤时的学期，之后的考勤固定在该分区
+        "student_count SMALLINT NOT NULL, "
+        "students MEDIUMBLOB NOT NULL, "
+        "PRIMARY KEY (course_id, version)"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        // 课堂考勤 - 每课次一行，缺勤/迟到为按名单下标的位图；只追加，按学期分区
+        // 分区表不支持外键，课程删除后的考勤作为历史保留
+        "CREATE TABLE IF NOT EXISTS attendance_sessions ("
+        "semester_id INT NOT NULL, "                   // 课程未关联学期时为0
+        "course_id INT NOT NULL, "
+        "session_no SMALLINT NOT NULL, "
+        "session_date DATE NOT NULL, "
+        "roster_version SMALLINT NOT NULL, "
+        "absent VARBINARY(1024) NOT NULL, "
+        "late VARBINARY(1024) NOT NULL, "
+        "absent_count SMALLINT NOT NULL, "
+        "late_count SMALLINT NOT NULL, "
+        "recorded_by INT NULL, "
+        "recorded_at TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP, "
+        "PRIMARY KEY (semester_id, course_id, session_no)"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 "
+        "PARTITION BY HASH (semester_id) PARTITIONS 16",
+
+        // 考勤汇总 - 与课次在同一事务中增量维护，报表只读这两张表
+        "CREATE TABLE IF NOT EXISTS attendance_stats ("
+        "course_id INT NOT NULL, "
+        "student_id INT NOT NULL, "
+        "sessions INT NOT NULL DEFAULT 0, "
+        "absences INT NOT NULL DEFAULT 0, "
+        "lates INT NOT NULL DEFAULT 0, "
+        "PRIMARY KEY (course_id, student_id), "
+        "KEY idx_attendance_student (student_id)"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        "CREATE TABLE IF NOT EXISTS attendance_course_stats ("
+        "course_id INT PRIMARY KEY, "
+        "sessions INT NOT NULL DEFAULT 0, "
+        "expected INT NOT NULL DEFAULT 0, "            // 各课次应到人数之和
+        "absences INT NOT NULL DEFAULT 0, "
+        "lates INT NOT NULL DEFAULT 0"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        // 选课多维汇总 - 学期 × 课程 × 年龄段，由 enrollment_cube_* 触发器增量维护
+        // 教师维度由 EnrollmentCube 按授课表在内存中展开，授课调整不需要改动汇总
+        "CREATE TABLE IF NOT EXISTS enrollment_cube ("
+        "semester_id INT NOT NULL, "                   // 课程未关联学期时为0
+        "course_id INT NOT NULL, "
+        "age_band TINYINT NOT NULL, "                  // 见 fn_age_band
+        "enrollments INT NOT NULL DEFAULT 0, "
+        "scored INT NOT NULL DEFAULT 0, "              // 已评分（成绩>0）
+        "passed INT NOT NULL DEFAULT 0, "
+        "score_sum DECIMAL(14,1) NOT NULL DEFAULT 0, "
+        "PRIMARY KEY (semester_id, course_id, age_band), "
+        "KEY idx_cube_course (course_id)"
+        ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4",
+
+        // 后台任务 - 由 JobScheduler 维护，runner 为提交任务的 主机名:进程号
+        "CREATE TABLE IF NOT EXISTS jobs ("
+        "job_id INT PRIMARY KEY AUTO_INCREMENT, "
+        "name VARCHAR(100) NOT NULL, "
+        "lane VARCHAR(20) NOT NULL, "                  // interactive / batch
+        "status VARCHAR(20) NOT NULL, "                // queued/running/succeeded/failed/cancelled/interrupted
+        "progress INT NOT NULL DEFAULT 0, "
+        "message VARCHAR(500), "
+        "runner VARCHAR(100), "
+        "created_at DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP, "
+        "started_at DATETIME NULL, "
+        "finished_at DATETIME NULL, "
+        "heartbeat_at DATETIME NULL, "                 // 所属实例运行期间定时刷新
+        "KEY idx_jobs_status (status)"
         ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4"
     };
 
     // 执行建表语句
-    QSqlQuery query;
+    QSqlQuery query(connection());
     for (const auto& queryStr : tableQueries) {
         if (!query.exec(queryStr)) {
             qWarning() << "创建表失败:" << query.lastError().text()
@@ -161,6 +560,12 @@ void Database::createTables()
         }
     }
 
+    // 存储过程/函数（触发器和结构升级中会用到）
+    createProcedures();
+
+    // 旧版本数据库的结构升级
+    migrateSchema();
+
     // MySQL触发器语法不同
     QStringList triggerQueries = {
         // 防止更新产生多个管理员
@@ -190,13 +595,845 @@ void Database::createTables()
         "BEGIN "
         "    INSERT IGNORE INTO users (account, password, role) "
         "    VALUES (NEW.teacher_id, '123456', 1); "
+        "END",
+
+        // 直接用SQL写入课程时，按学期名称补全 semester_id（程序写入路径见 withSemesterKey）
+        "CREATE TRIGGER IF NOT EXISTS course_semester_insert "
+        "BEFORE INSERT ON courses "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF NEW.semester_id IS NULL AND NEW.semester IS NOT NULL THEN "
+        "        SET NEW.semester_id = (SELECT semester_id FROM semesters WHERE name = NEW.semester); "
+        "    END IF; "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS course_semester_update "
+        "BEFORE UPDATE ON courses "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF NOT (NEW.semester <=> OLD.semester) AND NEW.semester_id <=> OLD.semester_id THEN "
+        "        SET NEW.semester_id = (SELECT semester_id FROM semesters WHERE name = NEW.semester); "
+        "    END IF; "
+        "END",
+
+        // ---- 行版本：管理员编辑时的乐观并发检查 ----
+        // 只在人工维护的字段变化时递增，触发器维护的汇总列（学分/GPA等）不影响版本
+        "CREATE TRIGGER IF NOT EXISTS students_row_version "
+        "BEFORE UPDATE ON students "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF NOT (NEW.student_id <=> OLD.student_id AND NEW.name <=> OLD.name "
+        "            AND NEW.age <=> OLD.age) THEN "
+        "        SET NEW.row_version = OLD.row_version + 1; "
+        "    END IF; "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS teachers_row_version "
+        "BEFORE UPDATE ON teachers "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF NOT (NEW.teacher_id <=> OLD.teacher_id AND NEW.name <=> OLD.name "
+        "            AND NEW.age <=> OLD.age) THEN "
+        "        SET NEW.row_version = OLD.row_version + 1; "
+        "    END IF; "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS courses_row_version "
+        "BEFORE UPDATE ON courses "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF NOT (NEW.course_id <=> OLD.course_id AND NEW.name <=> OLD.name "
+        "            AND NEW.credit <=> OLD.credit AND NEW.semester <=> OLD.semester "
+        "            AND NEW.capacity <=> OLD.capacity) THEN "
+        "        SET NEW.row_version = OLD.row_version + 1; "
+        "    END IF; "
+        "END",
+
+        // ---- 选课名额 ----
+        // 任何写入选课的路径都经过这里：先无锁检查重复，再用条件UPDATE原子占用名额，
+        // 条件UPDATE取得的课程行锁一直持有到外层事务提交（自动提交时即这一条INSERT，
+        // 在候补递补等显式事务中则到整个事务结束）；名额不足时整条INSERT失败
+        "CREATE TRIGGER IF NOT EXISTS enrollment_seat_reserve "
+        "BEFORE INSERT ON enrollments "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF EXISTS (SELECT 1 FROM enrollments "
+        "               WHERE student_id = NEW.student_id AND course_id = NEW.course_id) THEN "
+        "        SIGNAL SQLSTATE '23000' SET MYSQL_ERRNO = 1062, MESSAGE_TEXT = '已选该课程'; "
+        "    END IF; "
+        "    UPDATE courses SET enrolled_count = enrolled_count + 1 "
+        "    WHERE course_id = NEW.course_id "
+        "      AND (capacity IS NULL OR enrolled_count < capacity); "
+        "    IF ROW_COUNT() = 0 AND EXISTS (SELECT 1 FROM courses WHERE course_id = NEW.course_id) THEN "
+        "        SIGNAL SQLSTATE '45000' SET MESSAGE_TEXT = '课程名额已满'; "
+        "    END IF; "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS enrollment_seat_release "
+        "AFTER DELETE ON enrollments "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    UPDATE courses SET enrolled_count = GREATEST(enrolled_count - 1, 0) "
+        "    WHERE course_id = OLD.course_id; "
+        "END",
+
+        // 删除学生时选课由外键级联删除，不经过上面的触发器，需在删除前归还名额
+        "CREATE TRIGGER IF NOT EXISTS enrollment_seat_student_delete "
+        "BEFORE DELETE ON students "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    UPDATE courses c JOIN enrollments e ON e.course_id = c.course_id "
+        "    SET c.enrolled_count = GREATEST(c.enrolled_count - 1, 0) "
+        "    WHERE e.student_id = OLD.student_id; "
+        "END",
+
+        // ---- enrollment_view 增量维护 ----
+        "CREATE TRIGGER IF NOT EXISTS enrollment_view_insert "
+        "AFTER INSERT ON enrollments "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    REPLACE INTO enrollment_view (enrollment_id, student_id, student_name, "
+        "        course_id, course_name, semester, semester_id, score) "
+        "    SELECT NEW.id, NEW.student_id, "
+        "        (SELECT name FROM students WHERE student_id = NEW.student_id), "
+        "        NEW.course_id, c.name, c.semester, c.semester_id, NEW.score "
+        "    FROM (SELECT 1) AS dummy "
+        "    LEFT JOIN courses c ON c.course_id = NEW.course_id; "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS enrollment_view_update "
+        "AFTER UPDATE ON enrollments "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF NEW.id = OLD.id AND NEW.student_id <=> OLD.student_id "
+        "       AND NEW.course_id <=> OLD.course_id THEN "
+        // 最常见的情况：只改成绩
+        "        UPDATE enrollment_view SET score = NEW.score WHERE enrollment_id = NEW.id; "
+        "    ELSE "
+        "        DELETE FROM enrollment_view WHERE enrollment_id = OLD.id; "
+        "        REPLACE INTO enrollment_view (enrollment_id, student_id, student_name, "
+        "            course_id, course_name, semester, semester_id, score) "
+        "        SELECT NEW.id, NEW.student_id, "
+        "            (SELECT name FROM students WHERE student_id = NEW.student_id), "
+        "            NEW.course_id, c.name, c.semester, c.semester_id, NEW.score "
+        "        FROM (SELECT 1) AS dummy "
+        "        LEFT JOIN courses c ON c.course_id = NEW.course_id; "
+        "    END IF; "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS enrollment_view_delete "
+        "AFTER DELETE ON enrollments "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    DELETE FROM enrollment_view WHERE enrollment_id = OLD.id; "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS enrollment_view_student_update "
+        "AFTER UPDATE ON students "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF NOT (NEW.name <=> OLD.name) OR NEW.student_id <> OLD.student_id THEN "
+        "        UPDATE enrollment_view SET student_id = NEW.student_id, student_name = NEW.name "
+        "        WHERE student_id = OLD.student_id; "
+        "    END IF; "
+        "END",
+
+        // 外键级联删除不会触发 enrollments 上的触发器，需要单独清理
+        "CREATE TRIGGER IF NOT EXISTS enrollment_view_student_delete "
+        "AFTER DELETE ON students "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    DELETE FROM enrollment_view WHERE student_id = OLD.student_id; "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS enrollment_view_course_update "
+        "AFTER UPDATE ON courses "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF NOT (NEW.name <=> OLD.name) OR NOT (NEW.semester <=> OLD.semester) "
+        "       OR NOT (NEW.semester_id <=> OLD.semester_id) OR NEW.course_id <> OLD.course_id THEN "
+        "        UPDATE enrollment_view SET course_id = NEW.course_id, course_name = NEW.name, "
+        "            semester = NEW.semester, semester_id = NEW.semester_id "
+        "        WHERE course_id = OLD.course_id; "
+        "    END IF; "
+        "END",
+
+        // ---- 学生学分/GPA 增量维护：撤销旧行的贡献，再加上新行的贡献 ----
+        "CREATE TRIGGER IF NOT EXISTS student_totals_insert "
+        "AFTER INSERT ON enrollments "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    CALL sp_apply_enrollment_delta(NEW.student_id, NEW.course_id, NEW.score, 1); "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS student_totals_update "
+        "AFTER UPDATE ON enrollments "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF NOT (NEW.score <=> OLD.score) OR NOT (NEW.student_id <=> OLD.student_id) "
+        "       OR NOT (NEW.course_id <=> OLD.course_id) THEN "
+        "        CALL sp_apply_enrollment_delta(OLD.student_id, OLD.course_id, OLD.score, -1); "
+        "        CALL sp_apply_enrollment_delta(NEW.student_id, NEW.course_id, NEW.score, 1); "
+        "    END IF; "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS student_totals_delete "
+        "AFTER DELETE ON enrollments "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    CALL sp_apply_enrollment_delta(OLD.student_id, OLD.course_id, OLD.score, -1); "
+        "END",
+
+        // 课程学分变化时，按差值调整所有已选该课程学生的汇总
+        "CREATE TRIGGER IF NOT EXISTS student_totals_course_credit "
+        "AFTER UPDATE ON courses "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF NOT (NEW.credit <=> OLD.credit) THEN "
+        "        UPDATE students s JOIN enrollments e "
+        "            ON e.student_id = s.student_id AND e.course_id = NEW.course_id "
+        "        SET s.credits = s.credits "
+        "                + IF(e.score >= 60, IFNULL(NEW.credit, 0) - IFNULL(OLD.credit, 0), 0), "
+        "            s.attempted_credits = s.attempted_credits "
+        "                + IF(e.score > 0, IFNULL(NEW.credit, 0) - IFNULL(OLD.credit, 0), 0), "
+        "            s.grade_points = s.grade_points + IF(e.score > 0, "
+        "                (IFNULL(NEW.credit, 0) - IFNULL(OLD.credit, 0)) * fn_grade_point(e.score), 0); "
+        "    END IF; "
+        "END",
+
+        // 删除课程会级联删除选课，但级联不触发 enrollments 的触发器，需在删除前扣减
+        "CREATE TRIGGER IF NOT EXISTS student_totals_course_delete "
+        "BEFORE DELETE ON courses "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    UPDATE students s JOIN enrollments e "
+        "        ON e.student_id = s.student_id AND e.course_id = OLD.course_id "
+        "    SET s.credits = s.credits - IF(e.score >= 60, IFNULL(OLD.credit, 0), 0), "
+        "        s.attempted_credits = s.attempted_credits - IF(e.score > 0, IFNULL(OLD.credit, 0), 0), "
+        "        s.grade_points = s.grade_points "
+        "            - IF(e.score > 0, IFNULL(OLD.credit, 0) * fn_grade_point(e.score), 0); "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS enrollment_view_course_delete "
+        "AFTER DELETE ON courses "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    DELETE FROM enrollment_view WHERE course_id = OLD.course_id; "
+        "END",
+
+        // ---- enrollment_cube 增量维护 ----
+        "CREATE TRIGGER IF NOT EXISTS enrollment_cube_insert "
+        "AFTER INSERT ON enrollments "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    CALL sp_apply_cube_delta(NEW.student_id, NEW.course_id, NEW.score, 1); "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS enrollment_cube_update "
+        "AFTER UPDATE ON enrollments "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF NOT (NEW.score <=> OLD.score) OR NOT (NEW.student_id <=> OLD.student_id) "
+        "       OR NOT (NEW.course_id <=> OLD.course_id) THEN "
+        "        CALL sp_apply_cube_delta(OLD.student_id, OLD.course_id, OLD.score, -1); "
+        "        CALL sp_apply_cube_delta(NEW.student_id, NEW.course_id, NEW.score, 1); "
+        "    END IF; "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS enrollment_cube_delete "
+        "AFTER DELETE ON enrollments "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    CALL sp_apply_cube_delta(OLD.student_id, OLD.course_id, OLD.score, -1); "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS enrollment_cube_student_update "
+        "AFTER UPDATE ON students "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF fn_age_band(NEW.age) <> fn_age_band(OLD.age) THEN "
+        "        CALL sp_apply_student_cube_delta(NEW.student_id, fn_age_band(OLD.age), -1); "
+        "        CALL sp_apply_student_cube_delta(NEW.student_id, fn_age_band(NEW.age), 1); "
+        "    END IF; "
+        "END",
+
+        // 删除学生会级联删除选课（不触发 enrollments 的触发器），需在删除前扣减
+        "CREATE TRIGGER IF NOT EXISTS enrollment_cube_student_delete "
+        "BEFORE DELETE ON students "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    CALL sp_apply_student_cube_delta(OLD.student_id, fn_age_band(OLD.age), -1); "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS enrollment_cube_course_update "
+        "AFTER UPDATE ON courses "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    IF NOT (NEW.semester_id <=> OLD.semester_id) OR NEW.course_id <> OLD.course_id THEN "
+        "        UPDATE enrollment_cube SET semester_id = IFNULL(NEW.semester_id, 0), "
+        "            course_id = NEW.course_id "
+        "        WHERE course_id = OLD.course_id; "
+        "    END IF; "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS enrollment_cube_course_delete "
+        "AFTER DELETE ON courses "
+        "FOR EACH ROW "
+        "BEGIN "
+        "    DELETE FROM enrollment_cube WHERE course_id = OLD.course_id; "
         "END"
     };
 
     // 执行触发器语句
     for (const auto& queryStr : triggerQueries) {
         if (!query.exec(queryStr)) {
-            qWarning() << "创建触发器失败:" << query.lastError().text();
+            qWarning() << "创建触发器失败:" << query.lastError().text();
+        }
+    }
+
+    // 读模型与选课表行数不一致（首次创建或触发器缺失期间有写入）时整体重建
+    QSqlQuery checkViewQuery("SELECT (SELECT COUNT(*) FROM enrollment_view) = "
+                             "(SELECT COUNT(*) FROM enrollments)", connection());
+    if (checkViewQuery.next() && !checkViewQuery.value(0).toBool()) {
+        rebuildEnrollmentView();
+    }
+
+    if (!isEnrollmentCubeConsistent()) {
+        rebuildEnrollmentCube();
+    }
+}
+
+bool Database::columnExists(const QString& table, const QString& column)
+{
+    QSqlQuery query(connection());
+    query.prepare("SELECT COUNT(*) FROM information_schema.COLUMNS "
+                  "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ? AND COLUMN_NAME = ?");
+    query.addBindValue(table);
+    query.addBindValue(column);
+    return query.exec() && query.next() && query.value(0).toInt() > 0;
+}
+
+bool Database::indexExists(const QString& table, const QString& index)
+{
+    QSqlQuery query(connection());
+    query.prepare("SELECT COUNT(*) FROM information_schema.STATISTICS "
+                  "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ? AND INDEX_NAME = ?");
+    query.addBindValue(table);
+    query.addBindValue(index);
+    return query.exec() && query.next() && query.value(0).toInt() > 0;
+}
+
+bool Database::constraintExists(const QString& table, const QString& constraint)
+{
+    QSqlQuery query(connection());
+    query.prepare("SELECT COUNT(*) FROM information_schema.TABLE_CONSTRAINTS "
+                  "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ? AND CONSTRAINT_NAME = ?");
+    query.addBindValue(table);
+    query.addBindValue(constraint);
+    return query.exec() && query.next() && query.value(0).toInt() > 0;
+}
+
+void Database::addColumnIfMissing(const QString& table, const QString& column,
+                                  const QString& definition)
+{
+    if (columnExists(table, column)) return;
+
+    QSqlQuery query(connection());
+    QString sql = QString("ALTER TABLE `%1` ADD COLUMN `%2` %3").arg(table, column, definition);
+    if (!query.exec(sql)) {
+        qWarning() << "添加字段失败:" << query.lastError().text() << "\nSQL:" << sql;
+    }
+}
+
+void Database::addIndexIfMissing(const QString& table, const QString& index,
+                                 const QString& definition)
+{
+    if (indexExists(table, index)) return;
+
+    QSqlQuery query(connection());
+    QString sql = QString("ALTER TABLE `%1` ADD %2").arg(table, definition);
+    if (!query.exec(sql)) {
+        qWarning() << "添加索引失败:" << query.lastError().text() << "\nSQL:" << sql;
+    }
+}
+
+void Database::migrateSchema()
+{
+    // 学期维度：旧库的 courses 补 semester_id 及索引，按已有学期名称回填
+    addColumnIfMissing("courses", "semester_id", "INT NULL AFTER semester");
+    addIndexIfMissing("courses", "idx_semester_course",
+                      "KEY idx_semester_course (semester_id DESC, course_id)");
+    if (!constraintExists("courses", "fk_course_semester")) {
+        QSqlQuery query(connection());
+        if (!query.exec("ALTER TABLE courses ADD CONSTRAINT fk_course_semester "
+                        "FOREIGN KEY (semester_id) REFERENCES semesters(semester_id) "
+                        "ON DELETE SET NULL")) {
+            qWarning() << "添加外键失败:" << query.lastError().text();
+        }
+    }
+    addIndexIfMissing("teachings", "idx_course_teacher",
+                      "KEY idx_course_teacher (course_id, teacher_id)");
+    addIndexIfMissing("enrollments", "idx_course_student",
+                      "KEY idx_course_student (course_id, student_id)");
+    syncSemesters();
+
+    // 学生学分/GPA汇总：旧库 credits 为静态INT，改为由触发器维护的已获学分
+    const bool totalsMissing = !columnExists("students", "grade_points");
+    QSqlQuery typeQuery("SELECT DATA_TYPE FROM information_schema.COLUMNS "
+                        "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = 'students' "
+                        "AND COLUMN_NAME = 'credits'", connection());
+    if (typeQuery.next() && typeQuery.value(0).toString().toLower() == "int") {
+        QSqlQuery alterQuery(connection());
+        if (!alterQuery.exec("ALTER TABLE students MODIFY credits DECIMAL(6,1) NOT NULL DEFAULT 0")) {
+            qWarning() << "修改学分字段失败:" << alterQuery.lastError().text();
+        }
+    }
+    addColumnIfMissing("students", "attempted_credits",
+                       "DECIMAL(6,1) NOT NULL DEFAULT 0 AFTER credits");
+    addColumnIfMissing("students", "grade_points",
+                       "DECIMAL(8,2) NOT NULL DEFAULT 0 AFTER attempted_credits");
+    addColumnIfMissing("students", "gpa",
+                       "DECIMAL(4,3) AS (IF(attempted_credits > 0, "
+                       "grade_points / attempted_credits, 0)) STORED AFTER grade_points");
+    if (totalsMissing) {
+        recomputeStudentTotals();
+    }
+
+    // 行版本：管理员表格编辑的冲突检测
+    for (const char* table : {"students", "teachers", "courses"}) {
+        addColumnIfMissing(table, "row_version", "INT NOT NULL DEFAULT 0");
+    }
+
+    // 学位审核：学生所属专业
+    addColumnIfMissing("students", "program_id", "INT NULL AFTER age");
+    if (!constraintExists("students", "fk_student_program")) {
+        QSqlQuery query(connection());
+        if (!query.exec("ALTER TABLE students ADD CONSTRAINT fk_student_program "
+                        "FOREIGN KEY (program_id) REFERENCES programs(program_id) "
+                        "ON DELETE SET NULL")) {
+            qWarning() << "添加外键失败:" << query.lastError().text();
+        }
+    }
+
+    // 自动排课：教师不可排课时间；教室表为空时用授课中已出现的教室初始化
+    addColumnIfMissing("teachers", "unavailable_time", "VARCHAR(255) NULL AFTER age");
+    QSqlQuery classroomQuery("SELECT COUNT(*) FROM classrooms", connection());
+    if (classroomQuery.next() && classroomQuery.value(0).toInt() == 0) {
+        QSqlQuery seedQuery(connection());
+        if (!seedQuery.exec("INSERT IGNORE INTO classrooms (name) "
+                            "SELECT DISTINCT TRIM(classroom) FROM teachings "
+                            "WHERE classroom IS NOT NULL AND TRIM(classroom) <> ''")) {
+            qWarning() << "初始化教室表失败:" << seedQuery.lastError().text();
+        }
+    }
+
+    // 选课容量：旧库补列后按现有选课回填已选人数
+    addColumnIfMissing("courses", "capacity", "INT NULL AFTER semester_id");
+    if (!columnExists("courses", "enrolled_count")) {
+        addColumnIfMissing("courses", "enrolled_count", "INT NOT NULL DEFAULT 0 AFTER capacity");
+        QSqlQuery query(connection());
+        if (!query.exec("UPDATE courses c SET enrolled_count = "
+                        "(SELECT COUNT(*) FROM enrollments e WHERE e.course_id = c.course_id)")) {
+            qWarning() << "回填已选人数失败:" << query.lastError().text();
+        }
+    }
+
+    // 考勤分区键固定在名单上：旧库按已有考勤回填，课程之后改学期也不影响已记录的课次
+    if (!columnExists("attendance_rosters", "semester_id")) {
+        addColumnIfMissing("attendance_rosters", "semester_id", "INT NULL AFTER version");
+        QSqlQuery query(connection());
+        if (!query.exec("UPDATE attendance_rosters r JOIN ("
+                        "SELECT course_id, MIN(semester_id) AS semester_id "
+                        "FROM attendance_sessions GROUP BY course_id) s ON s.course_id = r.course_id "
+                        "SET r.semester_id = s.semester_id")) {
+            qWarning() << "回填考勤学期失败:" << query.lastError().text();
+        }
+    }
+
+    // 任务心跳：判断留下未结束任务的实例是否已经退出
+    addColumnIfMissing("jobs", "heartbeat_at", "DATETIME NULL AFTER finished_at");
+}
+
+int Database::recomputeStudentTotals(int workerCount,
+                                     const std::function<bool(int done, int total)>& onRange)
+{
+    QSqlQuery rangeQuery("SELECT MIN(student_id), MAX(student_id) FROM students", connection());
+    if (!rangeQuery.next() || rangeQuery.value(0).isNull()) {
+        return 0;
+    }
+    const int minId = rangeQuery.value(0).toInt();
+    const int maxId = rangeQuery.value(1).toInt();
+
+    if (workerCount <= 0) {
+        workerCount = qMax(1, QThread::idealThreadCount());
+    }
+
+    // 按学号区间切分，每个分片在自己的连接上做一次集合式重算，互不重叠所以不会互相等锁；
+    // 分片数取线程数的几倍，便于按分片汇报进度和尽早停下
+    const int rangeCount = workerCount * 4;
+    QList<QPair<int, int>> ranges;
+    const qint64 span = qint64(maxId) - minId + 1;
+    const qint64 step = qMax<qint64>(1, (span + rangeCount - 1) / rangeCount);
+    for (qint64 start = minId; start <= maxId; start += step) {
+        ranges.append(qMakePair(int(start), int(qMin<qint64>(start + step - 1, maxId))));
+    }
+
+    std::atomic<int> updatedRows{0};
+    std::atomic<int> failedRanges{0};
+    std::atomic<int> finishedRanges{0};
+    std::atomic<bool> stopped{false};
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(workerCount);
+    pool.setThreadPriority(QThread::currentThread()->priority());
+    QtConcurrent::blockingMap(&pool, ranges, [&](const QPair<int, int>& range) {
+        if (stopped.load()) return;
+        const QString connectionName = QString("recompute_%1_%2").arg(range.first).arg(range.second);
+        {
+            QSqlDatabase workerDb = QSqlDatabase::cloneDatabase(
+                QString(QSqlDatabase::defaultConnection), connectionName);
+            if (!workerDb.open()) {
+                qWarning() << "重算学分失败：无法打开连接" << workerDb.lastError().text();
+                failedRanges++;
+            } else {
+                QSqlQuery query(workerDb);
+                query.prepare(
+                    "UPDATE students s LEFT JOIN ("
+                    "    SELECT e.student_id, "
+                    "        SUM(IF(e.score >= 60, IFNULL(c.credit, 0), 0)) AS earned, "
+                    "        SUM(IF(e.score > 0, IFNULL(c.credit, 0), 0)) AS attempted, "
+                    "        SUM(IF(e.score > 0, IFNULL(c.credit, 0) * fn_grade_point(e.score), 0)) AS points "
+                    "    FROM enrollments e JOIN courses c ON e.course_id = c.course_id "
+                    "    WHERE e.student_id BETWEEN :from1 AND :to1 "
+                    "    GROUP BY e.student_id"
+                    ") t ON t.student_id = s.student_id "
+                    "SET s.credits = IFNULL(t.earned, 0), "
+                    "    s.attempted_credits = IFNULL(t.attempted, 0), "
+                    "    s.grade_points = IFNULL(t.points, 0) "
+                    "WHERE s.student_id BETWEEN :from2 AND :to2");
+                query.bindValue(":from1", range.first);
+                query.bindValue(":to1", range.second);
+                query.bindValue(":from2", range.first);
+                query.bindValue(":to2", range.second);
+                if (query.exec()) {
+                    updatedRows += query.numRowsAffected();
+                } else {
+                    qWarning() << "重算学分失败:" << query.lastError().text();
+                    failedRanges++;
+                }
+                workerDb.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+
+        const int done = ++finishedRanges;
+        if (onRange && !onRange(done, ranges.size())) stopped = true;
+    });
+
+    invalidateReadCache();
+    qDebug() << "学分/GPA重算完成: 分片" << finishedRanges.load() << "/" << ranges.size()
+             << "更新" << updatedRows.load() << "行, 失败分片" << failedRanges.load();
+    return failedRanges.load() == 0 && !stopped.load() ? updatedRows.load() : -1;
+}
+
+int Database::semesterKey(const QString& name)
+{
+    // 支持 "2024-2025-1"、"2024-2025学年第1学期"、"2024秋"、"2025春" 等写法
+    static const QRegularExpression yearPattern("(\\d{4})");
+    static const QRegularExpression termPattern("([123])\\D*$");
+
+    QRegularExpressionMatch yearMatch = yearPattern.match(name);
+    if (!yearMatch.hasMatch()) return 0;
+    int year = yearMatch.captured(1).toInt();
+
+    // 学年以秋季学期开始：春季、夏季学期属于上一年开始的学年
+    if (name.contains("秋")) return year * 10 + 1;
+    if (name.contains("春")) return (year - 1) * 10 + 2;
+    if (name.contains("夏")) return (year - 1) * 10 + 3;
+
+    QRegularExpressionMatch termMatch = termPattern.match(name.mid(yearMatch.capturedEnd()));
+    int term = termMatch.hasMatch() ? termMatch.captured(1).toInt() : 1;
+    return year * 10 + term;
+}
+
+int Database::ensureSemester(const QString& name)
+{
+    int key = semesterKey(name);
+    if (key <= 0) return 0;
+
+    // 默认起止日期，可在学期表中调整
+    int year = key / 10;
+    int term = key % 10;
+    QDate start, end;
+    if (term == 1) {
+        start = QDate(year, 9, 1);
+        end = QDate(year + 1, 1, 31);
+    } else if (term == 2) {
+        start = QDate(year + 1, 2, 1);
+        end = QDate(year + 1, 7, 10);
+    } else {
+        start = QDate(year + 1, 7, 11);
+        end = QDate(year + 1, 8, 31);
+    }
+
+    QSqlQuery query(connection());
+    query.prepare("INSERT IGNORE INTO semesters (semester_id, name, start_date, end_date) "
+                  "VALUES (?, ?, ?, ?)");
+    query.addBindValue(key);
+    query.addBindValue(name);
+    query.addBindValue(start);
+    query.addBindValue(end);
+    if (!query.exec()) {
+        qWarning() << "创建学期失败:" << query.lastError().text();
+    }
+    return key;
+}
+
+void Database::syncSemesters()
+{
+    QSqlQuery query("SELECT DISTINCT semester FROM courses "
+                    "WHERE semester_id IS NULL AND semester IS NOT NULL AND semester <> ''", connection());
+    QStringList names;
+    while (query.next()) {
+        names.append(query.value(0).toString());
+    }
+
+    for (const QString& name : names) {
+        int key = ensureSemester(name);
+        if (key <= 0) {
+            qWarning() << "无法识别的学期名称:" << name;
+            continue;
+        }
+
+        QSqlQuery update(connection());
+        update.prepare("UPDATE courses SET semester_id = ? WHERE semester = ? AND semester_id IS NULL");
+        update.addBindValue(key);
+        update.addBindValue(name);
+        update.exec();
+    }
+
+    // 还没有当前学期时，取今天所在的学期，否则取最新学期
+    QSqlQuery currentQuery("SELECT COUNT(*) FROM semesters WHERE is_current = 1", connection());
+    if (currentQuery.next() && currentQuery.value(0).toInt() == 0) {
+        QSqlQuery pickQuery("SELECT COALESCE("
+                            "(SELECT semester_id FROM semesters "
+                            " WHERE CURDATE() BETWEEN start_date AND end_date LIMIT 1), "
+                            "(SELECT MAX(semester_id) FROM semesters))", connection());
+        if (pickQuery.next() && !pickQuery.value(0).isNull()) {
+            setCurrentSemester(pickQuery.value(0).toInt());
+        }
+    }
+}
+
+bool Database::setCurrentSemester(int semesterId)
+{
+    QSqlQuery query(connection());
+    query.prepare("UPDATE semesters SET is_current = (semester_id = ?)");
+    query.addBindValue(semesterId);
+    if (!query.exec()) return false;
+    notifyWrite([this]() { invalidateReadCache(); });
+    return true;
+}
+
+QList<QMap<QString, QVariant>> Database::getSemesters()
+{
+    return sharedRead(kSemestersSql);
+}
+
+QVariantMap Database::withSemesterKey(const QString& table, const QVariantMap& data)
+{
+    if (table != "courses" || !data.contains("semester") || data.contains("semester_id")) {
+        return data;
+    }
+
+    QVariantMap values = data;
+    int key = ensureSemester(data["semester"].toString());
+    values["semester_id"] = key > 0 ? QVariant(key) : QVariant(QMetaType::fromType<int>());
+    return values;
+}
+
+bool Database::rebuildEnrollmentView()
+{
+    Transaction transaction;
+    QSqlQuery query(connection());
+    bool ok = query.exec("DELETE FROM enrollment_view") &&
+              query.exec("INSERT INTO enrollment_view (enrollment_id, student_id, student_name, "
+                         "course_id, course_name, semester, semester_id, score) "
+                         "SELECT e.id, e.student_id, s.name, e.course_id, "
+                         "c.name, c.semester, c.semester_id, e.score "
+                         "FROM enrollments e "
+                         "LEFT JOIN students s ON e.student_id = s.student_id "
+                         "LEFT JOIN courses c ON e.course_id = c.course_id");
+
+    if (!ok) {
+        qWarning() << "重建选课读模型失败:" << query.lastError().text();
+        return false;
+    }
+    if (!transaction.commit()) return false;
+    qDebug() << "选课读模型已重建";
+    return true;
+}
+
+bool Database::isEnrollmentCubeConsistent()
+{
+    // 与 rebuildEnrollmentCube 使用同样的连接，缺少课程或学生的选课行两边都不计入
+    QSqlQuery query(connection());
+    if (!query.exec("SELECT (SELECT IFNULL(SUM(enrollments), 0) FROM enrollment_cube) = "
+                    "(SELECT COUNT(*) FROM enrollments e "
+                    "JOIN courses c ON e.course_id = c.course_id "
+                    "JOIN students s ON e.student_id = s.student_id)")) {
+        qWarning() << "检查选课多维汇总失败:" << query.lastError().text();
+        return true;
+    }
+    return !query.next() || query.value(0).toBool();
+}
+
+bool Database::rebuildEnrollmentCube()
+{
+    Transaction transaction;
+    QSqlQuery query(connection());
+    bool ok = query.exec("DELETE FROM enrollment_cube") &&
+              query.exec("INSERT INTO enrollment_cube (semester_id, course_id, age_band, "
+                         "enrollments, scored, passed, score_sum) "
+                         "SELECT IFNULL(c.semester_id, 0), c.course_id, fn_age_band(s.age), "
+                         "COUNT(*), SUM(IFNULL(e.score > 0, 0)), SUM(IFNULL(e.score >= 60, 0)), "
+                         "SUM(IF(e.score > 0, e.score, 0)) "
+                         "FROM enrollments e "
+                         "JOIN courses c ON e.course_id = c.course_id "
+                         "JOIN students s ON e.student_id = s.student_id "
+                         "GROUP BY c.semester_id, c.course_id, fn_age_band(s.age)");
+
+    if (!ok) {
+        qWarning() << "重建选课多维汇总失败:" << query.lastError().text();
+        return false;
+    }
+    if (!transaction.commit()) return false;
+    qDebug() << "选课多维汇总已重建";
+    return true;
+}
+
+void Database::createProcedures()
+{
+    // 窗口初始化存储过程：每个角色窗口打开时只需一次往返
+    // 过程体每次启动都重建，保证与代码中的查询语句一致
+    // 授课/选课只返回按课程分组的汇总行，明细在界面上展开课程时再查询
+    const QString adminBody = QStringList{
+        kStudentsSql, kTeachersSql, kCoursesSql,
+        QString(kTeachingGroupsSql).arg(""), QString(kEnrollmentGroupsSql).arg(""),
+        kUsersSql,
+        kSemestersSql
+    }.join("; ");
+
+    const QString teacherBody = QStringList{
+        QString(kTeacherInfoSql).arg("p_teacher_id"),
+        QString(kTeacherTeachingsSql).arg("p_teacher_id")
+    }.join("; ");
+
+    const QString studentBody = QStringList{
+        QString(kStudentInfoSql).arg("p_student_id"),
+        QString(kStudentEnrollmentsSql).arg("p_student_id")
+    }.join("; ");
+
+    QStringList procedureQueries = {
+        // 百分制成绩转4.0绩点；成绩为0或NULL视为未评分，不计入已修学分
+        "DROP FUNCTION IF EXISTS fn_grade_point",
+        "CREATE FUNCTION fn_grade_point(p_score DECIMAL(4,1)) RETURNS DECIMAL(3,2) "
+        "DETERMINISTIC NO SQL "
+        "RETURN CASE "
+        "    WHEN p_score IS NULL OR p_score <= 0 THEN 0 "
+        "    WHEN p_score >= 90 THEN 4.0 "
+        "    WHEN p_score >= 85 THEN 3.7 "
+        "    WHEN p_score >= 82 THEN 3.3 "
+        "    WHEN p_score >= 78 THEN 3.0 "
+        "    WHEN p_score >= 75 THEN 2.7 "
+        "    WHEN p_score >= 72 THEN 2.3 "
+        "    WHEN p_score >= 68 THEN 2.0 "
+        "    WHEN p_score >= 64 THEN 1.5 "
+        "    WHEN p_score >= 60 THEN 1.0 "
+        "    ELSE 0 END",
+
+        // 一条选课记录对学生汇总的贡献，p_sign 为 1（加上）或 -1（撤销）
+        "DROP PROCEDURE IF EXISTS sp_apply_enrollment_delta",
+        "CREATE PROCEDURE sp_apply_enrollment_delta(IN p_student_id INT, IN p_course_id INT, "
+        "                                           IN p_score DECIMAL(4,1), IN p_sign INT) "
+        "BEGIN "
+        "    DECLARE v_credit DECIMAL(4,1); "
+        "    IF p_score > 0 THEN "
+        "        SELECT IFNULL(credit, 0) INTO v_credit FROM courses WHERE course_id = p_course_id; "
+        "        UPDATE students "
+        "        SET credits = credits + p_sign * IF(p_score >= 60, IFNULL(v_credit, 0), 0), "
+        "            attempted_credits = attempted_credits + p_sign * IFNULL(v_credit, 0), "
+        "            grade_points = grade_points "
+        "                + p_sign * IFNULL(v_credit, 0) * fn_grade_point(p_score) "
+        "        WHERE student_id = p_student_id; "
+        "    END IF; "
+        "END",
+
+        // 年龄段：0 未知，1 <18，2 18-20，3 21-22，4 23-25，5 >25
+        "DROP FUNCTION IF EXISTS fn_age_band",
+        "CREATE FUNCTION fn_age_band(p_age INT) RETURNS TINYINT "
+        "DETERMINISTIC NO SQL "
+        "RETURN CASE "
+        "    WHEN p_age IS NULL THEN 0 "
+        "    WHEN p_age < 18 THEN 1 "
+        "    WHEN p_age <= 20 THEN 2 "
+        "    WHEN p_age <= 22 THEN 3 "
+        "    WHEN p_age <= 25 THEN 4 "
+        "    ELSE 5 END",
+
+        // 一条选课记录对多维汇总的贡献，p_sign 为 1（加上）或 -1（撤销）
+        "DROP PROCEDURE IF EXISTS sp_apply_cube_delta",
+        "CREATE PROCEDURE sp_apply_cube_delta(IN p_student_id INT, IN p_course_id INT, "
+        "                                     IN p_score DECIMAL(4,1), IN p_sign INT) "
+        "BEGIN "
+        "    INSERT INTO enrollment_cube (semester_id, course_id, age_band, "
+        "        enrollments, scored, passed, score_sum) "
+        "    SELECT IFNULL(c.semester_id, 0), c.course_id, "
+        "        fn_age_band((SELECT age FROM students WHERE student_id = p_student_id)), "
+        "        p_sign, IF(p_score > 0, p_sign, 0), IF(p_score >= 60, p_sign, 0), "
+        "        IF(p_score > 0, p_sign * p_score, 0) "
+        "    FROM courses c WHERE c.course_id = p_course_id "
+        "    ON DUPLICATE KEY UPDATE enrollments = enrollments + VALUES(enrollments), "
+        "        scored = scored + VALUES(scored), passed = passed + VALUES(passed), "
+        "        score_sum = score_sum + VALUES(score_sum); "
+        "END",
+
+        // 一个学生全部选课按课程分组后对汇总的贡献，年龄段变化或删除学生时整体移动
+        "DROP PROCEDURE IF EXISTS sp_apply_student_cube_delta",
+        "CREATE PROCEDURE sp_apply_student_cube_delta(IN p_student_id INT, IN p_age_band TINYINT, "
+        "                                             IN p_sign INT) "
+        "BEGIN "
+        "    INSERT INTO enrollment_cube (semester_id, course_id, age_band, "
+        "        enrollments, scored, passed, score_sum) "
+        "    SELECT IFNULL(c.semester_id, 0), c.course_id, p_age_band, "
+        "        p_sign * COUNT(*), p_sign * SUM(IFNULL(e.score > 0, 0)), "
+        "        p_sign * SUM(IFNULL(e.score >= 60, 0)), "
+        "        p_sign * SUM(IF(e.score > 0, e.score, 0)) "
+        "    FROM enrollments e JOIN courses c ON c.course_id = e.course_id "
+        "    WHERE e.student_id = p_student_id "
+        "    GROUP BY c.course_id, c.semester_id "
+        "    ON DUPLICATE KEY UPDATE enrollments = enrollments + VALUES(enrollments), "
+        "        scored = scored + VALUES(scored), passed = passed + VALUES(passed), "
+        "        score_sum = score_sum + VALUES(score_sum); "
+        "END",
+
+        "DROP PROCEDURE IF EXISTS sp_bootstrap_admin",
+        QString("CREATE PROCEDURE sp_bootstrap_admin() "
+                "BEGIN %1; END").arg(adminBody),
+
+        "DROP PROCEDURE IF EXISTS sp_bootstrap_teacher",
+        QString("CREATE PROCEDURE sp_bootstrap_teacher(IN p_teacher_id INT) "
+                "BEGIN %1; END").arg(teacherBody),
+
+        "DROP PROCEDURE IF EXISTS sp_bootstrap_student",
+        QString("CREATE PROCEDURE sp_bootstrap_student(IN p_student_id INT) "
+                "BEGIN %1; END").arg(studentBody)
+    };
+
+    QSqlQuery query(connection());
+    for (const auto& queryStr : procedureQueries) {
+        if (!query.exec(queryStr)) {
+            qWarning() << "创建存储过程失败:" << query.lastError().text();
         }
     }
 }
@@ -221,15 +1458,48 @@ void Database::loadDatabaseConfig()
     m_port = settings.value("Database/Port", 3306).toInt();
 }
 
+bool Database::isClientJoinEnabled() const
+{
+    QSettings settings("TeachingSystem", "TeachingManager");
+    return settings.value("Performance/ClientJoin", false).toBool();
+}
+
+void Database::setClientJoinEnabled(bool enabled)
+{
+    QSettings settings("TeachingSystem", "TeachingManager");
+    settings.setValue("Performance/ClientJoin", enabled);
+}
+
+QSqlDatabase Database::connection() const
+{
+    if (QThread::currentThread() == thread()) {
+        return QSqlDatabase::database();
+    }
+
+    // 连接不能跨线程使用：其他线程第一次访问时克隆默认连接，线程结束时自动关闭
+    if (t_threadConnection.name.isEmpty()) {
+        t_threadConnection.name = QString("thread_%1").arg(++g_threadConnectionSerial);
+        QSqlDatabase db = QSqlDatabase::cloneDatabase(QString(QSqlDatabase::defaultConnection),
+                                                      t_threadConnection.name);
+        if (!db.open()) {
+            qWarning() << "线程连接打开失败:" << db.lastError().text();
+        }
+        return db;
+    }
+    return QSqlDatabase::database(t_threadConnection.name);
+}
+
 bool Database::isConnected() const
 {
-    return QSqlDatabase::database().isOpen();
+    return connection().isOpen();
 }
 
 // 通用CRUD操作
-bool Database::executeInsert(const QString& table, const QVariantMap& data)
+bool Database::executeInsert(const QString& table, const QVariantMap& rawData)
 {
-    if (data.isEmpty()) return false;
+    if (rawData.isEmpty()) return false;
+
+    const QVariantMap data = withSemesterKey(table, rawData);
 
     QStringList fields, placeholders;
     for (auto it = data.begin(); it != data.end(); ++it) {
@@ -242,19 +1512,32 @@ bool Database::executeInsert(const QString& table, const QVariantMap& data)
                       .arg(fields.join(", "))
                       .arg(placeholders.join(", "));
 
-    QSqlQuery query;
+    QSqlQuery query(connection());
     query.prepare(sql);
 
     for (auto it = data.begin(); it != data.end(); ++it) {
         query.bindValue(":" + it.key(), it.value());
     }
 
-    return query.exec();
+    if (!query.exec()) return false;
+
+    const QString idField = m_primaryKeys.value(table, "id");
+    const int id = data.contains(idField) ? data[idField].toInt() : query.lastInsertId().toInt();
+    notifyWrite([this, table, id, data]() {
+        if (table == "enrollments" && data.contains("student_id") && data.contains("course_id")) {
+            emit enrollmentScoreChanged(data["student_id"].toInt(), data["course_id"].toInt(),
+                                        data.value("score", 0));
+        }
+        emit recordChanged(table, id, data);
+    });
+    return true;
 }
 
-bool Database::executeUpdate(const QString& table, int id, const QVariantMap& data)
+bool Database::executeUpdate(const QString& table, int id, const QVariantMap& rawData)
 {
-    if (data.isEmpty()) return false;
+    if (rawData.isEmpty()) return false;
+
+    const QVariantMap data = withSemesterKey(table, rawData);
 
     QStringList updates;
     for (auto it = data.begin(); it != data.end(); ++it) {
@@ -268,15 +1551,90 @@ bool Database::executeUpdate(const QString& table, int id, const QVariantMap& da
                       .arg(updates.join(", "))
                       .arg(idField);
 
-    QSqlQuery query;
+    QSqlQuery query(connection());
+    query.prepare(sql);
+    query.bindValue(":id", id);
+
+    for (auto it = data.begin(); it != data.end(); ++it) {
+        query.bindValue(":" + it.key(), it.value());
+    }
+
+    if (!query.exec()) return false;
+
+    notifyWrite([this, table, id, data]() {
+        if (table == "enrollments" || table == "courses") {
+            emit enrollmentDataInvalidated();
+        }
+        if (table == "courses" && data.contains("capacity")) {
+            emit seatsReleased(id);
+        }
+        emit recordChanged(table, id, data);
+    });
+    return true;
+}
+
+Database::UpdateResult Database::executeUpdate(const QString& table, int id,
+                                               const QVariantMap& rawData,
+                                               int expectedVersion, int* newVersion)
+{
+    if (rawData.isEmpty()) return UpdateResult::Error;
+
+    const QVariantMap data = withSemesterKey(table, rawData);
+
+    QStringList updates;
+    for (auto it = data.begin(); it != data.end(); ++it) {
+        updates << QString("`%1` = :%2").arg(it.key()).arg(it.key());
+    }
+
+    QString idField = m_primaryKeys.value(table, "id");
+
+    // 只有版本未变时才更新；版本由 *_row_version 触发器递增
+    QString sql = QString("UPDATE `%1` SET %2 WHERE `%3` = :id AND row_version = :expected_version")
+                      .arg(table)
+                      .arg(updates.join(", "))
+                      .arg(idField);
+
+    QSqlQuery query(connection());
     query.prepare(sql);
     query.bindValue(":id", id);
+    query.bindValue(":expected_version", expectedVersion);
 
     for (auto it = data.begin(); it != data.end(); ++it) {
         query.bindValue(":" + it.key(), it.value());
     }
 
-    return query.exec();
+    if (!query.exec()) {
+        qWarning() << "更新失败:" << query.lastError().text();
+        return UpdateResult::Error;
+    }
+
+    // 影响0行：版本已变（冲突）、行已删除，或新值与原值相同
+    QSqlQuery versionQuery(connection());
+    versionQuery.prepare(QString("SELECT row_version FROM `%1` WHERE `%2` = :id")
+                             .arg(table, idField));
+    versionQuery.bindValue(":id", id);
+    if (!versionQuery.exec() || !versionQuery.next()) {
+        return UpdateResult::Conflict;
+    }
+
+    const int currentVersion = versionQuery.value(0).toInt();
+    if (query.numRowsAffected() <= 0 && currentVersion != expectedVersion) {
+        return UpdateResult::Conflict;
+    }
+
+    if (newVersion) {
+        *newVersion = currentVersion;
+    }
+    notifyWrite([this, table, id, data]() {
+        if (table == "enrollments" || table == "courses") {
+            emit enrollmentDataInvalidated();
+        }
+        if (table == "courses" && data.contains("capacity")) {
+            emit seatsReleased(id);
+        }
+        emit recordChanged(table, id, data);
+    });
+    return UpdateResult::Success;
 }
 
 bool Database::executeDelete(const QString& table, int id)
@@ -288,29 +1646,50 @@ bool Database::executeDelete(const QString& table, int id)
                       .arg(table)
                       .arg(idField);
 
-    QSqlQuery query;
+    // 删除学生会级联删除其选课，先记下这些课程，删除后按名额释放通知候补递补
+    QList<int> freedCourses;
+    if (table == "students") {
+        QSqlQuery courseQuery(connection());
+        courseQuery.prepare("SELECT course_id FROM enrollments WHERE student_id = ?");
+        courseQuery.addBindValue(id);
+        if (courseQuery.exec()) {
+            while (courseQuery.next()) freedCourses << courseQuery.value(0).toInt();
+        }
+    }
+
+    QSqlQuery query(connection());
     query.prepare(sql);
     query.bindValue(":id", id);
 
-    return query.exec();
+    if (!query.exec()) return false;
+
+    notifyWrite([this, table, id, freedCourses]() {
+        if (table == "enrollments" || table == "courses" || !freedCourses.isEmpty()) {
+            emit enrollmentDataInvalidated();
+        }
+        for (int courseId : freedCourses) {
+            emit seatsReleased(courseId);
+        }
+        emit recordChanged(table, id, QVariantMap());
+    });
+    return true;
 }
 
 QList<QMap<QString, QVariant>> Database::executeSelect(const QString& table,
                                                        const QString& condition)
 {
-    QList<QMap<QString, QVariant>> result;
-
     QString fields;
     QString orderBy;
 
     if (table == "students") {
-        fields = "student_id, name, age, credits";
+        fields = "student_id, name, age, credits, attempted_credits, gpa, row_version";
         orderBy = "student_id";
     } else if (table == "teachers") {
-        fields = "teacher_id, name, age";
+        fields = "teacher_id, name, age, row_version";
         orderBy = "teacher_id";
     } else if (table == "courses") {
-        fields = "course_id, name, credit, semester";  // 添加 semester 字段
+        fields = "course_id, name, credit, semester, semester_id, capacity, enrolled_count, "
+                 "row_version";
         orderBy = "course_id";
     } else if (table == "users") {
         fields = "user_id, account, password, role";
@@ -330,11 +1709,17 @@ QList<QMap<QString, QVariant>> Database::executeSelect(const QString& table,
         sql += " ORDER BY " + orderBy;
     }
 
-    QSqlQuery query(sql);
+    return sharedRead(sql);
+}
+
+// 特殊查询
+QList<QMap<QString, QVariant>> Database::readRows(QSqlQuery& query)
+{
+    QList<QMap<QString, QVariant>> result;
+    QSqlRecord record = query.record();
 
     while (query.next()) {
         QMap<QString, QVariant> row;
-        QSqlRecord record = query.record();
         for (int i = 0; i < record.count(); i++) {
             row[record.fieldName(i)] = query.value(i);
         }
@@ -344,98 +1729,560 @@ QList<QMap<QString, QVariant>> Database::executeSelect(const QString& table,
     return result;
 }
 
-// 特殊查询
-QList<QMap<QString, QVariant>> Database::getTeachings()
+QList<QMap<QString, QVariant>> Database::sharedRead(const QString& sql, const QVariantList& params)
 {
-    QList<QMap<QString, QVariant>> result;
+    QString key = sql;
+    for (const QVariant& param : params) {
+        key += QChar(0x1f) + param.toString();
+    }
 
-    // 表头顺序：{"教师工号", "教师姓名", "课程ID", "课程名称", "学期", "上课时间", "教室"}
-    QString sql = "SELECT "
-                  "t.teacher_id, "           // 教师工号 - 列0
-                  "te.name as teacher_name, " // 教师姓名 - 列1
-                  "t.course_id, "            // 课程ID - 列2
-                  "c.name as course_name, "  // 课程名称 - 列3
-                  "c.semester, "             // 学期 - 列4
-                  "t.class_time, "           // 上课时间 - 列5
-                  "t.classroom "             // 教室 - 列6
-                  "FROM teachings t "
-                  "LEFT JOIN teachers te ON t.teacher_id = te.teacher_id "
-                  "LEFT JOIN courses c ON t.course_id = c.course_id "
-                  // 排序规则：先按照学期逆序，然后按照课程ID顺序，再按照教师ID顺序
-                  "ORDER BY c.semester DESC, t.course_id ASC, t.teacher_id ASC";
-
-    QSqlQuery query(sql);
+    // 事务内的读取能看到本事务未提交的写入，既不能共享给其他线程也不能读别人的缓存
+    const bool shared = !Transaction::inTransaction();
 
-    while (query.next()) {
-        QMap<QString, QVariant> row;
-        QSqlRecord record = query.record();
-        for (int i = 0; i < record.count(); i++) {
-            row[record.fieldName(i)] = query.value(i);
+    std::shared_ptr<ReadFlight> flight;
+    quint64 generation = 0;
+    if (!shared) {
+        QMutexLocker locker(&m_readMutex);
+        m_readStats.executed++;
+    } else {
+        QMutexLocker locker(&m_readMutex);
+        auto cached = m_readCache.find(key);
+        if (cached != m_readCache.end()) {
+            if (m_readClock.elapsed() - cached->fetchedAt <= m_readCacheMs) {
+                m_readStats.cacheHits++;
+                return cached->rows;
+            }
+            m_readCache.erase(cached);
         }
-        result.append(row);
+
+        // 同一查询正在其他线程执行：等它完成后共享结果
+        std::shared_ptr<ReadFlight> running = m_readFlights.value(key);
+        if (running) {
+            m_readStats.coalesced++;
+            while (!running->finished) {
+                m_readFinished.wait(&m_readMutex);
+            }
+            return running->rows;
+        }
+
+        flight = std::make_shared<ReadFlight>();
+        m_readFlights.insert(key, flight);
+        generation = m_readGeneration;
+        m_readStats.executed++;
     }
 
-    return result;
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+    bool ok;
+    if (params.isEmpty()) {
+        ok = query.exec(sql);
+    } else {
+        query.prepare(sql);
+        for (const QVariant& param : params) {
+            query.addBindValue(param);
+        }
+        ok = query.exec();
+    }
+    QList<QMap<QString, QVariant>> rows;
+    if (ok) {
+        rows = readRows(query);
+    } else {
+        qWarning() << "查询失败:" << query.lastError().text();
+    }
+    if (!shared) return rows;
+
+    QMutexLocker locker(&m_readMutex);
+    flight->rows = rows;
+    flight->finished = true;
+    if (m_readFlights.value(key) == flight) {
+        m_readFlights.remove(key);
+    }
+    // 执行期间有写入时结果可能已过期：只交给已在等待的调用方，不进缓存
+    if (ok && generation == m_readGeneration && m_readCacheMs > 0) {
+        if (m_readCache.size() >= 256) {
+            const qint64 now = m_readClock.elapsed();
+            for (auto it = m_readCache.begin(); it != m_readCache.end();) {
+                it = now - it->fetchedAt > m_readCacheMs ? m_readCache.erase(it) : ++it;
+            }
+        }
+        m_readCache.insert(key, {rows, m_readClock.elapsed()});
+    }
+    m_readFinished.wakeAll();
+    return rows;
 }
 
-QList<QMap<QString, QVariant>> Database::getEnrollments()
+void Database::invalidateReadCache()
 {
-    QList<QMap<QString, QVariant>> result;
+    // 正在执行的查询也摘下，之后的调用方重新执行而不是等待写入前的结果
+    QMutexLocker locker(&m_readMutex);
+    m_readCache.clear();
+    m_readFlights.clear();
+    m_readGeneration++;
+}
 
-    // 表头顺序：{"学生学号", "学生姓名", "课程ID", "课程名称", "学期", "成绩"}
-    QString sql = "SELECT "
-                  "e.student_id, "           // 学生学号 - 列0
-                  "s.name as student_name, " // 学生姓名 - 列1
-                  "e.course_id, "            // 课程ID - 列2
-                  "c.name as course_name, "  // 课程名称 - 列3
-                  "c.semester, "             // 学期 - 列4
-                  "e.score "                 // 成绩 - 列5
-                  "FROM enrollments e "
-                  "LEFT JOIN students s ON e.student_id = s.student_id "
-                  "LEFT JOIN courses c ON e.course_id = c.course_id "
-                  // 排序规则：先按照学期逆序，然后按照课程ID顺序，再按照学生ID顺序
-                  "ORDER BY c.semester DESC, e.course_id ASC, e.student_id ASC";
-
-    QSqlQuery query(sql);
+Database::ReadStats Database::readStats() const
+{
+    QMutexLocker locker(&m_readMutex);
+    return m_readStats;
+}
 
-    while (query.next()) {
-        QMap<QString, QVariant> row;
-        QSqlRecord record = query.record();
-        for (int i = 0; i < record.count(); i++) {
-            row[record.fieldName(i)] = query.value(i);
-        }
-        result.append(row);
+void Database::notifyWrite(std::function<void()> notify)
+{
+    if (Transaction::deferUntilCommit(notify)) return;
+    {
+        QMutexLocker locker(&m_writeStatsMutex);
+        m_writeStats.autocommitWrites++;
     }
+    notify();
+}
 
-    return result;
+void Database::countTransaction(TransactionEvent event)
+{
+    QMutexLocker locker(&m_writeStatsMutex);
+    switch (event) {
+    case TransactionEvent::Commit: m_writeStats.commits++; break;
+    case TransactionEvent::Rollback: m_writeStats.rollbacks++; break;
+    case TransactionEvent::Savepoint: m_writeStats.savepoints++; break;
+    }
+}
+
+Database::WriteStats Database::writeStats() const
+{
+    QMutexLocker locker(&m_writeStatsMutex);
+    return m_writeStats;
+}
+
+QList<QMap<QString, QVariant>> Database::getTeachingGroups(int semesterId)
+{
+    return sharedRead(QString(kTeachingGroupsSql).arg(semesterWhere(semesterId)));
+}
+
+QList<QMap<QString, QVariant>> Database::getEnrollmentGroups(int semesterId)
+{
+    return sharedRead(QString(kEnrollmentGroupsSql).arg(semesterWhere(semesterId)));
+}
+
+QList<QMap<QString, QVariant>> Database::getCourseTeachings(int courseId, bool narrowFacts)
+{
+    const QString sql = narrowFacts
+        ? QString(kTeachingFactsSql).arg(QString("WHERE course_id = %1").arg(courseId))
+        : QString(kTeachingsSql).arg(QString("WHERE t.course_id = %1").arg(courseId));
+    return sharedRead(sql);
+}
+
+QList<QMap<QString, QVariant>> Database::getCourseEnrollments(int courseId, bool narrowFacts)
+{
+    // 宽行走 enrollment_view.idx_view_course，窄事实行走 enrollments.idx_course_student
+    const QString sql = narrowFacts
+        ? QString(kEnrollmentFactsSql).arg(QString("WHERE course_id = %1").arg(courseId))
+        : QString(kEnrollmentsSql).arg(QString("WHERE v.course_id = %1").arg(courseId));
+    return sharedRead(sql);
 }
 
 QList<QMap<QString, QVariant>> Database::getUsers()
 {
-    QList<QMap<QString, QVariant>> result;
+    return sharedRead(kUsersSql);
+}
+
+QList<QMap<QString, QVariant>> Database::getTeacherTeachings(int teacherId)
+{
+    return sharedRead(QString(kTeacherTeachingsSql).arg(teacherId));
+}
+
+QList<QMap<QString, QVariant>> Database::getRegistrationCourses(int studentId)
+{
+    return sharedRead(QString(kRegistrationCoursesSql).arg(studentId));
+}
+
+Database::RegistrationResult Database::registerCourse(int studentId, int courseId)
+{
+    // 单条自动提交的INSERT：名额检查和占用在 enrollment_seat_reserve 触发器中原子完成，
+    // 失败时整条语句回滚，因此遇到死锁/锁等待超时可以直接重试
+    const int maxAttempts = 3;
+    for (int attempt = 1; attempt <= maxAttempts; attempt++) {
+        QSqlQuery query(connection());
+        query.prepare("INSERT INTO enrollments (student_id, course_id, score) "
+                      "VALUES (:student_id, :course_id, 0)");
+        query.bindValue(":student_id", studentId);
+        query.bindValue(":course_id", courseId);
+
+        if (query.exec()) {
+            notifyWrite([this, studentId, courseId]() {
+                emit enrollmentScoreChanged(studentId, courseId, 0);
+            });
+            return RegistrationResult::Registered;
+        }
+
+        const QString errorCode = query.lastError().nativeErrorCode();
+        if (errorCode == "1062") {
+            // 重复选课；若是上一次提交成功但响应丢失后的重试，同样落在这里
+            return RegistrationResult::AlreadyEnrolled;
+        }
+        if (errorCode == "1644") {
+            return RegistrationResult::CourseFull;
+        }
+        if (errorCode == "1452") {
+            return RegistrationResult::NotFound;
+        }
+        if ((errorCode == "1213" || errorCode == "1205") && attempt < maxAttempts) {
+            qDebug() << "选课遇到锁冲突，重试" << attempt;
+            QThread::msleep(10 * attempt);
+            continue;
+        }
+
+        qWarning() << "选课失败:" << query.lastError().text();
+        break;
+    }
+    return RegistrationResult::Error;
+}
+
+bool Database::dropCourse(int studentId, int courseId)
+{
+    // 已评分的课程不能退选；名额由 enrollment_seat_release 触发器归还
+    QSqlQuery query(connection());
+    query.prepare("DELETE FROM enrollments WHERE student_id = :student_id "
+                  "AND course_id = :course_id AND (score IS NULL OR score <= 0)");
+    query.bindValue(":student_id", studentId);
+    query.bindValue(":course_id", courseId);
+
+    if (!query.exec() || query.numRowsAffected() <= 0) {
+        return false;
+    }
+
+    notifyWrite([this, studentId, courseId]() {
+        emit enrollmentScoreChanged(studentId, courseId, QVariant());
+        emit seatsReleased(courseId);
+    });
+    return true;
+}
+
+Database::WaitlistResult Database::joinWaitlist(int studentId, int courseId)
+{
+    // 已选的学生不入队；专业培养要求中列出的课程优先递补
+    QSqlQuery query(connection());
+    query.prepare("INSERT INTO waitlist (course_id, student_id, priority) "
+                  "SELECT c.course_id, s.student_id, "
+                  "IF(EXISTS (SELECT 1 FROM degree_requirements r "
+                  "           JOIN requirement_courses rc ON rc.requirement_id = r.requirement_id "
+                  "           WHERE r.program_id = s.program_id AND rc.course_id = c.course_id), 0, 1) "
+                  "FROM students s JOIN courses c ON c.course_id = :course_id "
+                  "WHERE s.student_id = :student_id "
+                  "AND NOT EXISTS (SELECT 1 FROM enrollments e "
+                  "                WHERE e.student_id = s.student_id AND e.course_id = c.course_id)");
+    query.bindValue(":course_id", courseId);
+    query.bindValue(":student_id", studentId);
+
+    if (!query.exec()) {
+        if (query.lastError().nativeErrorCode() == "1062") {
+            return WaitlistResult::AlreadyWaiting;
+        }
+        qWarning() << "加入候补失败:" << query.lastError().text();
+        return WaitlistResult::Error;
+    }
+    if (query.numRowsAffected() > 0) {
+        notifyWrite([this]() { invalidateReadCache(); });
+        return WaitlistResult::Joined;
+    }
+
+    QSqlQuery enrolledQuery(connection());
+    enrolledQuery.prepare("SELECT 1 FROM enrollments WHERE student_id = ? AND course_id = ?");
+    enrolledQuery.addBindValue(studentId);
+    enrolledQuery.addBindValue(courseId);
+    if (enrolledQuery.exec() && enrolledQuery.next()) {
+        return WaitlistResult::AlreadyEnrolled;
+    }
+    return WaitlistResult::NotFound;
+}
+
+bool Database::leaveWaitlist(int studentId, int courseId)
+{
+    QSqlQuery query(connection());
+    query.prepare("DELETE FROM waitlist WHERE student_id = ? AND course_id = ?");
+    query.addBindValue(studentId);
+    query.addBindValue(courseId);
+    if (!query.exec() || query.numRowsAffected() <= 0) return false;
+    notifyWrite([this]() { invalidateReadCache(); });
+    return true;
+}
+
+QList<QMap<QString, QVariant>> Database::getWaitlist(int courseId)
+{
+    QString sql = "SELECT w.id, w.course_id, w.student_id, s.name AS student_name, "
+                  "w.priority, w.requested_at "
+                  "FROM waitlist w JOIN students s ON w.student_id = s.student_id ";
+    if (courseId > 0) {
+        sql += QString("WHERE w.course_id = %1 ").arg(courseId);
+    }
+    sql += "ORDER BY w.course_id, w.priority, w.requested_at, w.id";
 
-    QString sql = "SELECT user_id, account, password, role FROM users ORDER BY user_id";
+    return sharedRead(sql);
+}
 
-    QSqlQuery query(sql);
+bool Database::waitlistEligibleStudents(int courseId, QSet<int>& eligible)
+{
+    // 与学生自己选课的检查一致：先修课全部通过、且与同学期已选课程没有时间冲突
+    QSqlQuery query(connection());
+    auto exec = [&query]() {
+        if (query.exec()) return true;
+        qWarning() << "检查候补资格失败:" << query.lastError().text();
+        return false;
+    };
 
+    query.prepare("SELECT DISTINCT student_id FROM waitlist WHERE course_id = ?");
+    query.addBindValue(courseId);
+    if (!exec()) return false;
     while (query.next()) {
-        QMap<QString, QVariant> row;
-        QSqlRecord record = query.record();
-        for (int i = 0; i < record.count(); i++) {
-            row[record.fieldName(i)] = query.value(i);
+        eligible.insert(query.value(0).toInt());
+    }
+    if (eligible.isEmpty()) return true;
+
+    query.prepare("WITH RECURSIVE required (course_id) AS ("
+                  "SELECT prerequisite_id FROM course_prerequisites WHERE course_id = ? "
+                  "UNION SELECT p.prerequisite_id FROM course_prerequisites p "
+                  "JOIN required r ON p.course_id = r.course_id) "
+                  "SELECT DISTINCT w.student_id FROM waitlist w JOIN required r "
+                  "WHERE w.course_id = ? AND NOT EXISTS (SELECT 1 FROM enrollments e "
+                  "WHERE e.student_id = w.student_id AND e.course_id = r.course_id "
+                  "AND e.score >= 60)");
+    query.addBindValue(courseId);
+    query.addBindValue(courseId);
+    if (!exec()) return false;
+    while (query.next()) {
+        eligible.remove(query.value(0).toInt());
+    }
+
+    query.prepare("SELECT class_time FROM teachings WHERE course_id = ?");
+    query.addBindValue(courseId);
+    if (!exec()) return false;
+    Timetable::Occupancy course;
+    while (query.next()) {
+        bool ok = false;
+        const QList<TimeSlot> timeSlots = Timetable::parse(query.value(0).toString(), &ok);
+        if (ok) course |= Timetable::toOccupancy(timeSlots);
+    }
+    if (course.none()) return true;
+
+    query.prepare("SELECT e.student_id, t.class_time FROM waitlist w "
+                  "JOIN courses target ON target.course_id = w.course_id "
+                  "JOIN enrollments e ON e.student_id = w.student_id AND e.course_id <> w.course_id "
+                  "JOIN courses c ON c.course_id = e.course_id "
+                  "AND IFNULL(c.semester_id, 0) = IFNULL(target.semester_id, 0) "
+                  "JOIN teachings t ON t.course_id = e.course_id "
+                  "WHERE w.course_id = ?");
+    query.addBindValue(courseId);
+    if (!exec()) return false;
+    while (query.next()) {
+        bool ok = false;
+        const QList<TimeSlot> timeSlots = Timetable::parse(query.value(1).toString(), &ok);
+        if (ok && (Timetable::toOccupancy(timeSlots) & course).any()) {
+            eligible.remove(query.value(0).toInt());
         }
-        result.append(row);
     }
+    return true;
+}
 
-    return result;
+int Database::promoteWaitlist(int courseId, int maxCount, QList<int>* promoted)
+{
+    // 课程行 FOR UPDATE 把同一课程的递补串行化（选课占用和退课归还名额的触发器也锁这一行），
+    // 锁内只读空余名额并用一条 INSERT ... SELECT 整批转为选课、删除候补；
+    // 资格检查（先修课、时间冲突）在加锁之前用普通读完成，不拖住同一课程的选课
+    if (promoted) promoted->clear();
+    QSet<int> eligible;
+    if (!waitlistEligibleStudents(courseId, eligible)) return -1;
+    // 没有候补或都不符合条件时不必锁课程行；检查之后才加入的学生由其加入时的递补处理
+    if (eligible.isEmpty()) return 0;
+
+    const int maxAttempts = 3;
+    for (int attempt = 1; attempt <= maxAttempts; attempt++) {
+        Transaction transaction;
+        QSqlQuery query(connection());
+        QList<int> students;
+
+        auto promoteBatch = [&]() -> bool {
+            query.prepare("SELECT capacity, enrolled_count FROM courses WHERE course_id = ? FOR UPDATE");
+            query.addBindValue(courseId);
+            if (!query.exec()) return false;
+            if (!query.next()) return true;
+            const int freeSeats = query.value(0).isNull()
+                ? maxCount : qMin(maxCount, query.value(0).toInt() - query.value(1).toInt());
+            if (freeSeats <= 0) return true;
+
+            // 已经通过其他途径选上的候补直接出队
+            query.prepare("DELETE w FROM waitlist w JOIN enrollments e "
+                          "ON e.student_id = w.student_id AND e.course_id = w.course_id "
+                          "WHERE w.course_id = ?");
+            query.addBindValue(courseId);
+            if (!query.exec()) return false;
+
+            // 不符合条件的学生跳过，留在队列中
+            query.prepare("SELECT id, student_id FROM waitlist WHERE course_id = ? "
+                          "ORDER BY priority, requested_at, id FOR UPDATE");
+            query.addBindValue(courseId);
+            if (!query.exec()) return false;
+            QStringList ids;
+            while (query.next() && ids.size() < freeSeats) {
+                const int studentId = query.value(1).toInt();
+                if (!eligible.contains(studentId)) continue;
+                ids << query.value(0).toString();
+                students << studentId;
+            }
+            if (ids.isEmpty()) return true;
+
+            // 名额仍由 enrollment_seat_reserve 触发器逐行占用，锁内不会超额
+            return query.exec(QString("INSERT INTO enrollments (student_id, course_id, score) "
+                                      "SELECT student_id, course_id, 0 FROM waitlist WHERE id IN (%1)")
+                                  .arg(ids.join(", ")))
+                && query.exec(QString("DELETE FROM waitlist WHERE id IN (%1)").arg(ids.join(", ")));
+        };
+
+        if (promoteBatch()) {
+            notifyWrite([this, courseId, students]() {
+                for (int studentId : students) {
+                    emit enrollmentScoreChanged(studentId, courseId, 0);
+                }
+            });
+            if (transaction.commit()) {
+                if (promoted) *promoted = students;
+                return students.size();
+            }
+        }
+
+        const QSqlError error = query.lastError().isValid() ? query.lastError() : transaction.lastError();
+        // 嵌套在外层事务中时，死锁会让整个外层事务回滚，只能由外层重试
+        const bool retryable = !transaction.isNested();
+        transaction.rollback();
+        const QString errorCode = error.nativeErrorCode();
+        if ((errorCode == "1213" || errorCode == "1205") && retryable && attempt < maxAttempts) {
+            qDebug() << "候补递补遇到锁冲突，重试" << attempt;
+            QThread::msleep(10 * attempt);
+            continue;
+        }
+        qWarning() << "候补递补失败:" << error.text();
+        break;
+    }
+    return -1;
+}
+
+QList<QMap<QString, QVariant>> Database::getCourseGradebook(int courseId)
+{
+    return sharedRead(QString(kCourseGradebookSql).arg(courseId));
+}
+
+bool Database::updateEnrollmentScores(int courseId, const QMap<int, QVariant>& scores,
+                                      QList<int>* staleStudents)
+{
+    if (staleStudents) staleStudents->clear();
+    if (scores.isEmpty()) return false;
+
+    // 同一课程的成绩按批合并成 UPDATE ... CASE，整体放在一个事务里只提交一次
+    const int batchSize = 200;
+    Transaction transaction;
+    QSqlQuery query(connection());
+    QMap<int, QVariant> matched;
+    auto it = scores.constBegin();
+    while (it != scores.constEnd()) {
+        QStringList cases, ids;
+        QList<QVariant> values;
+        for (int n = 0; n < batchSize && it != scores.constEnd(); n++, ++it) {
+            cases << QString("WHEN %1 THEN ?").arg(it.key());
+            ids << QString::number(it.key());
+            values << it.value();
+        }
+
+        // 成绩册页加载后可能有学生退选：锁住仍在课程中的选课行，只通知这些学生
+        if (!query.exec(QString("SELECT student_id FROM enrollments WHERE course_id = %1 "
+                                "AND student_id IN (%2) FOR UPDATE").arg(courseId).arg(ids.join(", ")))) {
+            qWarning() << "读取选课记录失败:" << query.lastError().text();
+            return false;
+        }
+        while (query.next()) {
+            const int studentId = query.value(0).toInt();
+            matched.insert(studentId, scores.value(studentId));
+        }
+
+        query.prepare(QString("UPDATE enrollments SET score = CASE student_id %1 END "
+                              "WHERE course_id = ? AND student_id IN (%2)")
+                          .arg(cases.join(" "), ids.join(", ")));
+        for (const QVariant& value : values) {
+            query.addBindValue(value);
+        }
+        query.addBindValue(courseId);
+
+        if (!query.exec()) {
+            qWarning() << "批量提交成绩失败:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    notifyWrite([this, courseId, matched]() {
+        for (auto score = matched.constBegin(); score != matched.constEnd(); ++score) {
+            emit enrollmentScoreChanged(score.key(), courseId, score.value());
+        }
+    });
+    if (!transaction.commit()) return false;
+    if (staleStudents) {
+        for (auto score = scores.constBegin(); score != scores.constEnd(); ++score) {
+            if (!matched.contains(score.key())) staleStudents->append(score.key());
+        }
+    }
+    return true;
+}
+
+QList<QMap<QString, QVariant>> Database::getStudentEnrollments(int studentId)
+{
+    return sharedRead(QString(kStudentEnrollmentsSql).arg(studentId));
+}
+
+// 窗口初始化
+QList<QList<QMap<QString, QVariant>>> Database::callMultiResult(const QString& callSql)
+{
+    QList<QList<QMap<QString, QVariant>>> resultSets;
+
+    // 多结果集只能走文本协议，参数均为整数，直接拼入语句
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+    if (!query.exec(callSql)) {
+        qWarning() << "初始化查询失败:" << query.lastError().text() << "\nSQL:" << callSql;
+        return resultSets;
+    }
+
+    // 必须读完所有结果集（包括CALL末尾的状态结果），否则连接会处于不同步状态
+    do {
+        if (query.isSelect()) {
+            resultSets.append(readRows(query));
+        }
+    } while (query.nextResult());
+
+    return resultSets;
+}
+
+QList<QList<QMap<QString, QVariant>>> Database::bootstrapAdmin()
+{
+    // 结果集：学生、教师、课程、授课分组、选课分组、用户、学期
+    return callMultiResult("CALL sp_bootstrap_admin()");
+}
+
+QList<QList<QMap<QString, QVariant>>> Database::bootstrapTeacher(int teacherId)
+{
+    // 结果集：教师信息、我的授课（成绩册按课程单独加载）
+    return callMultiResult(QString("CALL sp_bootstrap_teacher(%1)").arg(teacherId));
+}
+
+QList<QList<QMap<QString, QVariant>>> Database::bootstrapStudent(int studentId)
+{
+    // 结果集：学生信息、我的选课
+    return callMultiResult(QString("CALL sp_bootstrap_student(%1)").arg(studentId));
 }
 
 // 用户管理
 bool Database::addUser(const QString& account, const QString& password, int role)
 {
+    // 检查和写入在同一事务中，只提交一次；提前返回时回滚
+    UnitOfWork work;
+
     // 检查是否已存在管理员（应用层检查，提供友好提示）
     if (role == 2) { // 管理员角色
-        QSqlQuery checkAdminQuery("SELECT COUNT(*) FROM users WHERE role = 2");
+        QSqlQuery checkAdminQuery("SELECT COUNT(*) FROM users WHERE role = 2", connection());
         if (checkAdminQuery.exec() && checkAdminQuery.next()) {
             if (checkAdminQuery.value(0).toInt() > 0) {
                 qWarning() << "添加用户失败：系统中已存在管理员，不能创建新的管理员";
@@ -445,7 +2292,7 @@ bool Database::addUser(const QString& account, const QString& password, int role
     }
 
     // 检查用户名是否已存在
-    QSqlQuery checkUserQuery;
+    QSqlQuery checkUserQuery(connection());
     checkUserQuery.prepare("SELECT COUNT(*) FROM users WHERE account = ?");
     checkUserQuery.addBindValue(account);
     if (checkUserQuery.exec() && checkUserQuery.next() && checkUserQuery.value(0).toInt() > 0) {
@@ -462,7 +2309,7 @@ bool Database::addUser(const QString& account, const QString& password, int role
             return false;
         }
 
-        QSqlQuery checkStudentQuery;
+        QSqlQuery checkStudentQuery(connection());
         checkStudentQuery.prepare("SELECT COUNT(*) FROM students WHERE student_id = ?");
         checkStudentQuery.addBindValue(studentId);
         if (checkStudentQuery.exec() && checkStudentQuery.next() &&
@@ -478,7 +2325,7 @@ bool Database::addUser(const QString& account, const QString& password, int role
             return false;
         }
 
-        QSqlQuery checkTeacherQuery;
+        QSqlQuery checkTeacherQuery(connection());
         checkTeacherQuery.prepare("SELECT COUNT(*) FROM teachers WHERE teacher_id = ?");
         checkTeacherQuery.addBindValue(teacherId);
         if (checkTeacherQuery.exec() && checkTeacherQuery.next() &&
@@ -493,9 +2340,10 @@ bool Database::addUser(const QString& account, const QString& password, int role
     data["password"] = password;
     data["role"] = role;
 
-    bool success = executeInsert("users", data);
+    work.insert("users", data);
+    bool success = work.commit();
     if (!success) {
-        qWarning() << "添加用户失败：" << QSqlDatabase::database().lastError().text();
+        qWarning() << "添加用户失败：" << connection().lastError().text();
     }
     return success;
 }
@@ -504,7 +2352,7 @@ bool Database::updateUser(int userId, const QString& account, const QString& pas
                           int role)
 {
     // 先获取用户当前的角色
-    QSqlQuery getCurrentRoleQuery;
+    QSqlQuery getCurrentRoleQuery(connection());
     getCurrentRoleQuery.prepare("SELECT role FROM users WHERE user_id = ?");
     getCurrentRoleQuery.addBindValue(userId);
     int currentRole = -1;
@@ -517,7 +2365,7 @@ bool Database::updateUser(int userId, const QString& account, const QString& pas
 
     // 检查是否要设置为管理员（应用层检查）
     if (role == 2 && currentRole != 2) {
-        QSqlQuery checkAdminQuery("SELECT COUNT(*) FROM users WHERE role = 2");
+        QSqlQuery checkAdminQuery("SELECT COUNT(*) FROM users WHERE role = 2", connection());
         if (checkAdminQuery.exec() && checkAdminQuery.next()) {
             if (checkAdminQuery.value(0).toInt() > 0) {
                 qWarning() << "更新用户失败：系统中已存在管理员，不能设置新的管理员";
@@ -527,7 +2375,7 @@ bool Database::updateUser(int userId, const QString& account, const QString& pas
     }
 
     // 检查账号是否已存在（排除当前用户）
-    QSqlQuery checkUserQuery;
+    QSqlQuery checkUserQuery(connection());
     checkUserQuery.prepare("SELECT COUNT(*) FROM users WHERE account = ? AND user_id != ?");
     checkUserQuery.addBindValue(account);
     checkUserQuery.addBindValue(userId);
@@ -545,7 +2393,7 @@ bool Database::updateUser(int userId, const QString& account, const QString& pas
             return false;
         }
 
-        QSqlQuery checkStudentQuery;
+        QSqlQuery checkStudentQuery(connection());
         checkStudentQuery.prepare("SELECT COUNT(*) FROM students WHERE student_id = ?");
         checkStudentQuery.addBindValue(studentId);
         if (checkStudentQuery.exec() && checkStudentQuery.next() &&
@@ -561,7 +2409,7 @@ bool Database::updateUser(int userId, const QString& account, const QString& pas
             return false;
         }
 
-        QSqlQuery checkTeacherQuery;
+        QSqlQuery checkTeacherQuery(connection());
         checkTeacherQuery.prepare("SELECT COUNT(*) FROM teachers WHERE teacher_id = ?");
         checkTeacherQuery.addBindValue(teacherId);
         if (checkTeacherQuery.exec() && checkTeacherQuery.next() &&
@@ -578,16 +2426,18 @@ bool Database::updateUser(int userId, const QString& account, const QString& pas
 
     bool success = executeUpdate("users", userId, data);
     if (!success) {
-        qWarning() << "更新用户失败：" << QSqlDatabase::database().lastError().text();
+        qWarning() << "更新用户失败：" << connection().lastError().text();
     }
     return success;
 }
 
 bool Database::deleteUser(int userId)
 {
-    // 先检查要删除的用户是否是管理员
-    QSqlQuery checkRoleQuery;
-    checkRoleQuery.prepare("SELECT role FROM users WHERE user_id = ?");
+    UnitOfWork work;
+
+    // 先检查要删除的用户是否是管理员；锁住该行，检查到删除之间角色不会被改成管理员
+    QSqlQuery checkRoleQuery(connection());
+    checkRoleQuery.prepare("SELECT role FROM users WHERE user_id = ? FOR UPDATE");
     checkRoleQuery.addBindValue(userId);
     if (checkRoleQuery.exec() && checkRoleQuery.next()) {
         int role = checkRoleQuery.value(0).toInt();
@@ -597,7 +2447,8 @@ bool Database::deleteUser(int userId)
         }
     }
 
-    return executeDelete("users", userId);
+    work.remove("users", userId);
+    return work.commit();
 }
 
 bool Database::checkUsernameExists(const QString& account, int excludeUserId)
@@ -662,7 +2513,7 @@ QString Database::executeSQL(const QString& sql)
 
         allResults += QString("SQL: %1\n").arg(statement);
 
-        QSqlQuery query;
+        QSqlQuery query(connection());
         bool success = query.exec(statement);
 
         if (success) {
@@ -702,6 +2553,8 @@ QString Database::executeSQL(const QString& sql)
                 } else {
                     allResults += "执行成功\n";
                 }
+                // 任意写语句都可能改动成绩，内存派生数据整体失效
+                notifyWrite([this]() { emit enrollmentDataInvalidated(); });
             }
             successCount++;
         } else {
@@ -733,7 +2586,7 @@ bool Database::updateTeaching(int teacherId, int courseId, const QVariantMap& da
                           "AND course_id = :course_id")
                       .arg(updates.join(", "));
 
-    QSqlQuery query;
+    QSqlQuery query(connection());
     query.prepare(sql);
     query.bindValue(":teacher_id", teacherId);
     query.bindValue(":course_id", courseId);
@@ -742,7 +2595,9 @@ bool Database::updateTeaching(int teacherId, int courseId, const QVariantMap& da
         query.bindValue(":" + it.key(), it.value());
     }
 
-    return query.exec();
+    if (!query.exec()) return false;
+    notifyWrite([this]() { invalidateReadCache(); });
+    return true;
 }
 
 
@@ -751,12 +2606,14 @@ bool Database::deleteTeaching(int teacherId, int courseId)
     QString sql = "DELETE FROM teachings WHERE teacher_id = :teacher_id "
                   "AND course_id = :course_id";
 
-    QSqlQuery query;
+    QSqlQuery query(connection());
     query.prepare(sql);
     query.bindValue(":teacher_id", teacherId);
     query.bindValue(":course_id", courseId);
 
-    return query.exec();
+    if (!query.exec()) return false;
+    notifyWrite([this]() { invalidateReadCache(); });
+    return true;
 }
 
 bool Database::updateEnrollment(int studentId, int courseId, const QVariantMap& data)
@@ -772,7 +2629,7 @@ bool Database::updateEnrollment(int studentId, int courseId, const QVariantMap&
                           "AND course_id = :course_id")
                       .arg(updates.join(", "));
 
-    QSqlQuery query;
+    QSqlQuery query(connection());
     query.prepare(sql);
     query.bindValue(":student_id", studentId);
     query.bindValue(":course_id", courseId);
@@ -781,7 +2638,17 @@ bool Database::updateEnrollment(int studentId, int courseId, const QVariantMap&
         query.bindValue(":" + it.key(), it.value());
     }
 
-    return query.exec();
+    if (!query.exec()) return false;
+
+    if (data.contains("score")) {
+        const QVariant score = data["score"];
+        notifyWrite([this, studentId, courseId, score]() {
+            emit enrollmentScoreChanged(studentId, courseId, score);
+        });
+    } else {
+        notifyWrite([this]() { invalidateReadCache(); });
+    }
+    return true;
 }
 
 bool Database::deleteEnrollment(int studentId, int courseId)
@@ -789,10 +2656,18 @@ bool Database::deleteEnrollment(int studentId, int courseId)
     QString sql = "DELETE FROM enrollments WHERE student_id = :student_id "
                   "AND course_id = :course_id";
 
-    QSqlQuery query;
+    QSqlQuery query(connection());
     query.prepare(sql);
     query.bindValue(":student_id", studentId);
     query.bindValue(":course_id", courseId);
 
-    return query.exec();
+    if (!query.exec()) return false;
+
+    if (query.numRowsAffected() > 0) {
+        notifyWrite([this, studentId, courseId]() {
+            emit enrollmentScoreChanged(studentId, courseId, QVariant());
+            emit seatsReleased(courseId);
+        });
+    }
+    return true;
 }
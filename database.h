@@ -8,6 +8,13 @@
 #include <QVariant>
 #include <QMap>
 #include <QSettings>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <memory>
+#include <functional>
 
 class Database : public QObject
 {
@@ -21,14 +28,44 @@ public:
                  const QString& password = "123456",
                  int port = 3306);
     bool isConnected() const;
+    // 当前线程使用的连接：主线程为默认连接，其他线程各自独立一条
+    QSqlDatabase connection() const;
 
     // 数据库配置
     void saveDatabaseConfig();
     void loadDatabaseConfig();
 
+    // 授课/选课是否只取窄事实行并在客户端关联维度表（见 DimensionCache）
+    bool isClientJoinEnabled() const;
+    void setClientJoinEnabled(bool enabled);
+
+    // 读查询合并：相同SQL（含绑定参数）同时在执行的只执行一次、共享结果，
+    // 结果在 Performance/ReadCacheMs 毫秒内（默认500，0为关闭）再次请求时直接复用，任何写入后失效
+    struct ReadStats {
+        qint64 executed = 0;        // 实际执行的查询
+        qint64 coalesced = 0;       // 等待同一条正在执行的查询并共享结果
+        qint64 cacheHits = 0;       // 新鲜期内直接复用结果
+    };
+    ReadStats readStats() const;
+    // 绕过 Database 写入数据后由调用方通知（例如自动排课的写回）
+    void invalidateReadCache();
+
+    // 写入提交统计（见 Transaction/UnitOfWork）：提交和回滚只计最外层事务
+    struct WriteStats {
+        qint64 commits = 0;
+        qint64 rollbacks = 0;
+        qint64 savepoints = 0;          // 嵌套事务
+        qint64 autocommitWrites = 0;    // 不在事务内、各自提交一次的通用写入
+    };
+    WriteStats writeStats() const;
+
     // 通用操作
-    bool executeInsert(const QString& table, const QVariantMap& data);
-    bool executeUpdate(const QString& table, int id, const QVariantMap& data);
+    bool executeInsert(const QString& table, const QVariantMap& rawData);
+    bool executeUpdate(const QString& table, int id, const QVariantMap& rawData);
+    // 带行版本检查的更新（students/teachers/courses）：expectedVersion 与库中不一致时不写入
+    enum class UpdateResult { Success, Conflict, Error };
+    UpdateResult executeUpdate(const QString& table, int id, const QVariantMap& rawData,
+                               int expectedVersion, int* newVersion = nullptr);
     bool executeDelete(const QString& table, int id);
     QList<QMap<QString, QVariant>> executeSelect(const QString& table,
                                                  const QString& condition = "");
@@ -40,10 +77,64 @@ public:
     bool deleteEnrollment(int studentId, int courseId);
 
     // 特殊查询
-    QList<QMap<QString, QVariant>> getTeachings();
-    QList<QMap<QString, QVariant>> getEnrollments();
     QList<QMap<QString, QVariant>> getUsers();
 
+    // 授课/选课分组树：每门课程一行汇总（子行数、选课人数、平均分），展开时再按课程取明细
+    // （semesterId 为0时不过滤学期）
+    QList<QMap<QString, QVariant>> getTeachingGroups(int semesterId = 0);
+    QList<QMap<QString, QVariant>> getEnrollmentGroups(int semesterId = 0);
+    // narrowFacts 为true时只返回窄事实行，由 DimensionCache 关联名称
+    QList<QMap<QString, QVariant>> getCourseTeachings(int courseId, bool narrowFacts = false);
+    QList<QMap<QString, QVariant>> getCourseEnrollments(int courseId, bool narrowFacts = false);
+
+    // 学期维度
+    QList<QMap<QString, QVariant>> getSemesters();
+    bool setCurrentSemester(int semesterId);
+    // 学期名称转整数排序键 year*10+term，无法识别时返回0
+    static int semesterKey(const QString& name);
+
+    // 选课读模型 enrollment_view 的全量重建（平时由触发器增量维护）
+    bool rebuildEnrollmentView();
+    // 选课多维汇总 enrollment_cube 的全量重建（平时由触发器按增量维护）
+    bool rebuildEnrollmentCube();
+    // 汇总总人次是否等于重建时按同样连接统计的选课行数
+    bool isEnrollmentCubeConsistent();
+
+    // 学生学分/GPA汇总的全量修复：按学号区间并行重算，每个线程使用独立连接，
+    // 工作线程沿用调用线程的优先级。workerCount<=0 时取CPU核数；
+    // onRange 在每个分片完成后从工作线程调用，返回 false 时其余分片不再执行。
+    // 返回更新行数，有分片失败或被停止时返回-1
+    int recomputeStudentTotals(int workerCount = 0,
+                               const std::function<bool(int done, int total)>& onRange = nullptr);
+    QList<QMap<QString, QVariant>> getTeacherTeachings(int teacherId);
+    // 成绩册：单门课程的学生成绩；批量成绩在一个事务中提交（studentId -> score），
+    // 已不在该课程中（加载后退选）的学生不写入也不通知，学号放入 staleStudents
+    QList<QMap<QString, QVariant>> getCourseGradebook(int courseId);
+    bool updateEnrollmentScores(int courseId, const QMap<int, QVariant>& scores,
+                                QList<int>* staleStudents = nullptr);
+    QList<QMap<QString, QVariant>> getStudentEnrollments(int studentId);
+
+    // 学生选课：名额在单条INSERT内原子占用，结果区分已满/重复
+    enum class RegistrationResult { Registered, AlreadyEnrolled, CourseFull, NotFound, Error };
+    QList<QMap<QString, QVariant>> getRegistrationCourses(int studentId);
+    RegistrationResult registerCourse(int studentId, int courseId);
+    bool dropCourse(int studentId, int courseId);
+
+    // 候补：课程满员时排队，名额释放后按 优先级→申请时间 递补（见 WaitlistService）
+    enum class WaitlistResult { Joined, AlreadyWaiting, AlreadyEnrolled, NotFound, Error };
+    WaitlistResult joinWaitlist(int studentId, int courseId);
+    bool leaveWaitlist(int studentId, int courseId);
+    QList<QMap<QString, QVariant>> getWaitlist(int courseId = 0);
+    // 在一个事务内把排在最前的、符合选课条件的候补转为选课，最多 maxCount 人；
+    // 返回递补人数，失败（包括锁等待超时）返回-1
+    int promoteWaitlist(int courseId, int maxCount, QList<int>* promoted = nullptr);
+
+    // 窗口初始化：一次往返取回角色窗口需要的全部结果集（存储过程多结果集）
+    // 结果集顺序见 createProcedures()，调用失败时返回空列表
+    QList<QList<QMap<QString, QVariant>>> bootstrapAdmin();
+    QList<QList<QMap<QString, QVariant>>> bootstrapTeacher(int teacherId);
+    QList<QList<QMap<QString, QVariant>>> bootstrapStudent(int studentId);
+
     // 用户管理
     bool addUser(const QString& account, const QString& password, int role);
     bool updateUser(int userId, const QString& account, const QString& password, int role);
@@ -57,14 +148,61 @@ public:
     bool validateUser(const QString& username, const QString& password,
                       int role, int& userId);
 
+signals:
+    // 以下信号在执行写入的线程上发出，可能是工作线程：连接时以 Database 为上下文对象，
+    // 槽会排队到主线程执行；直接连接的接收方须自行加锁
+    // 单条选课成绩变化（score 无效表示该选课已删除），供内存派生数据增量维护
+    void enrollmentScoreChanged(int studentId, int courseId, const QVariant& score);
+    // 选课/课程发生无法逐条追踪的修改，内存派生数据需整体失效
+    void enrollmentDataInvalidated();
+    // 课程可能有了空余名额（退课、删除选课或修改容量），候补可以递补
+    void seatsReleased(int courseId);
+    // 通用增删改成功后发出：data 为写入的字段（新增时含主键），删除时为空
+    void recordChanged(const QString& table, int id, const QVariantMap& data);
+
 private:
+    friend class Transaction;
+
     explicit Database(QObject *parent = nullptr);
     Database(const Database&) = delete;
     Database& operator=(const Database&) = delete;
 
     void createTables();
+    void createProcedures();
+    void migrateSchema();
+
+    // 结构升级辅助
+    bool columnExists(const QString& table, const QString& column);
+    bool indexExists(const QString& table, const QString& index);
+    bool constraintExists(const QString& table, const QString& constraint);
+    void addColumnIfMissing(const QString& table, const QString& column,
+                            const QString& definition);
+    void addIndexIfMissing(const QString& table, const QString& index,
+                           const QString& definition);
+
+    // 学期维度维护
+    int ensureSemester(const QString& name);
+    void syncSemesters();
+    QVariantMap withSemesterKey(const QString& table, const QVariantMap& data);
     bool createDatabaseIfNotExists();
 
+    // 候补中先修课已通过、与同学期已选课程不冲突的学生，不加锁读取
+    bool waitlistEligibleStudents(int courseId, QSet<int>& eligible);
+
+    // 读取当前结果集的所有行
+    static QList<QMap<QString, QVariant>> readRows(QSqlQuery& query);
+    // 经过合并和短期缓存的读查询，见 readStats()
+    QList<QMap<QString, QVariant>> sharedRead(const QString& sql,
+                                              const QVariantList& params = QVariantList());
+    // 写入成功后的通知：事务内推迟到最外层提交后（回滚则丢弃），否则立即执行并计为一次自动提交写入；
+    // 所有写接口的信号和读缓存失效都经过这里
+    void notifyWrite(std::function<void()> notify);
+    enum class TransactionEvent { Commit, Rollback, Savepoint };
+    void countTransaction(TransactionEvent event);
+
+    // 执行CALL并收集存储过程返回的全部结果集
+    QList<QList<QMap<QString, QVariant>>> callMultiResult(const QString& callSql);
+
     // 数据库连接信息
     QString m_host;
     QString m_database;
@@ -74,6 +212,27 @@ private:
 
     // 主键映射
     QMap<QString, QString> m_primaryKeys;
+
+    // 读查询合并与短期缓存，均由 m_readMutex 保护
+    struct ReadFlight {
+        bool finished = false;
+        QList<QMap<QString, QVariant>> rows;
+    };
+    struct CachedRead {
+        QList<QMap<QString, QVariant>> rows;
+        qint64 fetchedAt;
+    };
+    mutable QMutex m_readMutex;
+    QWaitCondition m_readFinished;
+    QHash<QString, std::shared_ptr<ReadFlight>> m_readFlights;
+    QHash<QString, CachedRead> m_readCache;
+    quint64 m_readGeneration = 0;       // 每次写入递增，执行期间有写入的结果不进缓存
+    ReadStats m_readStats;
+    QElapsedTimer m_readClock;
+    int m_readCacheMs = 500;
+
+    mutable QMutex m_writeStatsMutex;
+    WriteStats m_writeStats;
 };
 
 #endif // DATABASE_H
@@ -0,0 +1,460 @@
+#include "degreeaudit.h"
+#include "database.h"
+#include "transaction.h"
+#include "jobscheduler.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+#include <QThreadPool>
+#include <QDebug>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+
+constexpr int kInsertBatch = 1000;
+
+} // namespace
+
+DegreeAudit& DegreeAudit::getInstance()
+{
+    static DegreeAudit instance;
+    return instance;
+}
+
+DegreeAudit::DegreeAudit()
+{
+    Database& db = Database::getInstance();
+    QObject::connect(&db, &Database::enrollmentScoreChanged, &db,
+                     [this](int studentId, int courseId, const QVariant& score) {
+                         onScoreChanged(studentId, courseId, score);
+                     });
+    QObject::connect(&db, &Database::enrollmentDataInvalidated, &db, [this]() { onDataInvalidated(); });
+}
+
+void DegreeAudit::invalidate()
+{
+    m_snapshot = Snapshot();
+    m_loaded = false;
+}
+
+bool DegreeAudit::ensureLoaded()
+{
+    if (!m_loaded) m_loaded = loadSnapshot(m_snapshot);
+    return m_loaded;
+}
+
+bool DegreeAudit::isMaintained()
+{
+    // 做过全量审核（包括以前的运行）才增量维护；还没审核过时下次全量审核自然包含
+    if (m_audited < 0) {
+        QSqlQuery query(Database::getInstance().connection());
+        if (!query.exec("SELECT EXISTS (SELECT 1 FROM degree_audit)") || !query.next()) {
+            qWarning() << "查询学位审核结果失败:" << query.lastError().text();
+            return false;
+        }
+        m_audited = query.value(0).toBool() ? 1 : 0;
+    }
+    return m_audited > 0;
+}
+
+bool DegreeAudit::loadSnapshot(Snapshot& snapshot)
+{
+    snapshot = Snapshot();
+    QSqlDatabase db = Database::getInstance().connection();
+
+    QSqlQuery courseQuery(db);
+    courseQuery.setForwardOnly(true);
+    if (!courseQuery.exec("SELECT course_id, IFNULL(credit, 0) FROM courses")) {
+        qWarning() << "载入课程失败:" << courseQuery.lastError().text();
+        return false;
+    }
+    while (courseQuery.next()) {
+        snapshot.courseIndex.insert(courseQuery.value(0).toInt(), static_cast<int>(snapshot.credits.size()));
+        snapshot.credits.push_back(courseQuery.value(1).toFloat());
+    }
+    const size_t courseCount = snapshot.credits.size();
+
+    QSqlQuery requirementQuery(db);
+    requirementQuery.setForwardOnly(true);
+    if (!requirementQuery.exec("SELECT r.program_id, r.requirement_id, r.kind, "
+                               "IFNULL(r.min_credits, 0), rc.course_id "
+                               "FROM degree_requirements r "
+                               "LEFT JOIN requirement_courses rc ON r.requirement_id = rc.requirement_id "
+                               "ORDER BY r.program_id, r.requirement_id")) {
+        qWarning() << "载入培养要求失败:" << requirementQuery.lastError().text();
+        return false;
+    }
+    while (requirementQuery.next()) {
+        const int programId = requirementQuery.value(0).toInt();
+        if (!snapshot.programIndex.contains(programId)) {
+            snapshot.programIndex.insert(programId, static_cast<int>(snapshot.programs.size()));
+            snapshot.programs.emplace_back();
+        }
+        auto& requirements = snapshot.programs[snapshot.programIndex.value(programId)];
+
+        const int requirementId = requirementQuery.value(1).toInt();
+        if (requirements.empty() || requirements.back().id != requirementId) {
+            requirements.push_back({requirementId, requirementQuery.value(2).toString() == "courses",
+                                    requirementQuery.value(3).toDouble(), true,
+                                    std::vector<char>(courseCount, 0), {}});
+        }
+        if (requirementQuery.value(4).isNull()) continue;
+
+        const int course = snapshot.courseIndex.value(requirementQuery.value(4).toInt(), -1);
+        if (course < 0) continue;
+        Requirement& requirement = requirements.back();
+        requirement.anyCourse = false;
+        requirement.member[course] = 1;
+        requirement.courses.push_back(course);
+    }
+
+    QSqlQuery studentQuery(db);
+    studentQuery.setForwardOnly(true);
+    if (!studentQuery.exec("SELECT student_id, program_id FROM students")) {
+        qWarning() << "载入学生失败:" << studentQuery.lastError().text();
+        return false;
+    }
+    if (studentQuery.size() > 0) snapshot.students.reserve(studentQuery.size());
+    while (studentQuery.next()) {
+        const int studentId = studentQuery.value(0).toInt();
+        const QVariant programId = studentQuery.value(1);
+        snapshot.studentIndex.insert(studentId, static_cast<int>(snapshot.students.size()));
+        snapshot.students.push_back({studentId,
+                                     programId.isNull() ? -1 : snapshot.programIndex.value(programId.toInt(), -1),
+                                     {}});
+    }
+
+    QSqlQuery passedQuery(db);
+    passedQuery.setForwardOnly(true);
+    if (!passedQuery.exec("SELECT student_id, course_id FROM enrollments WHERE score >= 60")) {
+        qWarning() << "载入已通过课程失败:" << passedQuery.lastError().text();
+        return false;
+    }
+    while (passedQuery.next()) {
+        const int student = snapshot.studentIndex.value(passedQuery.value(0).toInt(), -1);
+        const int course = snapshot.courseIndex.value(passedQuery.value(1).toInt(), -1);
+        if (student >= 0 && course >= 0) snapshot.students[student].passed.push_back(course);
+    }
+
+    return true;
+}
+
+void DegreeAudit::evaluate(const Snapshot& snapshot, const StudentRecord& student,
+                           std::vector<char>& mark, Status* out)
+{
+    const auto& requirements = snapshot.programs[student.program];
+
+    float totalCredits = 0;
+    for (int course : student.passed) {
+        mark[course] = 1;
+        totalCredits += snapshot.credits[course];
+    }
+
+    for (size_t i = 0; i < requirements.size(); i++) {
+        const Requirement& requirement = requirements[i];
+        Status& status = out[i];
+        status.studentId = student.studentId;
+        status.requirementId = requirement.id;
+
+        if (requirement.courseList) {
+            int passed = 0;
+            for (int course : requirement.courses) passed += mark[course];
+            status.earned = static_cast<float>(passed);
+            status.satisfied = passed == static_cast<int>(requirement.courses.size());
+        } else {
+            float credits = totalCredits;
+            if (!requirement.anyCourse) {
+                credits = 0;
+                for (int course : student.passed) {
+                    if (requirement.member[course]) credits += snapshot.credits[course];
+                }
+            }
+            status.earned = credits;
+            status.satisfied = credits + 1e-3 >= requirement.minCredits;
+        }
+    }
+
+    for (int course : student.passed) mark[course] = 0;
+}
+
+bool DegreeAudit::auditAll(Summary* summary, int workerCount)
+{
+    Summary result;
+    QElapsedTimer timer;
+    timer.start();
+
+    Snapshot snapshot;
+    if (!loadSnapshot(snapshot)) return false;
+    result.loadMs = timer.restart();
+    const std::vector<StudentRecord>& students = snapshot.students;
+
+    // 每个学生的结果在输出数组中的起始位置，各线程直接写自己负责的区段
+    std::vector<size_t> offsets(students.size() + 1, 0);
+    for (size_t s = 0; s < students.size(); s++) {
+        const int program = students[s].program;
+        offsets[s + 1] = offsets[s] + (program < 0 ? 0 : snapshot.programs[program].size());
+        if (program < 0) {
+            result.unassigned++;
+        } else {
+            result.students++;
+        }
+    }
+    std::vector<Status> statuses(offsets.back());
+
+    if (workerCount <= 0) workerCount = qMax(1, QThread::idealThreadCount());
+    const int chunkCount = workerCount * 4;
+    const size_t chunkSize = (students.size() + chunkCount - 1) / chunkCount;
+    QList<int> chunks;
+    for (int i = 0; i < chunkCount; i++) chunks << i;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(workerCount);
+    pool.setThreadPriority(QThread::currentThread()->priority());
+    Status* output = statuses.data();
+    QtConcurrent::blockingMap(&pool, chunks, [&](int chunk) {
+        std::vector<char> mark(snapshot.credits.size(), 0);
+        const size_t begin = chunk * chunkSize;
+        const size_t end = std::min(students.size(), begin + chunkSize);
+        for (size_t s = begin; s < end; s++) {
+            if (students[s].program >= 0) evaluate(snapshot, students[s], mark, output + offsets[s]);
+        }
+    });
+
+    for (size_t s = 0; s < students.size(); s++) {
+        if (students[s].program < 0) continue;
+        bool allSatisfied = true;
+        for (size_t i = offsets[s]; i < offsets[s + 1]; i++) {
+            allSatisfied = allSatisfied && statuses[i].satisfied;
+        }
+        if (allSatisfied) result.fullySatisfied++;
+    }
+    result.rows = static_cast<int>(statuses.size());
+    result.auditMs = timer.restart();
+
+    // 整表替换
+    const bool ok = writeStatuses(statuses, QList<int>());
+    result.writeMs = timer.elapsed();
+
+    qDebug() << "学位审核: 学生" << result.students << "结果" << result.rows << "条, 载入"
+             << result.loadMs << "毫秒, 审核" << result.auditMs << "毫秒, 写入" << result.writeMs << "毫秒";
+    if (summary) *summary = result;
+    return ok;
+}
+
+bool DegreeAudit::auditStudent(int studentId)
+{
+    if (!isMaintained() || m_auditJob) return false;
+    if (!ensureLoaded()) return false;
+
+    // 专业可能被修改过，单个学生的记录直接从数据库重新读取
+    QSqlDatabase db = Database::getInstance().connection();
+    QSqlQuery query(db);
+    query.prepare("SELECT s.program_id, e.course_id FROM students s "
+                  "LEFT JOIN enrollments e ON e.student_id = s.student_id AND e.score >= 60 "
+                  "WHERE s.student_id = ?");
+    query.addBindValue(studentId);
+    if (!query.exec()) {
+        qWarning() << "载入学生审核数据失败:" << query.lastError().text();
+        return false;
+    }
+
+    StudentRecord record{studentId, -1, {}};
+    bool found = false;
+    while (query.next()) {
+        found = true;
+        if (!query.value(0).isNull()) record.program = m_snapshot.programIndex.value(query.value(0).toInt(), -1);
+        const int course = query.value(1).isNull() ? -1 : m_snapshot.courseIndex.value(query.value(1).toInt(), -1);
+        if (course >= 0) record.passed.push_back(course);
+    }
+    if (!found) return false;
+
+    if (m_snapshot.studentIndex.contains(studentId)) {
+        m_snapshot.students[m_snapshot.studentIndex.value(studentId)] = record;
+    } else {
+        m_snapshot.studentIndex.insert(studentId, static_cast<int>(m_snapshot.students.size()));
+        m_snapshot.students.push_back(record);
+    }
+    m_dirty.remove(studentId);
+
+    std::vector<Status> statuses;
+    if (record.program >= 0) {
+        statuses.resize(m_snapshot.programs[record.program].size());
+        std::vector<char> mark(m_snapshot.credits.size(), 0);
+        evaluate(m_snapshot, record, mark, statuses.data());
+    }
+    return writeStatuses(statuses, {studentId});
+}
+
+void DegreeAudit::onScoreChanged(int studentId, int courseId, const QVariant& score)
+{
+    if (!isMaintained()) return;
+
+    // 快照已载入时直接更新；新学生或新课程不在快照中，写入前整体重新载入（载入时已含最新成绩）
+    if (m_loaded) {
+        const int student = m_snapshot.studentIndex.value(studentId, -1);
+        const int course = m_snapshot.courseIndex.value(courseId, -1);
+        if (student >= 0 && course >= 0) {
+            auto& passed = m_snapshot.students[student].passed;
+            passed.erase(std::remove(passed.begin(), passed.end(), course), passed.end());
+            if (score.isValid() && score.toDouble() >= 60) passed.push_back(course);
+        } else {
+            invalidate();
+        }
+    }
+    m_dirty.insert(studentId);
+    scheduleFlush();
+}
+
+void DegreeAudit::onDataInvalidated()
+{
+    invalidate();
+    // 无法逐条追踪的修改（学分、课程、SQL写入等）可能影响任何学生，在后台重新全量审核
+    if (!isMaintained()) return;
+    requestAuditAll();
+}
+
+void DegreeAudit::requestAuditAll(AuditCallback onFinished)
+{
+    if (m_auditJob && !m_auditStarted->load()) {
+        // 排队中的任务开始时才载入数据，已包含这次修改
+        if (onFinished) m_jobCallbacks << onFinished;
+        return;
+    }
+    if (onFinished) m_nextCallbacks << onFinished;
+    if (m_auditJob) {
+        m_auditAgain = true;
+        return;
+    }
+    startAuditAll();
+}
+
+void DegreeAudit::startAuditAll()
+{
+    // 此前变化的学生都在任务载入的快照中；运行期间的变化留在 m_dirty，任务结束后再写
+    m_auditCovered = std::move(m_dirty);
+    m_dirty.clear();
+    m_auditAgain = false;
+    m_jobCallbacks = std::move(m_nextCallbacks);
+    m_nextCallbacks.clear();
+
+    auto started = std::make_shared<std::atomic<bool>>(false);
+    auto summary = std::make_shared<Summary>();
+    m_auditStarted = started;
+    JobScheduler& scheduler = JobScheduler::getInstance();
+    const int workers = scheduler.threadCount(JobScheduler::Lane::Batch);
+    m_auditJob = scheduler.submit("学位审核", JobScheduler::Lane::Batch,
+                                  [started, summary, workers](JobContext& context) {
+        started->store(true);
+        if (context.isCancelled()) return false;
+        context.setProgress(0, "载入培养要求和成绩并审核");
+        if (!auditAll(summary.get(), workers)) {
+            context.setProgress(100, "学位审核失败，请查看日志");
+            return false;
+        }
+        context.setProgress(100, QString("已审核 %1 名学生").arg(summary->students));
+        return true;
+    }, [this, summary](const JobScheduler::JobInfo& info) {
+        onAuditAllFinished(info.status == JobScheduler::Status::Succeeded, *summary);
+    });
+}
+
+void DegreeAudit::onAuditAllFinished(bool ok, const Summary& summary)
+{
+    m_auditJob = 0;
+    m_auditStarted.reset();
+    if (ok) {
+        m_audited = 1;
+    } else {
+        qWarning() << "全量学位审核未完成";
+        // 整表未替换，任务开始前待审核的学生改为逐个重新审核
+        m_dirty.unite(m_auditCovered);
+    }
+    m_auditCovered.clear();
+
+    const QList<AuditCallback> callbacks = std::move(m_jobCallbacks);
+    m_jobCallbacks.clear();
+    for (const AuditCallback& callback : callbacks) {
+        callback(ok, summary);
+    }
+
+    if (m_auditAgain) {
+        startAuditAll();
+    } else {
+        scheduleFlush();
+    }
+}
+
+void DegreeAudit::scheduleFlush()
+{
+    // 成绩册批量提交会连续发出多个信号，合并到事件循环空闲时一次写入
+    if (m_flushScheduled) return;
+    m_flushScheduled = true;
+    QTimer::singleShot(0, &Database::getInstance(), [this]() { flushDirty(); });
+}
+
+void DegreeAudit::flushDirty()
+{
+    m_flushScheduled = false;
+    // 全量审核任务结束后会再调度一次
+    if (m_auditJob || m_dirty.isEmpty()) return;
+    if (!ensureLoaded()) return;    // 待审核的学生保留到下次
+
+    std::vector<Status> statuses;
+    std::vector<char> mark(m_snapshot.credits.size(), 0);
+    QList<int> students;
+    for (int studentId : std::as_const(m_dirty)) {
+        const int index = m_snapshot.studentIndex.value(studentId, -1);
+        students << studentId;
+        if (index < 0) continue;        // 学生已删除，只清除其结果
+        const StudentRecord& record = m_snapshot.students[index];
+        if (record.program < 0) continue;
+        const size_t offset = statuses.size();
+        statuses.resize(offset + m_snapshot.programs[record.program].size());
+        evaluate(m_snapshot, record, mark, statuses.data() + offset);
+    }
+    m_dirty.clear();
+
+    writeStatuses(statuses, students);
+}
+
+bool DegreeAudit::writeStatuses(const std::vector<Status>& statuses, const QList<int>& replaceStudents)
+{
+    Transaction transaction;
+    QSqlQuery query(Database::getInstance().connection());
+    QStringList ids;
+    for (int studentId : replaceStudents) ids << QString::number(studentId);
+    const QString deleteSql = replaceStudents.isEmpty()
+        ? QString("DELETE FROM degree_audit")
+        : QString("DELETE FROM degree_audit WHERE student_id IN (%1)").arg(ids.join(", "));
+    if (!query.exec(deleteSql)) {
+        qWarning() << "清除学位审核结果失败:" << query.lastError().text();
+        return false;
+    }
+
+    // 全是数值，直接拼成多行 INSERT，每批一条语句
+    for (size_t start = 0; start < statuses.size(); start += kInsertBatch) {
+        const size_t end = std::min(statuses.size(), start + kInsertBatch);
+        QStringList rows;
+        rows.reserve(static_cast<int>(end - start));
+        for (size_t i = start; i < end; i++) {
+            const Status& status = statuses[i];
+            rows << QString("(%1,%2,%3,%4)").arg(status.studentId).arg(status.requirementId)
+                        .arg(status.satisfied ? 1 : 0).arg(status.earned, 0, 'f', 1);
+        }
+        if (!query.exec("INSERT INTO degree_audit (student_id, requirement_id, satisfied, earned) "
+                        "VALUES " + rows.join(","))) {
+            qWarning() << "写入学位审核结果失败:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    if (!transaction.commit()) {
+        qWarning() << "提交学位审核事务失败:" << transaction.lastError().text();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,110 @@
+#ifndef DEGREEAUDIT_H
+#define DEGREEAUDIT_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QVariant>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// 学位审核：按学生所属专业的培养要求（degree_requirements）逐条检查已通过课程，
+// 结果写入 degree_audit（每个学生每条要求一行）
+// 全量审核在内存快照上按学生分块并行计算，作为批处理任务在后台执行；之后成绩变化只重新审核相关学生，
+// 快照失效时在下次写入前重新载入，选课/课程的批量修改则重新全量审核（连续多次只排一个任务）
+class DegreeAudit
+{
+public:
+    static DegreeAudit& getInstance();
+
+    struct Summary {
+        int students = 0;           // 参与审核（已分配专业）的学生
+        int unassigned = 0;         // 没有专业的学生
+        int rows = 0;               // 写入的 学生×要求 条数
+        int fullySatisfied = 0;     // 全部要求都已满足的学生
+        qint64 loadMs = 0;
+        qint64 auditMs = 0;
+        qint64 writeMs = 0;
+    };
+
+    using AuditCallback = std::function<void(bool ok, const Summary& summary)>;
+    // 提交全量审核批处理任务；已有任务排队时合并到该任务，正在运行时在其结束后再审核一次。
+    // onFinished 在主线程调用
+    void requestAuditAll(AuditCallback onFinished = nullptr);
+
+    // 载入独立快照并全量审核、整表替换 degree_audit；不访问成员状态，可在工作线程调用。
+    // 工作线程沿用调用线程的优先级，workerCount<=0 时取CPU核数；失败返回false
+    static bool auditAll(Summary* summary = nullptr, int workerCount = 0);
+    // 重新审核单个学生并替换其审核结果（需已做过全量审核，全量审核任务进行中时返回false）
+    bool auditStudent(int studentId);
+
+    // 丢弃内存快照，待重新审核的学生保留
+    void invalidate();
+
+private:
+    DegreeAudit();
+    DegreeAudit(const DegreeAudit&) = delete;
+    DegreeAudit& operator=(const DegreeAudit&) = delete;
+
+    struct Requirement {
+        int id;
+        bool courseList;            // true: 所列课程须全部通过；false: 学分下限
+        double minCredits;
+        bool anyCourse;             // 学分要求未列课程时计入全部课程
+        std::vector<char> member;   // 课程下标 → 是否计入
+        std::vector<int> courses;   // 所列课程下标
+    };
+
+    struct StudentRecord {
+        int studentId;
+        int program;                // 专业下标，-1 表示未分配
+        std::vector<int> passed;    // 已通过（成绩>=60）课程下标
+    };
+
+    struct Status {
+        int studentId;
+        int requirementId;
+        bool satisfied;
+        float earned;               // 学分要求为已获学分，课程要求为已通过门数
+    };
+
+    struct Snapshot {
+        std::vector<float> credits;                     // 课程下标 → 学分
+        QHash<int, int> courseIndex;
+        std::vector<std::vector<Requirement>> programs; // 专业下标 → 培养要求
+        QHash<int, int> programIndex;
+        std::vector<StudentRecord> students;
+        QHash<int, int> studentIndex;
+    };
+
+    static bool loadSnapshot(Snapshot& snapshot);
+    static void evaluate(const Snapshot& snapshot, const StudentRecord& student,
+                         std::vector<char>& mark, Status* out);
+    static bool writeStatuses(const std::vector<Status>& statuses, const QList<int>& replaceStudents);
+    bool ensureLoaded();
+    bool isMaintained();
+    void onScoreChanged(int studentId, int courseId, const QVariant& score);
+    void onDataInvalidated();
+    void scheduleFlush();
+    void flushDirty();
+    void startAuditAll();
+    void onAuditAllFinished(bool ok, const Summary& summary);
+
+    Snapshot m_snapshot;                                // 增量审核用，只在主线程访问
+    QSet<int> m_dirty;                                  // 成绩变化后待重新审核的学生
+    bool m_loaded = false;
+    int m_audited = -1;                 // degree_audit 是否已有全量审核结果，-1 为尚未查询
+    bool m_flushScheduled = false;
+
+    // 全量审核任务：运行期间暂停增量写入，以免被整表替换覆盖
+    int m_auditJob = 0;
+    std::shared_ptr<std::atomic<bool>> m_auditStarted;  // 任务已开始载入快照
+    bool m_auditAgain = false;                          // 运行期间又有修改，结束后再审核一次
+    QSet<int> m_auditCovered;                           // 交给当前任务的待审核学生，失败时放回
+    QList<AuditCallback> m_jobCallbacks;                // 当前任务结束时通知
+    QList<AuditCallback> m_nextCallbacks;               // 下一次任务结束时通知
+};
+
+#endif // DEGREEAUDIT_H
@@ -0,0 +1,175 @@
+#include "dimensioncache.h"
+#include "database.h"
+#include <QDebug>
+#include <algorithm>
+#include <vector>
+
+DimensionCache& DimensionCache::getInstance()
+{
+    static DimensionCache instance;
+    return instance;
+}
+
+void DimensionCache::setStudents(const QList<QMap<QString, QVariant>>& rows)
+{
+    m_studentNames.clear();
+    m_studentNames.reserve(rows.size());
+    for (const auto& row : rows) {
+        m_studentNames.insert(row["student_id"].toInt(), row["name"].toString());
+    }
+}
+
+void DimensionCache::setTeachers(const QList<QMap<QString, QVariant>>& rows)
+{
+    m_teacherNames.clear();
+    m_teacherNames.reserve(rows.size());
+    for (const auto& row : rows) {
+        m_teacherNames.insert(row["teacher_id"].toInt(), row["name"].toString());
+    }
+}
+
+void DimensionCache::setCourses(const QList<QMap<QString, QVariant>>& rows)
+{
+    m_courses.clear();
+    m_courses.reserve(rows.size());
+    for (const auto& row : rows) {
+        CourseInfo info;
+        info.name = row["name"].toString();
+        info.semester = row["semester"].toString();
+        info.semesterId = row["semester_id"].toInt();
+        info.credit = row["credit"];
+        m_courses.insert(row["course_id"].toInt(), info);
+    }
+    // 课程表是最后加载的维度，三者齐全后才认为缓存可用
+    m_loaded = true;
+}
+
+void DimensionCache::refresh()
+{
+    Database& db = Database::getInstance();
+    setStudents(db.executeSelect("students"));
+    setTeachers(db.executeSelect("teachers"));
+    setCourses(db.executeSelect("courses"));
+    qDebug() << "维度缓存已刷新: 学生" << m_studentNames.size()
+             << "教师" << m_teacherNames.size()
+             << "课程" << m_courses.size();
+}
+
+void DimensionCache::invalidate()
+{
+    m_studentNames.clear();
+    m_teacherNames.clear();
+    m_courses.clear();
+    m_loaded = false;
+}
+
+void DimensionCache::ensureKeys(const QList<QMap<QString, QVariant>>& facts,
+                                const QString& personKey, const QHash<int, QString>& persons)
+{
+    if (!m_loaded) {
+        refresh();
+        return;
+    }
+
+    for (const auto& fact : facts) {
+        if (!persons.contains(fact[personKey].toInt()) ||
+            !m_courses.contains(fact["course_id"].toInt())) {
+            qDebug() << "维度缓存缺少键，重新加载";
+            refresh();
+            return;
+        }
+    }
+}
+
+namespace {
+
+// 排序键：先算好再排序，避免比较时反复查 QMap
+struct JoinKey {
+    const DimensionCache::CourseInfo* course;
+    int courseId;
+    int personId;
+    int index;
+};
+
+// 与服务器端排序一致：学期逆序、课程ID、人员ID
+bool joinKeyLess(const JoinKey& a, const JoinKey& b)
+{
+    if (a.course->semesterId != b.course->semesterId) {
+        return a.course->semesterId > b.course->semesterId;
+    }
+    if (a.courseId != b.courseId) return a.courseId < b.courseId;
+    return a.personId < b.personId;
+}
+
+} // namespace
+
+QList<QMap<QString, QVariant>> DimensionCache::joinTeachings(
+    const QList<QMap<QString, QVariant>>& facts)
+{
+    ensureKeys(facts, "teacher_id", m_teacherNames);
+
+    static const CourseInfo missingCourse;
+    std::vector<JoinKey> keys;
+    keys.reserve(facts.size());
+    for (int i = 0; i < facts.size(); i++) {
+        const int courseId = facts[i]["course_id"].toInt();
+        auto it = m_courses.constFind(courseId);
+        keys.push_back({it != m_courses.constEnd() ? &it.value() : &missingCourse,
+                        courseId, facts[i]["teacher_id"].toInt(), i});
+    }
+    std::sort(keys.begin(), keys.end(), joinKeyLess);
+
+    QList<QMap<QString, QVariant>> result;
+    result.reserve(facts.size());
+
+    for (const JoinKey& key : keys) {
+        const auto& fact = facts[key.index];
+
+        QMap<QString, QVariant> row;
+        row["teacher_id"] = key.personId;
+        row["teacher_name"] = m_teacherNames.value(key.personId);
+        row["course_id"] = key.courseId;
+        row["course_name"] = key.course->name;
+        row["semester"] = key.course->semester;
+        row["semester_id"] = key.course->semesterId;
+        row["class_time"] = fact["class_time"];
+        row["classroom"] = fact["classroom"];
+        result.append(row);
+    }
+
+    return result;
+}
+
+QList<QMap<QString, QVariant>> DimensionCache::joinEnrollments(
+    const QList<QMap<QString, QVariant>>& facts)
+{
+    ensureKeys(facts, "student_id", m_studentNames);
+
+    static const CourseInfo missingCourse;
+    std::vector<JoinKey> keys;
+    keys.reserve(facts.size());
+    for (int i = 0; i < facts.size(); i++) {
+        const int courseId = facts[i]["course_id"].toInt();
+        auto it = m_courses.constFind(courseId);
+        keys.push_back({it != m_courses.constEnd() ? &it.value() : &missingCourse,
+                        courseId, facts[i]["student_id"].toInt(), i});
+    }
+    std::sort(keys.begin(), keys.end(), joinKeyLess);
+
+    QList<QMap<QString, QVariant>> result;
+    result.reserve(facts.size());
+
+    for (const JoinKey& key : keys) {
+        QMap<QString, QVariant> row;
+        row["student_id"] = key.personId;
+        row["student_name"] = m_studentNames.value(key.personId);
+        row["course_id"] = key.courseId;
+        row["course_name"] = key.course->name;
+        row["semester"] = key.course->semester;
+        row["semester_id"] = key.course->semesterId;
+        row["score"] = facts[key.index]["score"];
+        result.append(row);
+    }
+
+    return result;
+}
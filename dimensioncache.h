@@ -0,0 +1,53 @@
+#ifndef DIMENSIONCACHE_H
+#define DIMENSIONCACHE_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QVariant>
+
+// 维度表缓存：students / teachers / courses 的名称等信息常驻内存，
+// 授课、选课只从服务器取窄事实行（ID + 少量字段），在本地做哈希关联
+class DimensionCache
+{
+public:
+    static DimensionCache& getInstance();
+
+    struct CourseInfo {
+        QString name;
+        QString semester;
+        int semesterId = 0;     // 学期整数排序键，见 Database::semesterKey()
+        QVariant credit;
+    };
+
+    // 用已取回的整表数据刷新各维度（字段与 Database::executeSelect 一致）
+    void setStudents(const QList<QMap<QString, QVariant>>& rows);
+    void setTeachers(const QList<QMap<QString, QVariant>>& rows);
+    void setCourses(const QList<QMap<QString, QVariant>>& rows);
+
+    // 从数据库重新加载全部维度
+    void refresh();
+    void invalidate();
+    bool isLoaded() const { return m_loaded; }
+
+    // 把窄事实行关联成与 Database::getCourseTeachings()/getCourseEnrollments() 宽行相同的行格式和顺序
+    QList<QMap<QString, QVariant>> joinTeachings(const QList<QMap<QString, QVariant>>& facts);
+    QList<QMap<QString, QVariant>> joinEnrollments(const QList<QMap<QString, QVariant>>& facts);
+
+private:
+    DimensionCache() = default;
+    DimensionCache(const DimensionCache&) = delete;
+    DimensionCache& operator=(const DimensionCache&) = delete;
+
+    // 事实行引用了缓存中没有的ID时（其他窗口新增了数据），整体重新加载一次
+    void ensureKeys(const QList<QMap<QString, QVariant>>& facts,
+                    const QString& personKey, const QHash<int, QString>& persons);
+
+    QHash<int, QString> m_studentNames;
+    QHash<int, QString> m_teacherNames;
+    QHash<int, CourseInfo> m_courses;
+    bool m_loaded = false;
+};
+
+#endif // DIMENSIONCACHE_H
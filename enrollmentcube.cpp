@@ -0,0 +1,211 @@
+#include "enrollmentcube.h"
+#include "database.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QMap>
+#include <QSet>
+#include <algorithm>
+
+namespace {
+const char* const kAgeBandNames[] = {"未知", "18岁以下", "18-20岁", "21-22岁", "23-25岁", "25岁以上"};
+const std::vector<int> kNoTeacher = {0};
+}
+
+EnrollmentCube& EnrollmentCube::getInstance()
+{
+    static EnrollmentCube instance;
+    return instance;
+}
+
+EnrollmentCube::EnrollmentCube()
+{
+    // 数据库中的汇总由触发器维护，内存副本只需在下次查询时重新载入
+    Database& db = Database::getInstance();
+    QObject::connect(&db, &Database::enrollmentScoreChanged, &db,
+                     [this](int, int, const QVariant&) { invalidate(); });
+    QObject::connect(&db, &Database::enrollmentDataInvalidated, &db, [this]() { invalidate(); });
+}
+
+QString EnrollmentCube::dimensionName(Dimension dimension)
+{
+    switch (dimension) {
+    case Dimension::Semester: return "学期";
+    case Dimension::Course: return "课程";
+    case Dimension::Teacher: return "教师";
+    case Dimension::AgeBand: return "年龄段";
+    }
+    return QString();
+}
+
+void EnrollmentCube::Totals::add(const Cell& cell)
+{
+    enrollments += cell.enrollments;
+    scored += cell.scored;
+    passed += cell.passed;
+    scoreSum += cell.scoreSum;
+}
+
+QVariant EnrollmentCube::Totals::value(Measure measure) const
+{
+    switch (measure) {
+    case Measure::Enrollments: return enrollments;
+    case Measure::Scored: return scored;
+    case Measure::AverageScore:
+        return scored > 0 ? QVariant(qRound(scoreSum / scored * 10) / 10.0) : QVariant();
+    case Measure::PassRate:
+        return scored > 0 ? QVariant(qRound(passed * 1000.0 / scored) / 10.0) : QVariant();
+    }
+    return QVariant();
+}
+
+bool EnrollmentCube::ensureLoaded()
+{
+    if (m_loaded) return true;
+
+    QElapsedTimer timer;
+    timer.start();
+    m_cells.clear();
+    m_semesterNames.clear();
+    m_courseNames.clear();
+    m_teacherNames.clear();
+    m_courseTeachers.clear();
+
+    QSqlDatabase db = Database::getInstance().connection();
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT semester_id, course_id, age_band, enrollments, scored, passed, score_sum "
+                    "FROM enrollment_cube WHERE enrollments <> 0")) {
+        qWarning() << "载入选课汇总失败:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        m_cells.push_back({query.value(0).toInt(), query.value(1).toInt(), query.value(2).toInt(),
+                           query.value(3).toInt(), query.value(4).toInt(), query.value(5).toInt(),
+                           query.value(6).toDouble()});
+    }
+
+    if (query.exec("SELECT semester_id, name FROM semesters")) {
+        while (query.next()) m_semesterNames.insert(query.value(0).toInt(), query.value(1).toString());
+    }
+    if (query.exec("SELECT course_id, name FROM courses")) {
+        while (query.next()) m_courseNames.insert(query.value(0).toInt(), query.value(1).toString());
+    }
+    if (query.exec("SELECT t.course_id, t.teacher_id, te.name FROM teachings t "
+                   "JOIN teachers te ON te.teacher_id = t.teacher_id")) {
+        while (query.next()) {
+            const int teacherId = query.value(1).toInt();
+            m_courseTeachers[query.value(0).toInt()].push_back(teacherId);
+            m_teacherNames.insert(teacherId, query.value(2).toString());
+        }
+    }
+
+    m_loaded = true;
+    qDebug() << "选课汇总已载入:" << m_cells.size() << "格, 耗时" << timer.elapsed() << "毫秒";
+    return true;
+}
+
+const std::vector<int>& EnrollmentCube::keys(const Cell& cell, Dimension dimension,
+                                             std::vector<int>& buffer) const
+{
+    switch (dimension) {
+    case Dimension::Teacher: {
+        auto it = m_courseTeachers.constFind(cell.courseId);
+        return it == m_courseTeachers.constEnd() ? kNoTeacher : it.value();
+    }
+    case Dimension::Semester: buffer.assign(1, cell.semesterId); break;
+    case Dimension::Course: buffer.assign(1, cell.courseId); break;
+    case Dimension::AgeBand: buffer.assign(1, cell.ageBand); break;
+    }
+    return buffer;
+}
+
+QString EnrollmentCube::label(Dimension dimension, int key) const
+{
+    switch (dimension) {
+    case Dimension::Semester:
+        return key == 0 ? QString("未关联学期") : m_semesterNames.value(key, QString::number(key));
+    case Dimension::Course:
+        return QString("%1 %2").arg(key).arg(m_courseNames.value(key));
+    case Dimension::Teacher:
+        return key == 0 ? QString("未安排") : QString("%1 %2").arg(key).arg(m_teacherNames.value(key));
+    case Dimension::AgeBand:
+        return key >= 0 && key < 6 ? QString(kAgeBandNames[key]) : QString::number(key);
+    }
+    return QString();
+}
+
+QList<QPair<int, QString>> EnrollmentCube::members(Dimension dimension)
+{
+    QList<QPair<int, QString>> result;
+    if (!ensureLoaded()) return result;
+
+    QSet<int> seen;
+    std::vector<int> buffer;
+    for (const Cell& cell : m_cells) {
+        for (int key : keys(cell, dimension, buffer)) seen.insert(key);
+    }
+    QList<int> sorted(seen.begin(), seen.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (int key : sorted) result << qMakePair(key, label(dimension, key));
+    return result;
+}
+
+EnrollmentCube::Pivot EnrollmentCube::pivot(Dimension rows, Dimension columns, Measure measure,
+                                            const QHash<int, int>& filters)
+{
+    Pivot result;
+    if (!ensureLoaded()) return result;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 行、列成员按键排序；单元格按 (行下标, 列下标) 累加
+    QMap<int, Totals> rowTotals, columnTotals;
+    QHash<quint64, Totals> cells;
+    Totals grand;
+    std::vector<int> rowBuffer, columnBuffer, filterBuffer;
+
+    for (const Cell& cell : m_cells) {
+        bool keep = true;
+        for (auto it = filters.constBegin(); keep && it != filters.constEnd(); ++it) {
+            const std::vector<int>& values = keys(cell, static_cast<Dimension>(it.key()), filterBuffer);
+            keep = std::find(values.begin(), values.end(), it.value()) != values.end();
+        }
+        if (!keep) continue;
+
+        const std::vector<int>& rowKeys = keys(cell, rows, rowBuffer);
+        const std::vector<int>& columnKeys = keys(cell, columns, columnBuffer);
+        for (int row : rowKeys) {
+            rowTotals[row].add(cell);
+            for (int column : columnKeys) {
+                cells[(static_cast<quint64>(static_cast<quint32>(row)) << 32) |
+                      static_cast<quint32>(column)].add(cell);
+            }
+        }
+        for (int column : columnKeys) columnTotals[column].add(cell);
+        grand.add(cell);
+    }
+
+    for (auto it = rowTotals.constBegin(); it != rowTotals.constEnd(); ++it) {
+        result.rowLabels << label(rows, it.key());
+        result.rowTotals << it.value().value(measure);
+    }
+    for (auto it = columnTotals.constBegin(); it != columnTotals.constEnd(); ++it) {
+        result.columnLabels << label(columns, it.key());
+        result.columnTotals << it.value().value(measure);
+    }
+    for (auto row = rowTotals.constBegin(); row != rowTotals.constEnd(); ++row) {
+        QList<QVariant> line;
+        for (auto column = columnTotals.constBegin(); column != columnTotals.constEnd(); ++column) {
+            auto cell = cells.constFind((static_cast<quint64>(static_cast<quint32>(row.key())) << 32) |
+                                        static_cast<quint32>(column.key()));
+            line << (cell == cells.constEnd() ? QVariant() : cell.value().value(measure));
+        }
+        result.cells << line;
+    }
+    result.grandTotal = grand.value(measure);
+    result.elapsedUs = timer.nsecsElapsed() / 1000;
+    return result;
+}
@@ -0,0 +1,80 @@
+#ifndef ENROLLMENTCUBE_H
+#define ENROLLMENTCUBE_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <vector>
+
+// 选课多维分析：从 enrollment_cube（学期 × 课程 × 年龄段，数据库触发器增量维护）
+// 载入全部汇总格到内存，教师维度按授课表展开；切片、透视都在内存中完成
+class EnrollmentCube
+{
+public:
+    static EnrollmentCube& getInstance();
+
+    enum class Dimension { Semester, Course, Teacher, AgeBand };
+    enum class Measure { Enrollments, Scored, AverageScore, PassRate };
+
+    struct Pivot {
+        QStringList rowLabels;
+        QStringList columnLabels;
+        QList<QList<QVariant>> cells;       // 无数据为无效 QVariant
+        QList<QVariant> rowTotals;
+        QList<QVariant> columnTotals;
+        QVariant grandTotal;
+        qint64 elapsedUs = 0;
+    };
+
+    static QString dimensionName(Dimension dimension);
+
+    // 维度成员（键, 名称），用于切片下拉框
+    QList<QPair<int, QString>> members(Dimension dimension);
+
+    // filters：维度 → 只保留该成员；一门课程有多位教师时在每位教师下各计一次，
+    // 但合计按选课记录去重
+    Pivot pivot(Dimension rows, Dimension columns, Measure measure,
+                const QHash<int, int>& filters = QHash<int, int>());
+
+    void invalidate() { m_loaded = false; }
+
+private:
+    EnrollmentCube();
+    EnrollmentCube(const EnrollmentCube&) = delete;
+    EnrollmentCube& operator=(const EnrollmentCube&) = delete;
+
+    struct Cell {
+        int semesterId;
+        int courseId;
+        int ageBand;
+        int enrollments;
+        int scored;
+        int passed;
+        double scoreSum;
+    };
+
+    struct Totals {
+        qint64 enrollments = 0;
+        qint64 scored = 0;
+        qint64 passed = 0;
+        double scoreSum = 0;
+        void add(const Cell& cell);
+        QVariant value(Measure measure) const;
+    };
+
+    bool ensureLoaded();
+    const std::vector<int>& keys(const Cell& cell, Dimension dimension, std::vector<int>& buffer) const;
+    QString label(Dimension dimension, int key) const;
+
+    std::vector<Cell> m_cells;
+    QHash<int, QString> m_semesterNames;
+    QHash<int, QString> m_courseNames;
+    QHash<int, QString> m_teacherNames;
+    QHash<int, std::vector<int>> m_courseTeachers;      // 课程 → 授课教师，无教师时为 {0}
+    bool m_loaded = false;
+};
+
+#endif // ENROLLMENTCUBE_H
@@ -0,0 +1,309 @@
+#include "examscheduler.h"
+#include "database.h"
+#include "transaction.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QHash>
+#include <QFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QDebug>
+#include <QtConcurrent>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+
+namespace {
+
+QString csvField(const QString& text)
+{
+    if (!text.contains(',') && !text.contains('"') && !text.contains('\n')) return text;
+    QString escaped = text;
+    escaped.replace("\"", "\"\"");
+    return QString("\"%1\"").arg(escaped);
+}
+
+bool openCsv(QFile& file)
+{
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "无法写入文件:" << file.fileName() << file.errorString();
+        return false;
+    }
+    // 带 BOM，Excel 打开时才能正确识别中文
+    file.write("\xEF\xBB\xBF");
+    return true;
+}
+
+} // namespace
+
+bool ExamScheduler::load(int semesterId, int workerCount)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    m_semesterId = semesterId;
+    m_edgeCount = 0;
+    m_courses.clear();
+    m_students.clear();
+    m_adjacency.clear();
+
+    QSqlQuery query(Database::getInstance().connection());
+    query.setForwardOnly(true);
+    query.prepare("SELECT e.student_id, s.name, e.course_id, c.name "
+                  "FROM enrollments e "
+                  "JOIN students s ON e.student_id = s.student_id "
+                  "JOIN courses c ON e.course_id = c.course_id "
+                  "WHERE c.semester_id = ? ORDER BY e.student_id");
+    query.addBindValue(semesterId);
+    if (!query.exec()) {
+        qWarning() << "载入考试选课失败:" << query.lastError().text();
+        return false;
+    }
+
+    QHash<int, int> courseIndex;
+    while (query.next()) {
+        const int studentId = query.value(0).toInt();
+        const int courseId = query.value(2).toInt();
+
+        auto found = courseIndex.constFind(courseId);
+        int index;
+        if (found == courseIndex.constEnd()) {
+            index = static_cast<int>(m_courses.size());
+            courseIndex.insert(courseId, index);
+            m_courses.push_back({courseId, query.value(3).toString(), 0});
+        } else {
+            index = found.value();
+        }
+        m_courses[index].students++;
+
+        if (m_students.empty() || m_students.back().studentId != studentId) {
+            m_students.push_back({studentId, query.value(1).toString(), {}});
+        }
+        m_students.back().courses.push_back(index);
+    }
+
+    // 稀疏共现计数：学生分块，每块在自己的哈希表里累加课程对，最后合并
+    if (workerCount <= 0) workerCount = QThread::idealThreadCount();
+    const int chunkCount = qMax(1, qMin(workerCount, static_cast<int>(m_students.size())));
+    const size_t chunkSize = (m_students.size() + chunkCount - 1) / chunkCount;
+    QList<int> chunks;
+    for (int i = 0; i < chunkCount; i++) chunks << i;
+
+    using PairCounts = std::unordered_map<quint64, int>;
+    QThreadPool pool;
+    pool.setMaxThreadCount(chunkCount);
+    pool.setThreadPriority(QThread::currentThread()->priority());
+    const QList<PairCounts> partial = QtConcurrent::blockingMapped(
+        &pool, chunks, [this, chunkSize](int chunk) {
+            PairCounts counts;
+            const size_t begin = chunk * chunkSize;
+            const size_t end = std::min(m_students.size(), begin + chunkSize);
+            for (size_t s = begin; s < end; s++) {
+                const std::vector<int>& courses = m_students[s].courses;
+                for (size_t i = 0; i < courses.size(); i++) {
+                    for (size_t j = i + 1; j < courses.size(); j++) {
+                        const quint32 a = std::min(courses[i], courses[j]);
+                        const quint32 b = std::max(courses[i], courses[j]);
+                        counts[(quint64(a) << 32) | b]++;
+                    }
+                }
+            }
+            return counts;
+        });
+
+    PairCounts merged;
+    for (const PairCounts& counts : partial) {
+        for (const auto& pair : counts) merged[pair.first] += pair.second;
+    }
+
+    m_adjacency.assign(m_courses.size(), {});
+    for (const auto& pair : merged) {
+        const int a = static_cast<int>(pair.first >> 32);
+        const int b = static_cast<int>(pair.first & 0xFFFFFFFFu);
+        m_adjacency[a].push_back({b, pair.second});
+        m_adjacency[b].push_back({a, pair.second});
+    }
+    m_edgeCount = static_cast<int>(merged.size());
+
+    qDebug() << "考试冲突图: 课程" << m_courses.size() << "学生" << m_students.size()
+             << "冲突边" << m_edgeCount << "耗时" << timer.elapsed() << "毫秒";
+    return true;
+}
+
+ExamScheduler::Result ExamScheduler::schedule(int slotCount) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    slotCount = qBound(1, slotCount, kMaxSlots);
+    const int n = static_cast<int>(m_courses.size());
+    std::vector<int> color(n, -1);
+    std::vector<quint64> neighborSlots(n, 0);   // 邻居已占用的场次
+    std::vector<int> weightedDegree(n, 0);
+    for (int v = 0; v < n; v++) {
+        for (const auto& edge : m_adjacency[v]) weightedDegree[v] += edge.second;
+    }
+
+    auto slotCost = [&](int v, int slot) {
+        int cost = 0;
+        for (const auto& edge : m_adjacency[v]) {
+            if (color[edge.first] == slot) cost += edge.second;
+        }
+        return cost;
+    };
+
+    // DSATUR：每次给饱和度（邻居占用的不同场次数）最高的课程着色，同饱和度时取加权度数大者
+    for (int step = 0; step < n; step++) {
+        int chosen = -1;
+        int bestSaturation = -1;
+        for (int v = 0; v < n; v++) {
+            if (color[v] >= 0) continue;
+            const int saturation = qPopulationCount(neighborSlots[v]);
+            if (saturation > bestSaturation
+                || (saturation == bestSaturation && weightedDegree[v] > weightedDegree[chosen])) {
+                chosen = v;
+                bestSaturation = saturation;
+            }
+        }
+
+        int slot = -1;
+        for (int s = 0; s < slotCount; s++) {
+            if (!(neighborSlots[chosen] & (quint64(1) << s))) {
+                slot = s;
+                break;
+            }
+        }
+        if (slot < 0) {
+            // 场次不够无冲突着色，退而选冲突人次最少的场次
+            int bestCost = INT_MAX;
+            for (int s = 0; s < slotCount; s++) {
+                const int cost = slotCost(chosen, s);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    slot = s;
+                }
+            }
+        }
+
+        color[chosen] = slot;
+        for (const auto& edge : m_adjacency[chosen]) {
+            neighborSlots[edge.first] |= quint64(1) << slot;
+        }
+    }
+
+    // 局部搜索：把仍有冲突的课程移到冲突更少的场次，直到一轮下来没有改进
+    for (int pass = 0; pass < 100; pass++) {
+        bool improved = false;
+        for (int v = 0; v < n; v++) {
+            const int current = slotCost(v, color[v]);
+            if (current == 0) continue;
+            for (int s = 0; s < slotCount; s++) {
+                if (s == color[v]) continue;
+                if (slotCost(v, s) < current) {
+                    color[v] = s;
+                    improved = true;
+                    break;
+                }
+            }
+        }
+        if (!improved) break;
+    }
+
+    Result result;
+    quint64 usedSlots = 0;
+    for (int v = 0; v < n; v++) {
+        CourseExam exam;
+        exam.courseId = m_courses[v].courseId;
+        exam.name = m_courses[v].name;
+        exam.students = m_courses[v].students;
+        exam.slot = color[v] + 1;
+        exam.conflicts = slotCost(v, color[v]);
+        result.conflicts += exam.conflicts;
+        result.exams << exam;
+        usedSlots |= quint64(1) << color[v];
+    }
+    result.conflicts /= 2;      // 每条冲突边在两门课上各计一次
+    result.slotsUsed = qPopulationCount(usedSlots);
+    std::sort(result.exams.begin(), result.exams.end(),
+              [](const CourseExam& a, const CourseExam& b) {
+                  return a.slot != b.slot ? a.slot < b.slot : a.courseId < b.courseId;
+              });
+    result.elapsedMs = timer.elapsed();
+
+    qDebug() << "考试排场: 场次" << result.slotsUsed << "/" << slotCount
+             << "冲突人次" << result.conflicts << "耗时" << result.elapsedMs << "毫秒";
+    return result;
+}
+
+bool ExamScheduler::save(const Result& result) const
+{
+    Transaction transaction;
+    QSqlQuery query(Database::getInstance().connection());
+    query.prepare("DELETE FROM exam_schedule WHERE semester_id = ?");
+    query.addBindValue(m_semesterId);
+    if (!query.exec()) {
+        qWarning() << "清除考试安排失败:" << query.lastError().text();
+        return false;
+    }
+
+    query.prepare("INSERT INTO exam_schedule (course_id, semester_id, slot) VALUES (?, ?, ?)");
+    for (const CourseExam& exam : result.exams) {
+        query.addBindValue(exam.courseId);
+        query.addBindValue(m_semesterId);
+        query.addBindValue(exam.slot);
+        if (!query.exec()) {
+            qWarning() << "保存考试安排失败:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    if (!transaction.commit()) {
+        qWarning() << "提交考试安排事务失败:" << transaction.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool ExamScheduler::exportCourses(const Result& result, const QString& path) const
+{
+    QFile file(path);
+    if (!openCsv(file)) return false;
+
+    QTextStream out(&file);
+    out << "考试场次,课程ID,课程名称,考生人数,冲突人次\n";
+    for (const CourseExam& exam : result.exams) {
+        out << exam.slot << ',' << exam.courseId << ',' << csvField(exam.name) << ','
+            << exam.students << ',' << exam.conflicts << '\n';
+    }
+    return true;
+}
+
+bool ExamScheduler::exportStudents(const Result& result, const QString& path) const
+{
+    QHash<int, int> slotByCourse;
+    for (const CourseExam& exam : result.exams) {
+        slotByCourse.insert(exam.courseId, exam.slot);
+    }
+
+    QFile file(path);
+    if (!openCsv(file)) return false;
+
+    QTextStream out(&file);
+    out << "学号,姓名,考试场次,课程ID,课程名称\n";
+    for (const Student& student : m_students) {
+        std::vector<std::pair<int, int>> exams;    // (场次, 课程下标)
+        for (int course : student.courses) {
+            exams.push_back({slotByCourse.value(m_courses[course].courseId), course});
+        }
+        std::sort(exams.begin(), exams.end());
+        for (const auto& exam : exams) {
+            const Course& course = m_courses[exam.second];
+            out << student.studentId << ',' << csvField(student.name) << ',' << exam.first << ','
+                << course.courseId << ',' << csvField(course.name) << '\n';
+        }
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef EXAMSCHEDULER_H
+#define EXAMSCHEDULER_H
+
+#include <QList>
+#include <QString>
+#include <utility>
+#include <vector>
+
+// 期末考试排场：课程为顶点、共同选课人数为边权建冲突图，
+// 用 DSATUR 着色把课程分到有限个考试场次，再做局部搜索消除剩余冲突
+class ExamScheduler
+{
+public:
+    static constexpr int kMaxSlots = 64;    // 邻居已占用场次用64位掩码记录
+
+    struct CourseExam {
+        int courseId = 0;
+        QString name;
+        int students = 0;
+        int slot = 0;           // 从1开始的考试场次
+        int conflicts = 0;      // 与同场次其他考试冲突的学生人次
+    };
+
+    struct Result {
+        QList<CourseExam> exams;
+        int slotsUsed = 0;
+        int conflicts = 0;      // 同一学生同场次两门考试的人次总数
+        qint64 elapsedMs = 0;
+    };
+
+    // 载入学期选课并并行统计课程两两共同选课人数；失败返回false。
+    // 统计线程沿用调用线程的优先级，workerCount<=0 时取CPU核数
+    bool load(int semesterId, int workerCount = 0);
+    int courseCount() const { return static_cast<int>(m_courses.size()); }
+    int edgeCount() const { return m_edgeCount; }
+
+    Result schedule(int slotCount) const;
+
+    // 保存到 exam_schedule（整学期替换）
+    bool save(const Result& result) const;
+
+    // 导出 CSV：按课程一行，或按学生每门考试一行
+    bool exportCourses(const Result& result, const QString& path) const;
+    bool exportStudents(const Result& result, const QString& path) const;
+
+private:
+    struct Course {
+        int courseId;
+        QString name;
+        int students;
+    };
+
+    struct Student {
+        int studentId;
+        QString name;
+        std::vector<int> courses;   // 课程下标
+    };
+
+    int m_semesterId = 0;
+    int m_edgeCount = 0;
+    std::vector<Course> m_courses;
+    std::vector<Student> m_students;
+    std::vector<std::vector<std::pair<int, int>>> m_adjacency;   // 课程下标 → (课程下标, 共同选课人数)
+};
+
+#endif // EXAMSCHEDULER_H
@@ -0,0 +1,231 @@
+#include "gradeanalytics.h"
+#include "database.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// 核函数按固定宽度分多路累加，各路之间没有依赖，编译器可以直接向量化；
+// 成绩按float存储，累加用double，大课程的和与平方和不丢精度
+constexpr int kLanes = 8;
+
+double sumScores(const float* scores, int count)
+{
+    double lanes[kLanes] = {};
+    int i = 0;
+    for (; i + kLanes <= count; i += kLanes) {
+        for (int lane = 0; lane < kLanes; lane++) {
+            lanes[lane] += scores[i + lane];
+        }
+    }
+
+    double total = 0;
+    for (int lane = 0; lane < kLanes; lane++) total += lanes[lane];
+    for (; i < count; i++) total += scores[i];
+    return total;
+}
+
+// 第二遍求离差平方和，比 E[x²]-E[x]² 数值稳定
+double sumSquaredDeviation(const float* scores, int count, double mean)
+{
+    double lanes[kLanes] = {};
+    int i = 0;
+    for (; i + kLanes <= count; i += kLanes) {
+        for (int lane = 0; lane < kLanes; lane++) {
+            const double d = scores[i + lane] - mean;
+            lanes[lane] += d * d;
+        }
+    }
+
+    double total = 0;
+    for (int lane = 0; lane < kLanes; lane++) total += lanes[lane];
+    for (; i < count; i++) {
+        const double d = scores[i] - mean;
+        total += d * d;
+    }
+    return total;
+}
+
+int countPassed(const float* scores, int count)
+{
+    int lanes[kLanes] = {};
+    int i = 0;
+    for (; i + kLanes <= count; i += kLanes) {
+        for (int lane = 0; lane < kLanes; lane++) {
+            lanes[lane] += scores[i + lane] >= 60.0f ? 1 : 0;
+        }
+    }
+
+    int total = 0;
+    for (int lane = 0; lane < kLanes; lane++) total += lanes[lane];
+    for (; i < count; i++) total += scores[i] >= 60.0f ? 1 : 0;
+    return total;
+}
+
+void buildHistogram(const float* scores, int count, std::array<int, 10>& histogram)
+{
+    // 4份子直方图交替写入，减少对同一计数器的连续依赖
+    int partial[4][10] = {};
+    for (int i = 0; i < count; i++) {
+        int bin = static_cast<int>(scores[i] * 0.1f);
+        bin = bin < 0 ? 0 : (bin > 9 ? 9 : bin);
+        partial[i & 3][bin]++;
+    }
+    for (int bin = 0; bin < 10; bin++) {
+        histogram[bin] = partial[0][bin] + partial[1][bin] + partial[2][bin] + partial[3][bin];
+    }
+}
+
+// 已排序数组上的线性插值分位数
+float quantile(const std::vector<float>& sorted, double q)
+{
+    const double position = q * (sorted.size() - 1);
+    const size_t lower = static_cast<size_t>(position);
+    const size_t upper = std::min(lower + 1, sorted.size() - 1);
+    const double fraction = position - lower;
+    return static_cast<float>(sorted[lower] + (sorted[upper] - sorted[lower]) * fraction);
+}
+
+} // namespace
+
+int GradeAnalytics::load(int teacherId)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    m_scores.clear();
+    m_courseRanges.clear();
+    m_semesterRanges.clear();
+
+    // 课程元数据单独取，避免课程名称随每条成绩重复传输
+    struct CourseMeta {
+        QString name;
+        QString semester;
+        int semesterId;
+    };
+    QHash<int, CourseMeta> courses;
+    QSqlQuery courseQuery(Database::getInstance().connection());
+    courseQuery.setForwardOnly(true);
+    if (!courseQuery.exec("SELECT course_id, name, semester, semester_id FROM courses")) {
+        qWarning() << "载入课程失败:" << courseQuery.lastError().text();
+        return -1;
+    }
+    while (courseQuery.next()) {
+        courses.insert(courseQuery.value(0).toInt(),
+                       {courseQuery.value(1).toString(), courseQuery.value(2).toString(),
+                        courseQuery.value(3).toInt()});
+    }
+
+    // 只统计已评分的成绩（0分视为未评分，与学分/GPA汇总口径一致）
+    QString sql = "SELECT e.course_id, e.score FROM enrollments e "
+                  "JOIN courses c ON e.course_id = c.course_id "
+                  "WHERE e.score > 0 ";
+    if (teacherId > 0) {
+        sql += QString("AND e.course_id IN (SELECT course_id FROM teachings WHERE teacher_id = %1) ")
+                   .arg(teacherId);
+    }
+    sql += "ORDER BY c.semester_id DESC, e.course_id";
+
+    QSqlQuery query(Database::getInstance().connection());
+    query.setForwardOnly(true);
+    if (!query.exec(sql)) {
+        qWarning() << "载入成绩失败:" << query.lastError().text();
+        return -1;
+    }
+    if (query.size() > 0) {
+        m_scores.reserve(query.size());
+    }
+
+    int lastCourseId = std::numeric_limits<int>::min();
+    int lastSemesterId = std::numeric_limits<int>::min();
+    while (query.next()) {
+        const int courseId = query.value(0).toInt();
+        const int offset = static_cast<int>(m_scores.size());
+        m_scores.push_back(query.value(1).toFloat());
+
+        if (courseId != lastCourseId) {
+            const CourseMeta meta = courses.value(courseId);
+            m_courseRanges.push_back({courseId,
+                                      QString("%1（%2）").arg(meta.name, meta.semester),
+                                      offset, 0});
+            lastCourseId = courseId;
+
+            if (meta.semesterId != lastSemesterId || m_semesterRanges.empty()) {
+                m_semesterRanges.push_back({meta.semesterId,
+                                            meta.semester.isEmpty() ? QString("未设置学期")
+                                                                    : meta.semester,
+                                            offset, 0});
+                lastSemesterId = meta.semesterId;
+            }
+        }
+        m_courseRanges.back().count++;
+        m_semesterRanges.back().count++;
+    }
+
+    m_lastLoadMs = timer.elapsed();
+    qDebug() << "成绩分析载入:" << m_scores.size() << "条成绩,"
+             << m_courseRanges.size() << "门课程, 耗时" << m_lastLoadMs << "毫秒";
+    return static_cast<int>(m_scores.size());
+}
+
+void GradeAnalytics::computeRange(const float* scores, int count, GradeStats& stats,
+                                  std::vector<float>& scratch)
+{
+    stats.count = count;
+    if (count == 0) return;
+
+    stats.mean = sumScores(scores, count) / count;
+    stats.stddev = std::sqrt(sumSquaredDeviation(scores, count, stats.mean) / count);
+    stats.passRate = static_cast<double>(countPassed(scores, count)) / count;
+    buildHistogram(scores, count, stats.histogram);
+
+    // 分位数需要有序数据，在副本上排序，最值也顺便得到
+    scratch.assign(scores, scores + count);
+    std::sort(scratch.begin(), scratch.end());
+    stats.min = scratch.front();
+    stats.max = scratch.back();
+    stats.p25 = quantile(scratch, 0.25);
+    stats.median = quantile(scratch, 0.5);
+    stats.p75 = quantile(scratch, 0.75);
+    stats.p90 = quantile(scratch, 0.9);
+}
+
+QList<GradeStats> GradeAnalytics::compute(GroupBy groupBy) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const std::vector<Range>& ranges =
+        groupBy == GroupBy::Course ? m_courseRanges : m_semesterRanges;
+
+    QList<GradeStats> results;
+    results.reserve(static_cast<int>(ranges.size()));
+    for (const Range& range : ranges) {
+        GradeStats stats;
+        stats.groupId = range.groupId;
+        stats.label = range.label;
+        results.append(stats);
+    }
+
+    // 各分组互相独立，按分组并行；每个工作线程复用自己的排序缓冲区
+    QList<int> indices;
+    indices.reserve(results.size());
+    for (int i = 0; i < results.size(); i++) indices.append(i);
+
+    GradeStats* output = results.data();
+    QtConcurrent::blockingMap(indices, [&](int index) {
+        thread_local std::vector<float> scratch;
+        const Range& range = ranges[index];
+        computeRange(m_scores.data() + range.offset, range.count, output[index], scratch);
+    });
+
+    m_lastComputeMs = timer.elapsed();
+    return results;
+}
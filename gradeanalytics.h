@@ -0,0 +1,60 @@
+#ifndef GRADEANALYTICS_H
+#define GRADEANALYTICS_H
+
+#include <QList>
+#include <QString>
+#include <array>
+#include <vector>
+
+// 成绩分布统计：一个分组（课程或学期）的全部统计量
+struct GradeStats {
+    int groupId = 0;            // 课程ID或学期ID
+    QString label;              // 课程名称（学期）或学期名称
+    int count = 0;
+    double mean = 0;
+    double stddev = 0;
+    float min = 0;
+    float max = 0;
+    float median = 0;
+    float p25 = 0;
+    float p75 = 0;
+    float p90 = 0;
+    double passRate = 0;        // 成绩>=60的比例
+    std::array<int, 10> histogram{};  // [0,10) [10,20) ... [90,100]
+};
+
+// 成绩分析引擎：把 enrollments.score 载入按 学期→课程 排好的连续float数组，
+// 每门课程、每个学期都是数组上的一段连续区间，统计时按分组并行计算
+class GradeAnalytics
+{
+public:
+    enum class GroupBy { Course, Semester };
+
+    // teacherId>0 时只载入该教师所授课程；返回载入的成绩条数，失败返回-1
+    int load(int teacherId = 0);
+    QList<GradeStats> compute(GroupBy groupBy) const;
+
+    int scoreCount() const { return static_cast<int>(m_scores.size()); }
+    qint64 lastLoadMs() const { return m_lastLoadMs; }
+    qint64 lastComputeMs() const { return m_lastComputeMs; }
+
+    // 单个分组的统计核函数（scratch 为排序用的临时缓冲区）
+    static void computeRange(const float* scores, int count, GradeStats& stats,
+                             std::vector<float>& scratch);
+
+private:
+    struct Range {
+        int groupId;
+        QString label;
+        int offset;
+        int count;
+    };
+
+    std::vector<float> m_scores;
+    std::vector<Range> m_courseRanges;
+    std::vector<Range> m_semesterRanges;
+    qint64 m_lastLoadMs = 0;
+    mutable qint64 m_lastComputeMs = 0;
+};
+
+#endif // GRADEANALYTICS_H
@@ -0,0 +1,323 @@
+#include "gradebookwidget.h"
+#include "database.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QSplitter>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QApplication>
+#include <QClipboard>
+#include <QShortcut>
+#include <QKeySequence>
+
+namespace {
+const int kScoreColumn = 2;
+const QColor kPendingColor(255, 243, 205);
+}
+
+GradebookWidget::GradebookWidget(QWidget *parent)
+    : QWidget(parent)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    QLabel *titleLabel = new QLabel("成绩册");
+    titleLabel->setAlignment(Qt::AlignCenter);
+    titleLabel->setStyleSheet("font-size: 14px; font-weight: bold;");
+    layout->addWidget(titleLabel);
+
+    QSplitter *splitter = new QSplitter(Qt::Horizontal);
+
+    courseList = new QListWidget();
+    courseList->setMaximumWidth(260);
+    splitter->addWidget(courseList);
+
+    gradeTable = new QTableWidget();
+    gradeTable->setColumnCount(3);
+    gradeTable->setHorizontalHeaderLabels({"学生学号", "学生姓名", "成绩"});
+    gradeTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    gradeTable->setAlternatingRowColors(true);
+    gradeTable->setEditTriggers(QAbstractItemView::DoubleClicked |
+                                QAbstractItemView::EditKeyPressed |
+                                QAbstractItemView::AnyKeyPressed);
+    splitter->addWidget(gradeTable);
+    splitter->setStretchFactor(1, 1);
+    layout->addWidget(splitter);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    submitButton = new QPushButton("提交成绩");
+    submitButton->setStyleSheet("background-color: #228B22; color: white; padding: 5px;");
+    discardButton = new QPushButton("撤销修改");
+    reloadButton = new QPushButton("刷新");
+    buttonLayout->addWidget(submitButton);
+    buttonLayout->addWidget(discardButton);
+    buttonLayout->addWidget(reloadButton);
+    buttonLayout->addStretch();
+    statusLabel = new QLabel();
+    buttonLayout->addWidget(statusLabel);
+    layout->addLayout(buttonLayout);
+
+    // 从表格软件复制的一整列成绩，从当前行开始向下填入
+    QShortcut *pasteShortcut = new QShortcut(QKeySequence::Paste, gradeTable);
+    pasteShortcut->setContext(Qt::WidgetWithChildrenShortcut);
+
+    connect(courseList, &QListWidget::currentRowChanged, this, &GradebookWidget::onCourseSelected);
+    connect(gradeTable, &QTableWidget::itemChanged, this, &GradebookWidget::onScoreEdited);
+    connect(pasteShortcut, &QShortcut::activated, this, &GradebookWidget::onPaste);
+    connect(submitButton, &QPushButton::clicked, this, &GradebookWidget::onSubmit);
+    connect(discardButton, &QPushButton::clicked, this, &GradebookWidget::onDiscard);
+    connect(reloadButton, &QPushButton::clicked, this, &GradebookWidget::onReload);
+
+    updateStatus();
+}
+
+void GradebookWidget::setCourses(const QList<QMap<QString, QVariant>>& teachings)
+{
+    const int previousCourseId = m_currentCourseId;
+
+    courseList->blockSignals(true);
+    courseList->clear();
+    int selectRow = -1;
+    for (const auto& teaching : teachings) {
+        const int courseId = teaching["course_id"].toInt();
+        QListWidgetItem *item = new QListWidgetItem(
+            QString("%1（%2）").arg(teaching["course_name"].toString(),
+                                   teaching["semester"].toString()));
+        item->setData(Qt::UserRole, courseId);
+        courseList->addItem(item);
+        if (courseId == previousCourseId) {
+            selectRow = courseList->count() - 1;
+        }
+    }
+    courseList->blockSignals(false);
+
+    // 授课列表刷新时丢弃已加载的页，未提交的修改保留
+    m_pages.clear();
+    m_currentCourseId = 0;
+    gradeTable->setRowCount(0);
+    if (selectRow >= 0) {
+        courseList->setCurrentRow(selectRow);
+    }
+    updateStatus();
+}
+
+bool GradebookWidget::hasPendingEdits() const
+{
+    for (const auto& edits : m_pendingEdits) {
+        if (!edits.isEmpty()) return true;
+    }
+    return false;
+}
+
+void GradebookWidget::onCourseSelected()
+{
+    QListWidgetItem *item = courseList->currentItem();
+    if (!item) return;
+    showCourse(item->data(Qt::UserRole).toInt());
+}
+
+void GradebookWidget::showCourse(int courseId)
+{
+    m_currentCourseId = courseId;
+
+    if (!m_pages.contains(courseId)) {
+        QList<GradeRow> rows;
+        for (const auto& row : Database::getInstance().getCourseGradebook(courseId)) {
+            rows.append({row["student_id"].toInt(), row["student_name"].toString(), row["score"]});
+        }
+        m_pages.insert(courseId, rows);
+    }
+
+    const QList<GradeRow>& rows = m_pages[courseId];
+    const QMap<int, QVariant> edits = m_pendingEdits.value(courseId);
+
+    gradeTable->blockSignals(true);
+    gradeTable->setUpdatesEnabled(false);
+    gradeTable->setRowCount(rows.size());
+    for (int row = 0; row < rows.size(); row++) {
+        const GradeRow& grade = rows[row];
+
+        QTableWidgetItem *idItem = new QTableWidgetItem(QString::number(grade.studentId));
+        idItem->setFlags(idItem->flags() & ~Qt::ItemIsEditable);
+        QTableWidgetItem *nameItem = new QTableWidgetItem(grade.studentName);
+        nameItem->setFlags(nameItem->flags() & ~Qt::ItemIsEditable);
+
+        const bool pending = edits.contains(grade.studentId);
+        QTableWidgetItem *scoreItem = new QTableWidgetItem(
+            (pending ? edits[grade.studentId] : grade.score).toString());
+        if (pending) {
+            scoreItem->setBackground(kPendingColor);
+        }
+
+        gradeTable->setItem(row, 0, idItem);
+        gradeTable->setItem(row, 1, nameItem);
+        gradeTable->setItem(row, kScoreColumn, scoreItem);
+    }
+    gradeTable->setUpdatesEnabled(true);
+    gradeTable->blockSignals(false);
+
+    updateStatus();
+}
+
+bool GradebookWidget::parseScore(const QString& text, QVariant& score)
+{
+    bool ok = false;
+    const double value = text.trimmed().toDouble(&ok);
+    if (!ok || value < 0 || value > 100) return false;
+    score = qRound(value * 10) / 10.0;  // 与 DECIMAL(4,1) 一致
+    return true;
+}
+
+void GradebookWidget::setPendingScore(int row, const QString& text)
+{
+    QList<GradeRow>& rows = m_pages[m_currentCourseId];
+    if (row < 0 || row >= rows.size()) return;
+
+    QTableWidgetItem *item = gradeTable->item(row, kScoreColumn);
+    QVariant score;
+    if (!parseScore(text, score)) {
+        // 非法输入恢复为当前值
+        const QMap<int, QVariant>& edits = m_pendingEdits[m_currentCourseId];
+        item->setText(edits.value(rows[row].studentId, rows[row].score).toString());
+        return;
+    }
+
+    QMap<int, QVariant>& edits = m_pendingEdits[m_currentCourseId];
+    item->setText(score.toString());
+    if (qFuzzyCompare(score.toDouble() + 1, rows[row].score.toDouble() + 1)) {
+        edits.remove(rows[row].studentId);
+        item->setBackground(QBrush());
+    } else {
+        edits.insert(rows[row].studentId, score);
+        item->setBackground(kPendingColor);
+    }
+}
+
+void GradebookWidget::onScoreEdited(QTableWidgetItem *item)
+{
+    if (item->column() != kScoreColumn || m_currentCourseId == 0) return;
+
+    gradeTable->blockSignals(true);
+    setPendingScore(item->row(), item->text());
+    gradeTable->blockSignals(false);
+    updateStatus();
+}
+
+void GradebookWidget::onPaste()
+{
+    if (m_currentCourseId == 0) return;
+
+    QStringList lines = QApplication::clipboard()->text().split('\n');
+    while (!lines.isEmpty() && lines.last().trimmed().isEmpty()) {
+        lines.removeLast();
+    }
+    if (lines.isEmpty()) return;
+
+    const int startRow = qMax(0, gradeTable->currentRow());
+    int invalid = 0;
+
+    gradeTable->blockSignals(true);
+    for (int i = 0; i < lines.size() && startRow + i < gradeTable->rowCount(); i++) {
+        // 多列复制时只取第一列
+        const QString text = lines[i].section('\t', 0, 0).trimmed();
+        QVariant score;
+        if (!parseScore(text, score)) {
+            invalid++;
+            continue;
+        }
+        setPendingScore(startRow + i, text);
+    }
+    gradeTable->blockSignals(false);
+    updateStatus();
+
+    if (invalid > 0) {
+        QMessageBox::warning(this, "粘贴成绩", QString("有 %1 个值不是0-100之间的数字，已跳过").arg(invalid));
+    }
+}
+
+void GradebookWidget::onSubmit()
+{
+    Database& db = Database::getInstance();
+    int submitted = 0;
+    QStringList failed;
+    QStringList dropped;
+
+    for (auto it = m_pendingEdits.begin(); it != m_pendingEdits.end(); ) {
+        if (it.value().isEmpty()) {
+            it = m_pendingEdits.erase(it);
+            continue;
+        }
+        QList<int> stale;
+        if (!db.updateEnrollmentScores(it.key(), it.value(), &stale)) {
+            failed << QString::number(it.key());
+            ++it;
+            continue;
+        }
+
+        if (!stale.isEmpty()) {
+            // 加载后已退选的学生没有写入，该页重新加载
+            for (int studentId : stale) {
+                dropped << QString("课程 %1 学号 %2").arg(it.key()).arg(studentId);
+            }
+            m_pages.remove(it.key());
+        } else if (m_pages.contains(it.key())) {
+            // 提交成功后把新成绩写回已加载的页
+            for (GradeRow& row : m_pages[it.key()]) {
+                if (it.value().contains(row.studentId)) {
+                    row.score = it.value()[row.studentId];
+                }
+            }
+        }
+        submitted += it.value().size() - stale.size();
+        it = m_pendingEdits.erase(it);
+    }
+
+    if (m_currentCourseId != 0) {
+        showCourse(m_currentCourseId);
+    }
+
+    if (!dropped.isEmpty()) {
+        QMessageBox::warning(this, "部分成绩未保存",
+                             "以下学生已退选，成绩未保存，成绩册已重新加载：\n" + dropped.join("\n"));
+    }
+    if (!failed.isEmpty()) {
+        QMessageBox::warning(this, "提交失败",
+                             QString("课程 %1 的成绩提交失败，修改已保留").arg(failed.join(", ")));
+    } else if (submitted > 0) {
+        QMessageBox::information(this, "提交成功", QString("已提交 %1 条成绩").arg(submitted));
+    }
+}
+
+void GradebookWidget::onDiscard()
+{
+    if (!hasPendingEdits()) return;
+
+    if (QMessageBox::question(this, "撤销修改", "确定要放弃所有未提交的成绩修改吗？") !=
+        QMessageBox::Yes) {
+        return;
+    }
+    m_pendingEdits.clear();
+    if (m_currentCourseId != 0) {
+        showCourse(m_currentCourseId);
+    }
+}
+
+void GradebookWidget::onReload()
+{
+    if (m_currentCourseId == 0) return;
+
+    m_pages.remove(m_currentCourseId);
+    showCourse(m_currentCourseId);
+}
+
+void GradebookWidget::updateStatus()
+{
+    int pending = 0;
+    for (const auto& edits : m_pendingEdits) {
+        pending += edits.size();
+    }
+
+    submitButton->setEnabled(pending > 0);
+    discardButton->setEnabled(pending > 0);
+    statusLabel->setText(pending > 0 ? QString("未提交的修改: %1 条").arg(pending)
+                                     : QString("没有未提交的修改"));
+}
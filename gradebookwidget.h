@@ -0,0 +1,58 @@
+#ifndef GRADEBOOKWIDGET_H
+#define GRADEBOOKWIDGET_H
+
+#include <QWidget>
+#include <QListWidget>
+#include <QTableWidget>
+#include <QPushButton>
+#include <QLabel>
+#include <QHash>
+#include <QMap>
+#include <QVariant>
+
+// 教师成绩册：每门课程（学期）一页，打开时才加载该课程的学生；
+// 成绩可直接编辑或整列粘贴，修改先缓存在本地，提交时每门课程一个事务
+class GradebookWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit GradebookWidget(QWidget *parent = nullptr);
+
+    // 教师授课列表（字段同 Database::getTeacherTeachings）
+    void setCourses(const QList<QMap<QString, QVariant>>& teachings);
+    bool hasPendingEdits() const;
+
+private slots:
+    void onCourseSelected();
+    void onScoreEdited(QTableWidgetItem *item);
+    void onPaste();
+    void onSubmit();
+    void onDiscard();
+    void onReload();
+
+private:
+    struct GradeRow {
+        int studentId;
+        QString studentName;
+        QVariant score;
+    };
+
+    void showCourse(int courseId);
+    void setPendingScore(int row, const QString& text);
+    void updateStatus();
+    static bool parseScore(const QString& text, QVariant& score);
+
+    QListWidget *courseList;
+    QTableWidget *gradeTable;
+    QPushButton *submitButton;
+    QPushButton *discardButton;
+    QPushButton *reloadButton;
+    QLabel *statusLabel;
+
+    int m_currentCourseId = 0;
+    QHash<int, QList<GradeRow>> m_pages;            // 已加载的课程页
+    QHash<int, QMap<int, QVariant>> m_pendingEdits; // 课程 -> (学号 -> 新成绩)
+};
+
+#endif // GRADEBOOKWIDGET_H
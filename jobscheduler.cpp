@@ -0,0 +1,351 @@
+#include "jobscheduler.h"
+#include "database.h"
+#include <QCoreApplication>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QSysInfo>
+#include <QThread>
+#include <QSet>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// jobs 表中保存的状态/通道代码，与 JobScheduler::Status/Lane 的顺序一致
+const char* const kStatusCodes[] = {"queued", "running", "succeeded", "failed", "cancelled", "interrupted"};
+const char* const kLaneCodes[] = {"interactive", "batch"};
+
+QString statusCode(JobScheduler::Status status)
+{
+    return kStatusCodes[static_cast<int>(status)];
+}
+
+JobScheduler::Status statusFromCode(const QString& code)
+{
+    for (int i = 0; i < 6; i++) {
+        if (code == kStatusCodes[i]) return static_cast<JobScheduler::Status>(i);
+    }
+    return JobScheduler::Status::Interrupted;
+}
+
+bool isFinished(JobScheduler::Status status)
+{
+    return status != JobScheduler::Status::Queued && status != JobScheduler::Status::Running;
+}
+
+QVariant nullableTime(const QDateTime& time)
+{
+    return time.isValid() ? QVariant(time) : QVariant();
+}
+
+} // namespace
+
+bool JobContext::isCancelled() const
+{
+    return JobScheduler::getInstance().isCancelled(m_jobId);
+}
+
+void JobContext::setProgress(int percent, const QString& message)
+{
+    JobScheduler::getInstance().reportProgress(m_jobId, percent, message);
+}
+
+JobScheduler& JobScheduler::getInstance()
+{
+    static JobScheduler instance;
+    return instance;
+}
+
+JobScheduler::JobScheduler()
+{
+    // 交互通道线程少、优先级正常；批处理通道低优先级，最多占四分之一的核
+    m_interactivePool.setMaxThreadCount(2);
+    m_batchPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 4));
+    m_batchPool.setThreadPriority(QThread::LowPriority);
+
+    m_runner = QString("%1:%2").arg(QSysInfo::machineHostName())
+                   .arg(QCoreApplication::applicationPid());
+
+    // 启动时先检查一次，之后随心跳定时检查（上次运行刚崩溃时心跳要过一段时间才超时）
+    heartbeat();
+    connect(&m_heartbeatTimer, &QTimer::timeout, this, &JobScheduler::heartbeat);
+    m_heartbeatTimer.start(kHeartbeatIntervalMs);
+}
+
+void JobScheduler::heartbeat()
+{
+    QSqlQuery query(Database::getInstance().connection());
+    query.prepare("UPDATE jobs SET heartbeat_at = NOW() "
+                  "WHERE status IN ('queued', 'running') AND runner = ?");
+    query.addBindValue(m_runner);
+    if (!query.exec()) {
+        qWarning() << "刷新任务心跳失败:" << query.lastError().text();
+    }
+
+    // 其他实例（包括本机上次运行）的任务只有心跳超时才视为中断，仍在运行的实例不受影响
+    query.prepare("UPDATE jobs SET status = 'interrupted', finished_at = NOW() "
+                  "WHERE status IN ('queued', 'running') AND runner <> ? "
+                  "AND IFNULL(heartbeat_at, created_at) < NOW() - INTERVAL ? SECOND");
+    query.addBindValue(m_runner);
+    query.addBindValue(kStaleSeconds);
+    if (!query.exec()) {
+        qWarning() << "标记中断任务失败:" << query.lastError().text();
+    } else if (query.numRowsAffected() > 0) {
+        qDebug() << "已退出实例未结束的任务已标记为中断:" << query.numRowsAffected();
+    }
+}
+
+int JobScheduler::threadCount(Lane lane) const
+{
+    return lane == Lane::Interactive ? m_interactivePool.maxThreadCount()
+                                     : m_batchPool.maxThreadCount();
+}
+
+QString JobScheduler::laneName(Lane lane)
+{
+    return lane == Lane::Interactive ? "交互" : "批处理";
+}
+
+QString JobScheduler::statusName(Status status)
+{
+    switch (status) {
+    case Status::Queued: return "排队中";
+    case Status::Running: return "运行中";
+    case Status::Succeeded: return "已完成";
+    case Status::Failed: return "失败";
+    case Status::Cancelled: return "已取消";
+    case Status::Interrupted: return "已中断";
+    }
+    return QString();
+}
+
+int JobScheduler::submit(const QString& name, Lane lane, Work work,
+                         std::function<void(const JobInfo&)> onFinished)
+{
+    auto job = std::make_shared<Job>();
+    job->info.name = name;
+    job->info.lane = lane;
+    job->info.createdAt = QDateTime::currentDateTime();
+    job->work = std::move(work);
+    job->onFinished = std::move(onFinished);
+
+    QSqlQuery query(Database::getInstance().connection());
+    query.prepare("INSERT INTO jobs (name, lane, status, runner, heartbeat_at) "
+                  "VALUES (?, ?, 'queued', ?, NOW())");
+    query.addBindValue(name);
+    query.addBindValue(kLaneCodes[static_cast<int>(lane)]);
+    query.addBindValue(m_runner);
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (query.exec()) {
+            job->info.id = query.lastInsertId().toInt();
+        } else {
+            qWarning() << "保存任务失败，仅在本次运行中跟踪:" << query.lastError().text();
+            job->info.id = m_nextLocalId--;
+        }
+        m_jobs.insert(job->info.id, job);
+    }
+
+    const int jobId = job->info.id;
+    QThreadPool& pool = lane == Lane::Interactive ? m_interactivePool : m_batchPool;
+    pool.start([this, jobId]() { run(jobId); });
+    emit jobChanged(jobId);
+    return jobId;
+}
+
+void JobScheduler::run(int jobId)
+{
+    std::shared_ptr<Job> job;
+    JobInfo info;
+    {
+        QMutexLocker locker(&m_mutex);
+        job = m_jobs.value(jobId);
+        // 排队期间已被取消
+        if (!job || job->info.status != Status::Queued) return;
+        if (!job->cancelRequested) {
+            job->info.status = Status::Running;
+            job->info.startedAt = QDateTime::currentDateTime();
+            job->sinceSaved.start();
+            info = job->info;
+        }
+    }
+    if (info.status != Status::Running) {
+        finish(jobId, Status::Cancelled);
+        return;
+    }
+    save(info);
+    emit jobChanged(jobId);
+
+    QElapsedTimer timer;
+    timer.start();
+    JobContext context(jobId);
+    const bool ok = job->work(context);
+
+    const Status status = ok ? Status::Succeeded
+                             : (isCancelled(jobId) ? Status::Cancelled : Status::Failed);
+    qDebug() << "任务" << jobId << info.name << statusName(status) << "耗时" << timer.elapsed() << "毫秒";
+    finish(jobId, status);
+}
+
+void JobScheduler::reportProgress(int jobId, int percent, const QString& message)
+{
+    JobInfo info;
+    bool persist = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        std::shared_ptr<Job> job = m_jobs.value(jobId);
+        if (!job || job->info.status != Status::Running) return;
+
+        percent = qBound(0, percent, 100);
+        const bool percentChanged = percent != job->info.progress;
+        if (!percentChanged && (message.isEmpty() || message == job->info.message)) return;
+        job->info.progress = percent;
+        if (!message.isEmpty()) job->info.message = message;
+
+        // 进度可能汇报得很频繁：写库和通知界面都按间隔节流，百分比变化时总是通知
+        if (job->sinceSaved.elapsed() >= kSaveIntervalMs) {
+            job->sinceSaved.restart();
+            persist = true;
+            info = job->info;
+        } else if (!percentChanged) {
+            return;
+        }
+    }
+    if (persist) save(info);
+    emit jobChanged(jobId);
+}
+
+bool JobScheduler::isCancelled(int jobId) const
+{
+    QMutexLocker locker(&m_mutex);
+    std::shared_ptr<Job> job = m_jobs.value(jobId);
+    return !job || job->cancelRequested;
+}
+
+bool JobScheduler::cancel(int jobId)
+{
+    bool queued = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        std::shared_ptr<Job> job = m_jobs.value(jobId);
+        if (!job || isFinished(job->info.status)) return false;
+        job->cancelRequested = true;
+        queued = job->info.status == Status::Queued;
+    }
+    // 排队中的任务直接结束，不必等到轮到它；运行中的任务由自己检查后停下
+    if (queued) finish(jobId, Status::Cancelled);
+    return true;
+}
+
+void JobScheduler::finish(int jobId, Status status)
+{
+    JobInfo info;
+    std::function<void(const JobInfo&)> onFinished;
+    {
+        QMutexLocker locker(&m_mutex);
+        std::shared_ptr<Job> job = m_jobs.value(jobId);
+        if (!job || isFinished(job->info.status)) return;
+        job->info.status = status;
+        job->info.finishedAt = QDateTime::currentDateTime();
+        if (status == Status::Succeeded) job->info.progress = 100;
+        info = job->info;
+        onFinished = std::move(job->onFinished);
+        job->work = nullptr;
+    }
+    save(info);
+    emit jobChanged(jobId);
+
+    if (onFinished) {
+        QMetaObject::invokeMethod(this, [onFinished, info]() { onFinished(info); },
+                                  Qt::QueuedConnection);
+    }
+}
+
+void JobScheduler::save(const JobInfo& info)
+{
+    if (info.id <= 0) return;
+
+    QSqlQuery query(Database::getInstance().connection());
+    query.prepare("UPDATE jobs SET status = ?, progress = ?, message = ?, "
+                  "started_at = ?, finished_at = ?, heartbeat_at = NOW() WHERE job_id = ?");
+    query.addBindValue(statusCode(info.status));
+    query.addBindValue(info.progress);
+    query.addBindValue(info.message.left(500));
+    query.addBindValue(nullableTime(info.startedAt));
+    query.addBindValue(nullableTime(info.finishedAt));
+    query.addBindValue(info.id);
+    if (!query.exec()) {
+        qWarning() << "保存任务状态失败:" << query.lastError().text();
+    }
+}
+
+JobScheduler::JobInfo JobScheduler::job(int jobId) const
+{
+    QMutexLocker locker(&m_mutex);
+    std::shared_ptr<Job> job = m_jobs.value(jobId);
+    return job ? job->info : JobInfo();
+}
+
+QList<JobScheduler::JobInfo> JobScheduler::jobs(int historyLimit) const
+{
+    QList<JobInfo> result;
+    QSet<int> seen;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (const auto& job : m_jobs) {
+            result << job->info;
+            seen.insert(job->info.id);
+        }
+    }
+
+    QSqlQuery query(Database::getInstance().connection());
+    query.setForwardOnly(true);
+    query.prepare("SELECT job_id, name, lane, status, progress, message, "
+                  "created_at, started_at, finished_at "
+                  "FROM jobs ORDER BY job_id DESC LIMIT ?");
+    query.addBindValue(historyLimit);
+    if (query.exec()) {
+        while (query.next()) {
+            const int id = query.value(0).toInt();
+            if (seen.contains(id)) continue;
+            JobInfo info;
+            info.id = id;
+            info.name = query.value(1).toString();
+            info.lane = query.value(2).toString() == kLaneCodes[0] ? Lane::Interactive : Lane::Batch;
+            info.status = statusFromCode(query.value(3).toString());
+            info.progress = query.value(4).toInt();
+            info.message = query.value(5).toString();
+            info.createdAt = query.value(6).toDateTime();
+            info.startedAt = query.value(7).toDateTime();
+            info.finishedAt = query.value(8).toDateTime();
+            result << info;
+        }
+    } else {
+        qWarning() << "载入任务历史失败:" << query.lastError().text();
+    }
+
+    // 本地ID为负数，排在最后
+    std::sort(result.begin(), result.end(), [](const JobInfo& a, const JobInfo& b) {
+        if ((a.id > 0) != (b.id > 0)) return a.id > 0;
+        return a.id > 0 ? a.id > b.id : a.id < b.id;
+    });
+    return result;
+}
+
+void JobScheduler::shutdown()
+{
+    m_heartbeatTimer.stop();
+    QList<int> pending;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (auto it = m_jobs.constBegin(); it != m_jobs.constEnd(); ++it) {
+            if (!isFinished(it.value()->info.status)) pending << it.key();
+        }
+    }
+    for (int jobId : pending) {
+        cancel(jobId);
+    }
+    m_interactivePool.waitForDone();
+    m_batchPool.waitForDone();
+}
@@ -0,0 +1,117 @@
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <functional>
+#include <memory>
+
+class JobScheduler;
+
+// 任务执行时拿到的上下文：汇报进度、检查是否已被取消（取消是协作式的，由任务自己在合适的位置停下）
+class JobContext
+{
+public:
+    int jobId() const { return m_jobId; }
+    bool isCancelled() const;
+    // percent 为0-100；message 同时作为任务结束时的说明
+    void setProgress(int percent, const QString& message = QString());
+
+private:
+    friend class JobScheduler;
+    explicit JobContext(int jobId) : m_jobId(jobId) {}
+    int m_jobId;
+};
+
+// 后台任务调度：交互通道和批处理通道各用一个线程池，线程各自使用独立的数据库连接
+// （Database::connection() 按线程分配），批处理任务占满时不影响界面查询和交互任务。
+// 任务状态写入 jobs 表，运行期间定时刷新本实例任务的心跳；心跳超时的实例
+// （已退出或崩溃）留下的排队/运行中任务由任意存活实例标记为中断
+class JobScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static JobScheduler& getInstance();
+
+    enum class Lane { Interactive, Batch };
+    enum class Status { Queued, Running, Succeeded, Failed, Cancelled, Interrupted };
+
+    struct JobInfo {
+        int id = 0;
+        QString name;
+        Lane lane = Lane::Batch;
+        Status status = Status::Queued;
+        int progress = 0;
+        QString message;
+        QDateTime createdAt;
+        QDateTime startedAt;
+        QDateTime finishedAt;
+    };
+
+    // 任务返回 false 表示失败；onFinished 在主线程调用
+    using Work = std::function<bool(JobContext&)>;
+    int submit(const QString& name, Lane lane, Work work,
+               std::function<void(const JobInfo&)> onFinished = nullptr);
+    // 排队中的任务不再执行，运行中的任务在下次检查时停下；已结束的任务返回false
+    bool cancel(int jobId);
+    // 通道的最大线程数，任务内部再并行时按此限制线程数
+    int threadCount(Lane lane) const;
+
+    // 本次运行提交的任务 + jobs 表中最近的历史记录，按ID倒序
+    QList<JobInfo> jobs(int historyLimit = 200) const;
+    // 本次运行提交的任务，不存在时 id 为0
+    JobInfo job(int jobId) const;
+
+    static QString laneName(Lane lane);
+    static QString statusName(Status status);
+
+    // 程序退出前调用：取消全部任务并等待运行中的任务停下
+    void shutdown();
+
+signals:
+    // 任务状态或进度变化（可能从工作线程发出）
+    void jobChanged(int jobId);
+
+private:
+    JobScheduler();
+    JobScheduler(const JobScheduler&) = delete;
+    JobScheduler& operator=(const JobScheduler&) = delete;
+
+    struct Job {
+        JobInfo info;
+        Work work;
+        std::function<void(const JobInfo&)> onFinished;
+        bool cancelRequested = false;
+        QElapsedTimer sinceSaved;   // 进度写库节流
+    };
+
+    friend class JobContext;
+    void run(int jobId);
+    void reportProgress(int jobId, int percent, const QString& message);
+    bool isCancelled(int jobId) const;
+    void finish(int jobId, Status status);
+    void save(const JobInfo& info);
+    void heartbeat();
+
+    static constexpr int kSaveIntervalMs = 500;
+    static constexpr int kHeartbeatIntervalMs = 60 * 1000;
+    static constexpr int kStaleSeconds = 3 * 60;     // 连续三次没有心跳视为实例已退出
+
+    QThreadPool m_interactivePool;
+    QThreadPool m_batchPool;
+    QTimer m_heartbeatTimer;
+    mutable QMutex m_mutex;
+    QHash<int, std::shared_ptr<Job>> m_jobs;
+    QString m_runner;               // 主机名:进程号
+    int m_nextLocalId = -1;         // jobs 表不可用时使用的本地ID
+};
+
+#endif // JOBSCHEDULER_H
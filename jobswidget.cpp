@@ -0,0 +1,293 @@
+#include "jobswidget.h"
+#include "database.h"
+#include "enrollmentcube.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QFile>
+#include <QTextStream>
+#include <QDebug>
+
+namespace {
+
+const int kCourseChunk = 500;       // 一致性检查每次比对的课程ID区间
+const int kExportChunk = 2000;      // 导出时每写这么多行汇报一次进度
+
+QString csvField(const QString& text)
+{
+    if (!text.contains(',') && !text.contains('"') && !text.contains('\n')) return text;
+    QString escaped = text;
+    escaped.replace("\"", "\"\"");
+    return QString("\"%1\"").arg(escaped);
+}
+
+// 课程已选人数按ID区间与选课表比对并修复，读模型和多维汇总行数不一致时整体重建
+bool checkIntegrity(JobContext& context)
+{
+    Database& database = Database::getInstance();
+    QSqlQuery query(database.connection());
+    if (!query.exec("SELECT MIN(course_id), MAX(course_id) FROM courses") || !query.next()) {
+        context.setProgress(0, "读取课程范围失败: " + query.lastError().text());
+        return false;
+    }
+
+    QList<int> mismatched;
+    if (!query.value(0).isNull()) {
+        const int minId = query.value(0).toInt();
+        const int maxId = query.value(1).toInt();
+        for (int from = minId; from <= maxId; from += kCourseChunk) {
+            if (context.isCancelled()) return false;
+            const int to = qMin(maxId, from + kCourseChunk - 1);
+            query.prepare("SELECT c.course_id FROM courses c "
+                          "LEFT JOIN (SELECT course_id, COUNT(*) AS n FROM enrollments "
+                          "           WHERE course_id BETWEEN ? AND ? GROUP BY course_id) e "
+                          "ON e.course_id = c.course_id "
+                          "WHERE c.course_id BETWEEN ? AND ? AND c.enrolled_count <> IFNULL(e.n, 0)");
+            query.addBindValue(from);
+            query.addBindValue(to);
+            query.addBindValue(from);
+            query.addBindValue(to);
+            if (!query.exec()) {
+                context.setProgress(0, "比对已选人数失败: " + query.lastError().text());
+                return false;
+            }
+            while (query.next()) {
+                mismatched << query.value(0).toInt();
+            }
+            const qint64 done = qint64(to - minId + 1) * 70 / (qint64(maxId - minId) + 1);
+            context.setProgress(static_cast<int>(done),
+                                QString("已比对课程ID %1-%2，不一致 %3 门").arg(minId).arg(to)
+                                    .arg(mismatched.size()));
+        }
+    }
+
+    if (context.isCancelled()) return false;
+    if (!mismatched.isEmpty()) {
+        QStringList ids;
+        for (int courseId : mismatched) ids << QString::number(courseId);
+        // 在一条语句内重新计数，期间的选课/退课由触发器照常维护
+        if (!query.exec(QString("UPDATE courses c SET enrolled_count = "
+                                "(SELECT COUNT(*) FROM enrollments e WHERE e.course_id = c.course_id) "
+                                "WHERE c.course_id IN (%1)").arg(ids.join(',')))) {
+            context.setProgress(70, "修复已选人数失败: " + query.lastError().text());
+            return false;
+        }
+        qWarning() << "已修复课程已选人数:" << ids;
+    }
+
+    context.setProgress(75, "检查选课读模型");
+    bool viewRebuilt = false;
+    if (query.exec("SELECT (SELECT COUNT(*) FROM enrollment_view) = (SELECT COUNT(*) FROM enrollments)")
+        && query.next() && !query.value(0).toBool()) {
+        if (context.isCancelled()) return false;
+        if (!database.rebuildEnrollmentView()) {
+            context.setProgress(80, "重建选课读模型失败");
+            return false;
+        }
+        viewRebuilt = true;
+    }
+
+    context.setProgress(90, "检查选课多维汇总");
+    bool cubeRebuilt = false;
+    if (!database.isEnrollmentCubeConsistent()) {
+        if (context.isCancelled()) return false;
+        if (!database.rebuildEnrollmentCube()) {
+            context.setProgress(95, "重建选课多维汇总失败");
+            return false;
+        }
+        cubeRebuilt = true;
+    }
+
+    context.setProgress(100, QString("已选人数修复 %1 门；读模型%2；多维汇总%3")
+                                 .arg(mismatched.size())
+                                 .arg(viewRebuilt ? "已重建" : "一致")
+                                 .arg(cubeRebuilt ? "已重建" : "一致"));
+    return true;
+}
+
+// 流式导出 enrollment_view，取消时删除未写完的文件
+bool exportEnrollments(JobContext& context, const QString& path)
+{
+    QSqlDatabase db = Database::getInstance().connection();
+    QSqlQuery countQuery(db);
+    qint64 total = 0;
+    if (countQuery.exec("SELECT COUNT(*) FROM enrollment_view") && countQuery.next()) {
+        total = countQuery.value(0).toLongLong();
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        context.setProgress(0, "无法写入文件: " + file.errorString());
+        return false;
+    }
+    // 带 BOM，Excel 打开时才能正确识别中文
+    file.write("\xEF\xBB\xBF");
+    QTextStream out(&file);
+    out << "学期,课程ID,课程名称,学号,姓名,成绩\n";
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT semester, course_id, course_name, student_id, student_name, score "
+                    "FROM enrollment_view ORDER BY semester_id DESC, course_id, student_id")) {
+        context.setProgress(0, "查询选课失败: " + query.lastError().text());
+        file.remove();
+        return false;
+    }
+
+    qint64 written = 0;
+    while (query.next()) {
+        out << csvField(query.value(0).toString()) << ',' << query.value(1).toInt() << ','
+            << csvField(query.value(2).toString()) << ',' << query.value(3).toInt() << ','
+            << csvField(query.value(4).toString()) << ',' << query.value(5).toString() << '\n';
+        if (++written % kExportChunk == 0) {
+            if (context.isCancelled()) {
+                out.flush();
+                file.close();
+                file.remove();
+                return false;
+            }
+            context.setProgress(total > 0 ? static_cast<int>(written * 100 / total) : 0,
+                                QString("已导出 %1/%2 行").arg(written).arg(total));
+        }
+    }
+    out.flush();
+    context.setProgress(100, QString("已导出 %1 行到 %2").arg(written).arg(path));
+    return true;
+}
+
+} // namespace
+
+JobsWidget::JobsWidget(QWidget *parent)
+    : QWidget(parent)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    QPushButton *integrityButton = new QPushButton("一致性检查");
+    integrityButton->setToolTip("比对课程已选人数、选课读模型和多维汇总，不一致时修复（批处理通道）");
+    QPushButton *exportButton = new QPushButton("导出选课成绩");
+    exportButton->setToolTip("把全部选课成绩导出为CSV（交互通道）");
+    cancelButton = new QPushButton("取消所选任务");
+    QPushButton *refreshButton = new QPushButton("刷新");
+    buttonLayout->addWidget(integrityButton);
+    buttonLayout->addWidget(exportButton);
+    buttonLayout->addWidget(cancelButton);
+    buttonLayout->addWidget(refreshButton);
+    buttonLayout->addStretch();
+    statusLabel = new QLabel();
+    buttonLayout->addWidget(statusLabel);
+    layout->addLayout(buttonLayout);
+
+    jobTable = new QTableWidget();
+    jobTable->setColumnCount(8);
+    jobTable->setHorizontalHeaderLabels({"ID", "任务", "通道", "状态", "进度", "说明", "提交时间", "耗时"});
+    jobTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    jobTable->horizontalHeader()->setSectionResizeMode(5, QHeaderView::Stretch);
+    jobTable->setAlternatingRowColors(true);
+    jobTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    jobTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    layout->addWidget(jobTable);
+
+    connect(integrityButton, &QPushButton::clicked, this, &JobsWidget::onCheckIntegrity);
+    connect(exportButton, &QPushButton::clicked, this, &JobsWidget::onExportEnrollments);
+    connect(cancelButton, &QPushButton::clicked, this, &JobsWidget::onCancel);
+    connect(refreshButton, &QPushButton::clicked, this, &JobsWidget::reload);
+    // 工作线程发出的通知排队到界面线程处理
+    connect(&JobScheduler::getInstance(), &JobScheduler::jobChanged,
+            this, &JobsWidget::onJobChanged, Qt::QueuedConnection);
+
+    reload();
+}
+
+void JobsWidget::reload()
+{
+    const QList<JobScheduler::JobInfo> jobs = JobScheduler::getInstance().jobs();
+    m_rows.clear();
+    jobTable->setRowCount(jobs.size());
+    for (int row = 0; row < jobs.size(); row++) {
+        m_rows.insert(jobs[row].id, row);
+        setRow(row, jobs[row]);
+    }
+    statusLabel->setText(QString("%1 个任务").arg(jobs.size()));
+}
+
+void JobsWidget::onJobChanged(int jobId)
+{
+    const JobScheduler::JobInfo info = JobScheduler::getInstance().job(jobId);
+    if (info.id == 0) return;
+    auto it = m_rows.constFind(jobId);
+    if (it == m_rows.constEnd()) {
+        // 新提交的任务：整表重新载入，保持按ID倒序
+        reload();
+        return;
+    }
+    setRow(it.value(), info);
+}
+
+void JobsWidget::setRow(int row, const JobScheduler::JobInfo& info)
+{
+    QString elapsed;
+    if (info.startedAt.isValid()) {
+        const QDateTime end = info.finishedAt.isValid() ? info.finishedAt : QDateTime::currentDateTime();
+        elapsed = QString("%1 秒").arg(info.startedAt.msecsTo(end) / 1000.0, 0, 'f', 1);
+    }
+
+    const QStringList values = {
+        QString::number(info.id), info.name, JobScheduler::laneName(info.lane),
+        JobScheduler::statusName(info.status), QString("%1%").arg(info.progress), info.message,
+        info.createdAt.toString("yyyy-MM-dd hh:mm:ss"), elapsed};
+    for (int column = 0; column < values.size(); column++) {
+        QTableWidgetItem *item = jobTable->item(row, column);
+        if (!item) {
+            item = new QTableWidgetItem();
+            jobTable->setItem(row, column, item);
+        }
+        item->setText(values[column]);
+    }
+    jobTable->item(row, 0)->setData(Qt::UserRole, info.id);
+
+    QColor color;
+    if (info.status == JobScheduler::Status::Failed || info.status == JobScheduler::Status::Interrupted) {
+        color = QColor("#f56c6c");
+    } else if (info.status == JobScheduler::Status::Succeeded) {
+        color = QColor("#67c23a");
+    }
+    jobTable->item(row, 3)->setForeground(color.isValid() ? QBrush(color) : QBrush());
+}
+
+void JobsWidget::onCheckIntegrity()
+{
+    JobScheduler::getInstance().submit("一致性检查", JobScheduler::Lane::Batch, checkIntegrity,
+                                       [](const JobScheduler::JobInfo& info) {
+        // 汇总可能已重建，内存中的多维汇总下次使用时重新载入
+        if (info.status == JobScheduler::Status::Succeeded) {
+            EnrollmentCube::getInstance().invalidate();
+        }
+    });
+}
+
+void JobsWidget::onExportEnrollments()
+{
+    const QString path = QFileDialog::getSaveFileName(this, "导出选课成绩", "选课成绩.csv",
+                                                      "CSV 文件 (*.csv)");
+    if (path.isEmpty()) return;
+
+    JobScheduler::getInstance().submit("导出选课成绩", JobScheduler::Lane::Interactive,
+                                       [path](JobContext& context) {
+        return exportEnrollments(context, path);
+    });
+}
+
+void JobsWidget::onCancel()
+{
+    const int row = jobTable->currentRow();
+    if (row < 0 || !jobTable->item(row, 0)) return;
+    const int jobId = jobTable->item(row, 0)->data(Qt::UserRole).toInt();
+    if (!JobScheduler::getInstance().cancel(jobId)) {
+        QMessageBox::information(this, "取消任务", "该任务已结束或不是本次运行提交的任务");
+    }
+}
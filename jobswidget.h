@@ -0,0 +1,35 @@
+#ifndef JOBSWIDGET_H
+#define JOBSWIDGET_H
+
+#include "jobscheduler.h"
+#include <QWidget>
+#include <QTableWidget>
+#include <QPushButton>
+#include <QLabel>
+#include <QHash>
+
+// 后台任务面板：提交维护任务（一致性检查、导出选课成绩），显示各任务的状态和进度，可取消
+class JobsWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit JobsWidget(QWidget *parent = nullptr);
+
+private slots:
+    void reload();
+    void onJobChanged(int jobId);
+    void onCheckIntegrity();
+    void onExportEnrollments();
+    void onCancel();
+
+private:
+    void setRow(int row, const JobScheduler::JobInfo& info);
+
+    QTableWidget *jobTable;
+    QPushButton *cancelButton;
+    QLabel *statusLabel;
+    QHash<int, int> m_rows;     // 任务ID → 表格行
+};
+
+#endif // JOBSWIDGET_H
@@ -0,0 +1,283 @@
+#include "loadgenerator.h"
+#include "database.h"
+#include "waitlist.h"
+#include <QSqlQuery>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+namespace {
+
+const char* const kOperationNames[] = {"登录", "浏览选课列表", "选课", "退课"};
+
+qint64 percentile(std::vector<qint64>& sorted, double q)
+{
+    if (sorted.empty()) return 0;
+    const size_t index = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+} // namespace
+
+LoadGenerator::LoadGenerator(const LoadTestConfig& config)
+    : m_config(config)
+{
+}
+
+bool LoadGenerator::prepare()
+{
+    Database& db = Database::getInstance();
+
+    for (const auto& row : db.executeSelect("students")) {
+        m_studentIds.append(row["student_id"].toInt());
+    }
+    if (m_studentIds.size() < m_config.sessions) {
+        qWarning() << "学生数" << m_studentIds.size() << "少于会话数" << m_config.sessions
+                   << "，部分会话会共用同一学生";
+    }
+    if (m_studentIds.isEmpty()) {
+        qWarning() << "students 表为空，无法模拟";
+        return false;
+    }
+
+    // 选课目标取当前学期的课程（与学生选课页一致），只保留前 N 门作为热门课程
+    for (const auto& row : db.getRegistrationCourses(m_studentIds.first())) {
+        m_courseIds.append(row["course_id"].toInt());
+    }
+    if (m_config.hotCourses > 0 && m_courseIds.size() > m_config.hotCourses) {
+        m_courseIds = m_courseIds.mid(0, m_config.hotCourses);
+    }
+    if (m_courseIds.isEmpty()) {
+        qWarning() << "没有可选课程，无法模拟";
+        return false;
+    }
+
+    if (m_config.capacity > 0) {
+        for (int courseId : m_courseIds) {
+            db.executeUpdate("courses", courseId, {{"capacity", m_config.capacity}});
+        }
+    }
+
+    qDebug() << "会话" << m_config.sessions << "学生" << m_studentIds.size()
+             << "热门课程" << m_courseIds.size();
+    return true;
+}
+
+void LoadGenerator::runSession(int index, SessionStats& stats)
+{
+    Database& db = Database::getInstance();
+    const int studentId = m_studentIds[index % m_studentIds.size()];
+    const QString username = QString::number(studentId);
+    const int totalWeight = m_config.loginWeight + m_config.listWeight + m_config.registerWeight;
+
+    QRandomGenerator random(static_cast<quint32>(index * 7919 + 17));
+    QSet<int> enrolled;
+    QElapsedTimer sessionTimer;
+    QElapsedTimer timer;
+    sessionTimer.start();
+
+    while (sessionTimer.elapsed() < m_config.durationSeconds * 1000LL) {
+        const int pick = random.bounded(totalWeight);
+        Operation operation;
+        int courseId = 0;
+        if (pick < m_config.loginWeight) {
+            operation = Login;
+        } else if (pick < m_config.loginWeight + m_config.listWeight) {
+            operation = ListCourses;
+        } else {
+            // 已选的课程退掉，未选的去选，模拟选课日反复挑课
+            courseId = m_courseIds[random.bounded(m_courseIds.size())];
+            operation = enrolled.contains(courseId) ? Drop : Register;
+        }
+
+        bool ok = true;
+        timer.start();
+        switch (operation) {
+        case Login: {
+            int userId = 0;
+            ok = db.validateUser(username, m_config.password, 0, userId);
+            break;
+        }
+        case ListCourses:
+            ok = !db.getRegistrationCourses(studentId).isEmpty();
+            break;
+        case Register:
+            switch (db.registerCourse(studentId, courseId)) {
+            case Database::RegistrationResult::Registered:
+                stats.registered++;
+                enrolled.insert(courseId);
+                break;
+            case Database::RegistrationResult::AlreadyEnrolled:
+                stats.alreadyEnrolled++;
+                enrolled.insert(courseId);
+                break;
+            case Database::RegistrationResult::CourseFull:
+                stats.courseFull++;
+                if (m_config.waitlist
+                    && WaitlistService::getInstance().join(studentId, courseId)
+                           == Database::WaitlistResult::Joined) {
+                    stats.waitlisted++;
+                }
+                break;
+            default:
+                ok = false;
+            }
+            break;
+        case Drop:
+            ok = db.dropCourse(studentId, courseId);
+            enrolled.remove(courseId);
+            break;
+        default:
+            break;
+        }
+        stats.latenciesUs[operation].push_back(timer.nsecsElapsed() / 1000);
+        if (!ok) {
+            stats.errors[operation]++;
+        }
+
+        if (m_config.thinkTimeMs > 0) {
+            QThread::msleep(m_config.thinkTimeMs);
+        }
+    }
+}
+
+void LoadGenerator::run()
+{
+    m_stats.assign(m_config.sessions, SessionStats());
+    m_before = readServerCounters();
+
+    // 每个会话先在自己的线程里建立连接，全部就绪后同时开始
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    QList<QThread*> threads;
+    for (int i = 0; i < m_config.sessions; i++) {
+        threads.append(QThread::create([this, i, &ready, &go]() {
+            Database::getInstance().connection();
+            ready++;
+            while (!go.load()) {
+                QThread::msleep(1);
+            }
+            runSession(i, m_stats[i]);
+        }));
+        threads.last()->start();
+    }
+
+    while (ready.load() < m_config.sessions) {
+        QThread::msleep(10);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    go = true;
+    for (QThread* thread : threads) {
+        thread->wait();
+        delete thread;
+    }
+    m_elapsedMs = timer.elapsed();
+
+    m_after = readServerCounters();
+}
+
+LoadGenerator::ServerCounters LoadGenerator::readServerCounters()
+{
+    ServerCounters counters;
+    QSqlDatabase db = Database::getInstance().connection();
+
+    QSqlQuery statusQuery("SHOW GLOBAL STATUS WHERE Variable_name IN "
+                          "('Innodb_row_lock_waits', 'Innodb_row_lock_time')", db);
+    while (statusQuery.next()) {
+        if (statusQuery.value(0).toString() == "Innodb_row_lock_waits") {
+            counters.rowLockWaits = statusQuery.value(1).toLongLong();
+        } else {
+            counters.rowLockTimeMs = statusQuery.value(1).toLongLong();
+        }
+    }
+
+    QSqlQuery deadlockQuery("SELECT COUNT FROM information_schema.INNODB_METRICS "
+                            "WHERE NAME = 'lock_deadlocks'", db);
+    if (deadlockQuery.next()) {
+        counters.deadlocks = deadlockQuery.value(0).toLongLong();
+    }
+    return counters;
+}
+
+void LoadGenerator::printReport() const
+{
+    const double seconds = m_elapsedMs / 1000.0;
+    std::printf("\n会话数 %d，持续 %.1f 秒\n\n", m_config.sessions, seconds);
+    std::printf("%-14s %10s %10s %10s %10s %10s %10s %8s\n",
+                "操作", "次数", "次/秒", "P50(ms)", "P95(ms)", "P99(ms)", "最大(ms)", "失败");
+
+    qint64 totalOperations = 0;
+    for (int op = 0; op < OperationCount; op++) {
+        std::vector<qint64> latencies;
+        int errors = 0;
+        for (const SessionStats& stats : m_stats) {
+            latencies.insert(latencies.end(), stats.latenciesUs[op].begin(),
+                             stats.latenciesUs[op].end());
+            errors += stats.errors[op];
+        }
+        std::sort(latencies.begin(), latencies.end());
+        totalOperations += static_cast<qint64>(latencies.size());
+
+        std::printf("%-14s %10zu %10.1f %10.2f %10.2f %10.2f %10.2f %8d\n",
+                    kOperationNames[op], latencies.size(),
+                    seconds > 0 ? latencies.size() / seconds : 0.0,
+                    percentile(latencies, 0.50) / 1000.0,
+                    percentile(latencies, 0.95) / 1000.0,
+                    percentile(latencies, 0.99) / 1000.0,
+                    latencies.empty() ? 0.0 : latencies.back() / 1000.0,
+                    errors);
+    }
+
+    int registered = 0, alreadyEnrolled = 0, courseFull = 0, waitlisted = 0;
+    for (const SessionStats& stats : m_stats) {
+        registered += stats.registered;
+        alreadyEnrolled += stats.alreadyEnrolled;
+        courseFull += stats.courseFull;
+        waitlisted += stats.waitlisted;
+    }
+
+    std::printf("\n总吞吐量: %.1f 次/秒\n", seconds > 0 ? totalOperations / seconds : 0.0);
+    std::printf("选课结果: 成功 %d，重复 %d，已满 %d\n", registered, alreadyEnrolled, courseFull);
+    std::printf("服务器: 死锁 %lld，行锁等待 %lld 次，行锁等待总时间 %lld ms\n",
+                static_cast<long long>(m_after.deadlocks - m_before.deadlocks),
+                static_cast<long long>(m_after.rowLockWaits - m_before.rowLockWaits),
+                static_cast<long long>(m_after.rowLockTimeMs - m_before.rowLockTimeMs));
+    const Database::ReadStats reads = Database::getInstance().readStats();
+    std::printf("读查询: 执行 %lld，合并 %lld，缓存命中 %lld（节省 %lld 次）\n",
+                static_cast<long long>(reads.executed), static_cast<long long>(reads.coalesced),
+                static_cast<long long>(reads.cacheHits),
+                static_cast<long long>(reads.coalesced + reads.cacheHits));
+    const Database::WriteStats writes = Database::getInstance().writeStats();
+    std::printf("写入提交: 事务提交 %lld，回滚 %lld，保存点 %lld，自动提交写入 %lld\n",
+                static_cast<long long>(writes.commits), static_cast<long long>(writes.rollbacks),
+                static_cast<long long>(writes.savepoints),
+                static_cast<long long>(writes.autocommitWrites));
+
+    if (m_config.waitlist) {
+        const WaitlistService::LatencyStats latency = WaitlistService::getInstance().latencyStats();
+        std::printf("候补: 加入 %d，递补事务 %d，递补人数 %d，"
+                    "释放到递补延迟 p50 %.2f ms / p95 %.2f ms / 最大 %.2f ms\n",
+                    waitlisted, latency.promotions, latency.promotedStudents,
+                    latency.p50Us / 1000.0, latency.p95Us / 1000.0, latency.maxUs / 1000.0);
+
+        // 一致性：不能超额选课，已选上的学生不应仍在候补中
+        QSqlQuery query(Database::getInstance().connection());
+        int overbooked = -1, stale = -1;
+        if (query.exec("SELECT COUNT(*) FROM courses "
+                       "WHERE capacity IS NOT NULL AND enrolled_count > capacity") && query.next()) {
+            overbooked = query.value(0).toInt();
+        }
+        if (query.exec("SELECT COUNT(*) FROM waitlist w JOIN enrollments e "
+                       "ON e.student_id = w.student_id AND e.course_id = w.course_id") && query.next()) {
+            stale = query.value(0).toInt();
+        }
+        std::printf("一致性: 超额课程 %d，已选仍在候补 %d\n", overbooked, stale);
+    }
+}
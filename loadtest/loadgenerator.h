@@ -0,0 +1,63 @@
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QList>
+#include <QString>
+#include <array>
+#include <vector>
+
+struct LoadTestConfig {
+    int sessions = 50;          // 并发模拟学生数，每个会话一个线程一条连接
+    int durationSeconds = 30;
+    int loginWeight = 20;       // 操作比例：登录 / 浏览选课列表 / 选课或退课
+    int listWeight = 50;
+    int registerWeight = 30;
+    int thinkTimeMs = 0;        // 每次操作后的停顿
+    int hotCourses = 5;         // 选课集中在前 N 门课程上，0 表示全部课程
+    int capacity = 0;           // >0 时测试前把热门课程容量设为该值
+    bool waitlist = false;      // 已满时加入候补，退课释放的名额自动递补
+    QString password = "123456";
+};
+
+// 选课日负载模拟：N 个学生会话并发执行登录、浏览和选课/退课，
+// 统计各操作的吞吐量、延迟分位数，以及服务器端的死锁和行锁等待
+class LoadGenerator
+{
+public:
+    explicit LoadGenerator(const LoadTestConfig& config);
+
+    bool prepare();
+    void run();
+    void printReport() const;
+
+private:
+    enum Operation { Login, ListCourses, Register, Drop, OperationCount };
+
+    struct SessionStats {
+        std::array<std::vector<qint64>, OperationCount> latenciesUs;
+        std::array<int, OperationCount> errors{};
+        int registered = 0;
+        int alreadyEnrolled = 0;
+        int courseFull = 0;
+        int waitlisted = 0;
+    };
+
+    struct ServerCounters {
+        qint64 rowLockWaits = 0;
+        qint64 rowLockTimeMs = 0;
+        qint64 deadlocks = 0;
+    };
+
+    void runSession(int index, SessionStats& stats);
+    static ServerCounters readServerCounters();
+
+    LoadTestConfig m_config;
+    QList<int> m_studentIds;
+    QList<int> m_courseIds;
+    std::vector<SessionStats> m_stats;
+    ServerCounters m_before;
+    ServerCounters m_after;
+    qint64 m_elapsedMs = 0;
+};
+
+#endif // LOADGENERATOR_H
@@ -0,0 +1,25 @@
+QT       += core sql concurrent widgets
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = loadtest
+TEMPLATE = app
+
+# 复用主程序的数据库层，每个模拟会话在自己的线程里使用独立连接
+INCLUDEPATH += ..
+
+SOURCES += \
+    ../database.cpp \
+    ../timetable.cpp \
+    ../transaction.cpp \
+    ../waitlist.cpp \
+    loadgenerator.cpp \
+    main.cpp
+
+HEADERS += \
+    ../database.h \
+    ../timetable.h \
+    ../transaction.h \
+    ../waitlist.h \
+    loadgenerator.h
@@ -0,0 +1,93 @@
+#include "loadgenerator.h"
+#include "database.h"
+#include "waitlist.h"
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QSqlDatabase>
+#include <QDebug>
+#include <cstdio>
+
+// 选课负载测试：在一台Linux机器上对本地MySQL模拟选课日并发
+// 例：./loadtest --sessions 200 --duration 60 --mix 10,40,50 --hot-courses 3 --capacity 100
+int main(int argc, char *argv[])
+{
+    // 数据库层依赖 QApplication（连接失败时弹窗），无显示环境时使用 offscreen
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    app.setApplicationName("TeachingManagerLoadTest");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("教学管理系统选课负载测试");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"host", "MySQL主机", "host", "localhost"},
+        {"port", "MySQL端口", "port", "3306"},
+        {"user", "MySQL用户", "user", "root"},
+        {"password", "MySQL密码", "password", "123456"},
+        {"database", "数据库名", "database", "teaching_manager"},
+        {"sessions", "并发学生会话数", "n", "50"},
+        {"duration", "持续秒数", "seconds", "30"},
+        {"mix", "登录,浏览,选课/退课 的比例", "weights", "20,50,30"},
+        {"think", "每次操作后的停顿毫秒数", "ms", "0"},
+        {"hot-courses", "选课集中的课程数，0为全部", "n", "5"},
+        {"capacity", "测试前设置热门课程容量（会修改数据）", "n", "0"},
+        {"student-password", "学生账号密码", "password", "123456"},
+        {"waitlist", "课程已满时加入候补，测量递补延迟"},
+    });
+    parser.process(app);
+
+    LoadTestConfig config;
+    config.sessions = qMax(1, parser.value("sessions").toInt());
+    config.durationSeconds = qMax(1, parser.value("duration").toInt());
+    config.thinkTimeMs = parser.value("think").toInt();
+    config.hotCourses = parser.value("hot-courses").toInt();
+    config.capacity = parser.value("capacity").toInt();
+    config.password = parser.value("student-password");
+    config.waitlist = parser.isSet("waitlist");
+
+    const QStringList weights = parser.value("mix").split(',');
+    if (weights.size() != 3) {
+        std::fprintf(stderr, "--mix 需要三个整数，例如 20,50,30\n");
+        return 1;
+    }
+    config.loginWeight = qMax(0, weights[0].toInt());
+    config.listWeight = qMax(0, weights[1].toInt());
+    config.registerWeight = qMax(0, weights[2].toInt());
+    if (config.loginWeight + config.listWeight + config.registerWeight <= 0) {
+        std::fprintf(stderr, "--mix 比例之和必须大于0\n");
+        return 1;
+    }
+
+    // 先自行探测连接，避免 Database::connect 失败时弹出无人处理的对话框
+    {
+        QSqlDatabase probe = QSqlDatabase::addDatabase("QMYSQL", "loadtest_probe");
+        probe.setHostName(parser.value("host"));
+        probe.setPort(parser.value("port").toInt());
+        probe.setUserName(parser.value("user"));
+        probe.setPassword(parser.value("password"));
+        if (!probe.open()) {
+            std::fprintf(stderr, "无法连接MySQL: %s\n", qPrintable(probe.lastError().text()));
+            return 1;
+        }
+        probe.close();
+    }
+    QSqlDatabase::removeDatabase("loadtest_probe");
+
+    Database& db = Database::getInstance();
+    if (!db.connect(parser.value("host"), parser.value("database"), parser.value("user"),
+                    parser.value("password"), parser.value("port").toInt())) {
+        return 1;
+    }
+    // 退课释放名额时由各会话线程直接触发递补
+    WaitlistService::getInstance();
+
+    LoadGenerator generator(config);
+    if (!generator.prepare()) {
+        return 1;
+    }
+    generator.run();
+    generator.printReport();
+    return 0;
+}
@@ -4,6 +4,9 @@
 #include "teacherwindow.h"
 #include "database.h"
 #include "configmanager.h"
+#include "waitlist.h"
+#include "degreeaudit.h"
+#include "jobscheduler.h"
 #include <QApplication>
 #include <QStyleFactory>
 #include <QMessageBox>
@@ -205,6 +208,13 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    // 候补服务须在任何退课之前创建，名额释放信号才会触发递补
+    WaitlistService::getInstance();
+    // 学位审核同理，任何会话中的成绩变化都要重新审核相关学生
+    DegreeAudit::getInstance();
+    // 任务调度创建时把已退出实例留下的任务标记为中断，之后定时刷新心跳
+    JobScheduler::getInstance();
+
     // 主循环
     while (true) {
         // 显示登录对话框
@@ -259,6 +269,7 @@ int main(int argc, char *argv[])
         }
     }
 
+    JobScheduler::getInstance().shutdown();
     qDebug() << "程序正常退出";
     return 0;
 }
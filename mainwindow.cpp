@@ -1,4 +1,18 @@
 #include "mainwindow.h"
+#include "dimensioncache.h"
+#include "statisticswidget.h"
+#include "pivotwidget.h"
+#include "timetable.h"
+#include "scheduler.h"
+#include "examscheduler.h"
+#include "prerequisitegraph.h"
+#include "degreeaudit.h"
+#include "searchindex.h"
+#include "tablesorter.h"
+#include "coursetreemodel.h"
+#include "jobscheduler.h"
+#include "jobswidget.h"
+#include "transaction.h"
 #include <QApplication>
 #include <QMessageBox>
 #include <QSqlQuery>
@@ -6,6 +20,21 @@
 #include <QHBoxLayout>
 #include <QGridLayout>
 #include <QGroupBox>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QInputDialog>
+#include <QFileDialog>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <functional>
+#include <memory>
 
 MainWindow::MainWindow(const User &user, QWidget *parent)
     : BaseWindow(user, parent)
@@ -38,7 +67,7 @@ void MainWindow::setupUI()
 
     // 学生管理标签页（只读）
     createManagementTab("学生管理", "students",
-                        {"学号", "姓名", "年龄", "学分"});
+                        {"学号", "姓名", "年龄", "已获学分", "已修学分", "GPA"});
 
     // 教师管理标签页（只读）
     createManagementTab("教师管理", "teachers",
@@ -46,7 +75,7 @@ void MainWindow::setupUI()
 
     // 课程管理标签页（只读）
     createManagementTab("课程管理", "courses",
-                        {"课程ID", "课程名称", "学分", "学期"});
+                        {"课程ID", "课程名称", "学分", "学期", "容量", "已选"});
 
     // 授课管理标签页（只读）
     createTeachingTab();
@@ -54,6 +83,15 @@ void MainWindow::setupUI()
     // 选课管理标签页（只读）
     createEnrollmentTab();
 
+    // 成绩统计标签页（本地计算）
+    tabWidget->addTab(new StatisticsWidget(), "成绩统计");
+
+    // 选课多维分析标签页（内存汇总格透视）
+    tabWidget->addTab(new PivotWidget(), "多维分析");
+
+    // 后台任务标签页
+    tabWidget->addTab(new JobsWidget(), "后台任务");
+
     // 用户管理标签页（只读，仅管理员可见）
     if (m_currentUser.canManageUsers()) {
         createUserManagementTab();
@@ -63,6 +101,44 @@ void MainWindow::setupUI()
     if (m_currentUser.canExecuteSQL()) {
         createSQLTab();
     }
+
+    loadData();
+}
+
+void MainWindow::loadData()
+{
+    // 一次往返取回全部标签页数据：学生、教师、课程、授课分组、选课分组、用户、学期
+    auto resultSets = db.bootstrapAdmin();
+    if (resultSets.size() != 7) {
+        // 存储过程不可用时退回逐个查询
+        for (auto it = tableMap.begin(); it != tableMap.end(); ++it) {
+            loadTable(it.key(), it.value());
+        }
+        fillSemesterFilter(db.getSemesters());
+        loadTeachings();
+        loadEnrollments();
+        if (m_currentUser.canManageUsers()) {
+            loadUsers();
+        }
+        return;
+    }
+
+    fillSemesterFilter(resultSets[6]);
+
+    fillTable("students", tableMap.value("students"), resultSets[0]);
+    fillTable("teachers", tableMap.value("teachers"), resultSets[1]);
+    fillTable("courses", tableMap.value("courses"), resultSets[2]);
+    // 授课/选课只有课程分组汇总，明细在展开课程时查询
+    teachingModel->setGroups(resultSets[3]);
+    enrollmentModel->setGroups(resultSets[4]);
+
+    // 初始化结果集不带学期过滤，选了具体学期时单独重新查询选课分组
+    if (selectedSemesterId() > 0) {
+        loadEnrollments();
+    }
+    if (m_currentUser.canManageUsers()) {
+        fillUsers(resultSets[5]);
+    }
 }
 
 void MainWindow::createManagementTab(const QString& tabName,
@@ -72,19 +148,171 @@ void MainWindow::createManagementTab(const QString& tabName,
     QWidget* tab = new QWidget();
     QVBoxLayout* layout = new QVBoxLayout(tab);
 
+    // 即时搜索：输入 ID、名称或拼音首字母，匹配结果按相关度排列，双击定位到表格行
+    QHBoxLayout* searchLayout = new QHBoxLayout();
+    QLineEdit* searchEdit = new QLineEdit();
+    searchEdit->setPlaceholderText(QString("搜索%1或名称，中文可用拼音首字母").arg(headers.value(0)));
+    searchEdit->setClearButtonEnabled(true);
+    QLabel* searchStatus = new QLabel();
+    searchLayout->addWidget(new QLabel("搜索:"));
+    searchLayout->addWidget(searchEdit, 1);
+    searchLayout->addWidget(searchStatus);
+    layout->addLayout(searchLayout);
+
+    QListWidget* searchResults = new QListWidget();
+    searchResults->setMaximumHeight(160);
+    searchResults->hide();
+    layout->addWidget(searchResults);
+
     // 创建表格
     QTableWidget* table = new QTableWidget();
     setupTable(table, headers);
     layout->addWidget(table);
 
+    connect(searchEdit, &QLineEdit::textChanged,
+            [tableName, searchResults, searchStatus](const QString& text) {
+        QElapsedTimer timer;
+        timer.start();
+        const auto matches = SearchIndex::getInstance().search(tableName, text);
+        const qint64 elapsedUs = timer.nsecsElapsed() / 1000;
+
+        searchResults->clear();
+        for (const auto& match : matches) {
+            QListWidgetItem* item = new QListWidgetItem(QString("%1  %2").arg(match.id).arg(match.name));
+            item->setData(Qt::UserRole, match.id);
+            searchResults->addItem(item);
+        }
+        searchResults->setVisible(!matches.isEmpty());
+        searchStatus->setText(text.trimmed().isEmpty()
+                                  ? QString()
+                                  : QString("%1 条匹配，%2 微秒").arg(matches.size()).arg(elapsedUs));
+    });
+    connect(searchResults, &QListWidget::itemActivated, [table](QListWidgetItem* item) {
+        const QString id = item->data(Qt::UserRole).toString();
+        for (int row = 0; row < table->rowCount(); row++) {
+            QTableWidgetItem* idItem = table->item(row, 0);
+            if (idItem && idItem->text() == id) {
+                table->selectRow(row);
+                table->scrollToItem(idItem, QAbstractItemView::PositionAtCenter);
+                break;
+            }
+        }
+    });
+
     // 存储表格引用
     tableMap[tableName] = table;
 
-    // 只添加刷新按钮
+    // 未保存的修改按行号暂存，排序会打乱行号
+    TableSorter::attach(table)->setGuard([this, table]() {
+        if (m_dirtyRows.value(table).isEmpty()) return true;
+        QMessageBox::information(this, "排序", "有未保存的修改，保存或刷新后才能排序");
+        return false;
+    });
+
+    // 刷新按钮和编辑模式
     QHBoxLayout* buttonLayout = new QHBoxLayout();
     QPushButton* refreshButton = new QPushButton("刷新");
 
     buttonLayout->addWidget(refreshButton);
+
+    // 编辑模式：修改按行暂存，保存时每行只提交改动的列，并用行版本检测并发冲突
+    QCheckBox* editModeCheck = new QCheckBox("编辑模式");
+    QPushButton* saveButton = new QPushButton("保存修改");
+    saveButton->setEnabled(false);
+    buttonLayout->addWidget(editModeCheck);
+    buttonLayout->addWidget(saveButton);
+
+    connect(editModeCheck, &QCheckBox::toggled, [this, table, saveButton](bool enabled) {
+        if (!enabled && !m_dirtyRows.value(table).isEmpty()) {
+            QMessageBox::information(this, "编辑模式", "仍有未保存的修改，保存或刷新后才会丢弃");
+        }
+        table->setEditTriggers(enabled ? QAbstractItemView::DoubleClicked |
+                                             QAbstractItemView::EditKeyPressed |
+                                             QAbstractItemView::AnyKeyPressed
+                                       : QAbstractItemView::NoEditTriggers);
+        table->setSelectionBehavior(enabled ? QAbstractItemView::SelectItems
+                                            : QAbstractItemView::SelectRows);
+        saveButton->setEnabled(enabled);
+    });
+    connect(table, &QTableWidget::itemChanged, [this, tableName, table](QTableWidgetItem* item) {
+        onCellEdited(tableName, table, item);
+    });
+    connect(saveButton, &QPushButton::clicked, [this, tableName, table]() {
+        saveTableEdits(tableName, table);
+    });
+
+    // 学生管理：学分/GPA汇总的全量修复
+    if (tableName == "students") {
+        QPushButton* recomputeButton = new QPushButton("重算学分/GPA");
+        recomputeButton->setToolTip("汇总平时由触发器增量维护，数据异常时可并行全量重算（后台批处理任务）");
+        buttonLayout->addWidget(recomputeButton);
+        connect(recomputeButton, &QPushButton::clicked, [this, tableName, table]() {
+            // 窗口可能在任务结束前关闭
+            QPointer<MainWindow> window(this);
+            JobScheduler::getInstance().submit("重算学分/GPA", JobScheduler::Lane::Batch,
+                                               [](JobContext& context) {
+                context.setProgress(0, "按学号区间并行重算");
+                // 内部并行不超过批处理通道的线程数，每完成一个分片汇报进度并检查取消
+                const int updated = Database::getInstance().recomputeStudentTotals(
+                    JobScheduler::getInstance().threadCount(JobScheduler::Lane::Batch),
+                    [&context](int done, int total) {
+                        context.setProgress(done * 100 / total);
+                        return !context.isCancelled();
+                    });
+                if (context.isCancelled()) {
+                    context.setProgress(0, "已取消，部分学生的学分/GPA未重算");
+                    return false;
+                }
+                if (updated < 0) {
+                    context.setProgress(100, "部分学生的学分/GPA重算失败，请查看日志");
+                    return false;
+                }
+                context.setProgress(100, QString("更新 %1 名学生").arg(updated));
+                return true;
+            }, [window, tableName, table](const JobScheduler::JobInfo& info) {
+                if (!window) return;
+                if (info.status == JobScheduler::Status::Succeeded) {
+                    QMessageBox::information(window, "重算完成", "已重算学分/GPA，" + info.message);
+                } else {
+                    QMessageBox::warning(window, "重算失败", info.message);
+                }
+                window->loadTable(tableName, table);
+            });
+        });
+
+        // 学位审核：全体学生按专业培养要求并行审核，结果写入 degree_audit
+        QPushButton* auditButton = new QPushButton("学位审核");
+        auditButton->setToolTip("按专业培养要求审核全部学生，之后成绩变化时自动重新审核相关学生");
+        buttonLayout->addWidget(auditButton);
+        connect(auditButton, &QPushButton::clicked, [this]() {
+            QPointer<MainWindow> window(this);
+            DegreeAudit::getInstance().requestAuditAll(
+                [window](bool ok, const DegreeAudit::Summary& summary) {
+                if (!window) return;
+                if (!ok) {
+                    QMessageBox::warning(window, "学位审核", "学位审核失败或已取消，请查看日志");
+                    return;
+                }
+                QMessageBox::information(window, "学位审核",
+                    QString("已审核 %1 名学生（%2 名未分配专业），全部要求已满足 %3 名，"
+                            "写入 %4 条结果\n载入 %5 毫秒，审核 %6 毫秒，写入 %7 毫秒")
+                        .arg(summary.students).arg(summary.unassigned).arg(summary.fullySatisfied)
+                        .arg(summary.rows).arg(summary.loadMs).arg(summary.auditMs).arg(summary.writeMs));
+            });
+            QMessageBox::information(this, "学位审核", "已提交后台批处理任务，可在\"后台任务\"页查看进度");
+        });
+    }
+
+    // 课程管理：查看和维护先修关系
+    if (tableName == "courses") {
+        QPushButton* prerequisiteButton = new QPushButton("先修课程");
+        prerequisiteButton->setToolTip("查看所选课程的先修关系图并添加/删除先修课程");
+        buttonLayout->addWidget(prerequisiteButton);
+        connect(prerequisiteButton, &QPushButton::clicked, [this, table]() {
+            showPrerequisites(table);
+        });
+    }
+
     buttonLayout->addStretch();
 
     layout->addLayout(buttonLayout);
@@ -95,7 +323,6 @@ void MainWindow::createManagementTab(const QString& tabName,
     });
 
     tabWidget->addTab(tab, tabName);
-    loadTable(tableName, table);
 }
 
 void MainWindow::createTeachingTab()
@@ -103,30 +330,49 @@ void MainWindow::createTeachingTab()
     QWidget *teachingTab = new QWidget();
     QVBoxLayout *layout = new QVBoxLayout(teachingTab);
 
-    // 创建表格
-    teachingTable = new QTableWidget();
-    QStringList headers = {"教师工号", "教师姓名", "课程ID", "课程名称", "学期", "上课时间", "教室"};
-    setupTable(teachingTable, headers);
-
-    // 保持交替行颜色开启
-    teachingTable->setAlternatingRowColors(true);
+    // 课程分组树：同一课程的行由委托按课程交替着色
+    teachingModel = new CourseTreeModel(CourseTreeModel::Kind::Teachings, this);
+    teachingTree = new QTreeView();
+    teachingTree->setModel(teachingModel);
+    teachingTree->setItemDelegate(new GroupBandDelegate(teachingTree));
+    teachingTree->setUniformRowHeights(true);
+    teachingTree->setSelectionBehavior(QAbstractItemView::SelectRows);
+    teachingTree->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    teachingTree->header()->setSectionResizeMode(QHeaderView::Stretch);
 
-    layout->addWidget(teachingTable);
+    layout->addWidget(teachingTree);
 
     // 只添加刷新按钮
     QHBoxLayout *buttonLayout = new QHBoxLayout();
     QPushButton *refreshButton = new QPushButton("刷新");
 
     buttonLayout->addWidget(refreshButton);
+
+    QPushButton *addTeachingButton = new QPushButton("添加授课");
+    QPushButton *editTeachingButton = new QPushButton("修改授课");
+    editTeachingButton->setToolTip("修改所选授课教师的上课时间和教室");
+    buttonLayout->addWidget(addTeachingButton);
+    buttonLayout->addWidget(editTeachingButton);
+
+    QPushButton *conflictButton = new QPushButton("课表冲突检查");
+    conflictButton->setToolTip("检查教师、教室、学生的上课时间冲突");
+    buttonLayout->addWidget(conflictButton);
+
+    QPushButton *scheduleButton = new QPushButton("自动排课");
+    scheduleButton->setToolTip("为一个学期的全部授课重新分配上课时间和教室");
+    buttonLayout->addWidget(scheduleButton);
     buttonLayout->addStretch();
 
     layout->addLayout(buttonLayout);
 
     // 连接信号槽
     connect(refreshButton, &QPushButton::clicked, this, &MainWindow::loadTeachings);
+    connect(addTeachingButton, &QPushButton::clicked, this, [this]() { editTeaching(true); });
+    connect(editTeachingButton, &QPushButton::clicked, this, [this]() { editTeaching(false); });
+    connect(conflictButton, &QPushButton::clicked, this, &MainWindow::showConflictReport);
+    connect(scheduleButton, &QPushButton::clicked, this, &MainWindow::runAutoSchedule);
 
     tabWidget->addTab(teachingTab, "授课管理");
-    loadTeachings();
 }
 
 void MainWindow::createEnrollmentTab()
@@ -134,30 +380,51 @@ void MainWindow::createEnrollmentTab()
     QWidget *enrollmentTab = new QWidget();
     QVBoxLayout *layout = new QVBoxLayout(enrollmentTab);
 
-    // 创建表格
-    enrollmentTable = new QTableWidget();
-    QStringList headers = {"学生学号", "学生姓名", "课程ID", "课程名称", "学期", "成绩"};
-    setupTable(enrollmentTable, headers);
-
-    // 保持交替行颜色开启
-    enrollmentTable->setAlternatingRowColors(true);
+    // 课程分组树：同一课程的行由委托按课程交替着色
+    enrollmentModel = new CourseTreeModel(CourseTreeModel::Kind::Enrollments, this);
+    enrollmentTree = new QTreeView();
+    enrollmentTree->setModel(enrollmentModel);
+    enrollmentTree->setItemDelegate(new GroupBandDelegate(enrollmentTree));
+    enrollmentTree->setUniformRowHeights(true);
+    enrollmentTree->setSelectionBehavior(QAbstractItemView::SelectRows);
+    enrollmentTree->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    enrollmentTree->header()->setSectionResizeMode(QHeaderView::Stretch);
 
-    layout->addWidget(enrollmentTable);
+    layout->addWidget(enrollmentTree);
 
-    // 只添加刷新按钮
+    // 刷新按钮、学期过滤和传输模式开关
     QHBoxLayout *buttonLayout = new QHBoxLayout();
     QPushButton *refreshButton = new QPushButton("刷新");
+    semesterFilterCombo = new QComboBox();
+    semesterFilterCombo->addItem("全部学期", 0);
+    QCheckBox *clientJoinCheckBox = new QCheckBox("本地关联（精简传输）");
+    clientJoinCheckBox->setToolTip("展开课程时只从服务器获取ID和成绩等字段，学生/教师名称由本地缓存关联");
+    clientJoinCheckBox->setChecked(db.isClientJoinEnabled());
 
     buttonLayout->addWidget(refreshButton);
+    buttonLayout->addWidget(new QLabel("学期:"));
+    buttonLayout->addWidget(semesterFilterCombo);
+    buttonLayout->addWidget(clientJoinCheckBox);
+
+    QPushButton *examButton = new QPushButton("考试安排");
+    examButton->setToolTip("按所选学期的选课为期末考试分配场次，避免学生同场次两门考试");
+    buttonLayout->addWidget(examButton);
     buttonLayout->addStretch();
 
     layout->addLayout(buttonLayout);
 
     // 连接信号槽
     connect(refreshButton, &QPushButton::clicked, this, &MainWindow::loadEnrollments);
+    connect(semesterFilterCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::loadEnrollments);
+    connect(examButton, &QPushButton::clicked, this, &MainWindow::runExamSchedule);
+    connect(clientJoinCheckBox, &QCheckBox::toggled, [this](bool checked) {
+        db.setClientJoinEnabled(checked);
+        loadTeachings();
+        loadEnrollments();
+    });
 
     tabWidget->addTab(enrollmentTab, "选课成绩管理");
-    loadEnrollments();
 }
 
 void MainWindow::createUserManagementTab()
@@ -184,9 +451,6 @@ void MainWindow::createUserManagementTab()
     connect(refreshButton, &QPushButton::clicked, this, &MainWindow::loadUsers);
 
     tabWidget->addTab(userTab, "用户管理");
-
-    // 初始加载用户数据
-    loadUsers();
 }
 
 void MainWindow::createSQLTab()
@@ -238,23 +502,469 @@ void MainWindow::createSQLTab()
     tabWidget->addTab(sqlTab, "SQL执行");
 }
 
+void MainWindow::editTeaching(bool create)
+{
+    QMap<QString, QVariant> current = teachingModel->rowValues(teachingTree->currentIndex());
+    if (!create && !current.contains("teacher_id")) {
+        QMessageBox::information(this, "修改授课", "请先展开课程并选中一位授课教师");
+        return;
+    }
+
+    QDialog dialog(this);
+    dialog.setWindowTitle(create ? "添加授课" : "修改授课");
+    QFormLayout *form = new QFormLayout(&dialog);
+    // 选中课程时预填课程ID；修改时教师和课程是授课的主键，不能改
+    QLineEdit *teacherEdit = new QLineEdit(create ? QString() : current.value("teacher_id").toString());
+    QLineEdit *courseEdit = new QLineEdit(current.value("course_id").toString());
+    QLineEdit *timeEdit = new QLineEdit(create ? QString() : current.value("class_time").toString());
+    timeEdit->setPlaceholderText("如 周一 1-2节 1-16周; 周三3-4节(单周)");
+    QLineEdit *roomEdit = new QLineEdit(create ? QString() : current.value("classroom").toString());
+    teacherEdit->setReadOnly(!create);
+    courseEdit->setReadOnly(!create);
+    form->addRow("教师工号", teacherEdit);
+    form->addRow("课程ID", courseEdit);
+    form->addRow("上课时间", timeEdit);
+    form->addRow("教室", roomEdit);
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    form->addRow(buttons);
+    if (dialog.exec() != QDialog::Accepted) return;
+
+    bool teacherOk = false, courseOk = false;
+    const int teacherId = teacherEdit->text().trimmed().toInt(&teacherOk);
+    const int courseId = courseEdit->text().trimmed().toInt(&courseOk);
+    if (!teacherOk || !courseOk) {
+        QMessageBox::warning(this, dialog.windowTitle(), "教师工号和课程ID必须是数字");
+        return;
+    }
+    const QString classTime = timeEdit->text().trimmed();
+    const QString classroom = roomEdit->text().trimmed();
+
+    if (!classTime.isEmpty()) {
+        // 授课可能被SQL或自动排课改过，检查前重新载入索引
+        TimetableIndex& index = TimetableIndex::getInstance();
+        index.invalidate();
+        const QStringList conflicts = index.checkTeaching(teacherId, courseId, classTime, classroom);
+        if (!conflicts.isEmpty()
+            && QMessageBox::question(this, "课表冲突",
+                                     QString("%1\n\n仍然保存？").arg(conflicts.join("\n")))
+                   != QMessageBox::Yes) {
+            return;
+        }
+    }
+
+    QVariantMap data;
+    data["class_time"] = classTime.isEmpty() ? QVariant(QMetaType::fromType<QString>()) : QVariant(classTime);
+    data["classroom"] = classroom.isEmpty() ? QVariant(QMetaType::fromType<QString>()) : QVariant(classroom);
+    bool saved;
+    if (create) {
+        data["teacher_id"] = teacherId;
+        data["course_id"] = courseId;
+        saved = db.executeInsert("teachings", data);
+    } else {
+        saved = db.updateTeaching(teacherId, courseId, data);
+    }
+    if (!saved) {
+        QMessageBox::warning(this, dialog.windowTitle(),
+                             "保存失败：请检查教师和课程是否存在，或该教师是否已教授这门课程");
+        return;
+    }
+
+    TimetableIndex::getInstance().invalidate();
+    loadTeachings();
+}
+
+void MainWindow::showConflictReport()
+{
+    // 授课可能被SQL或其他窗口修改过，检查前重新载入索引
+    TimetableIndex& index = TimetableIndex::getInstance();
+    index.invalidate();
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const auto conflicts = index.conflictReport();
+    QApplication::restoreOverrideCursor();
+
+    if (conflicts.isEmpty()) {
+        QMessageBox::information(this, "课表冲突检查", "没有发现时间冲突");
+        return;
+    }
+
+    QDialog dialog(this);
+    dialog.setWindowTitle(QString("课表冲突检查 - 共 %1 项").arg(conflicts.size()));
+    dialog.resize(900, 500);
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+
+    QTableWidget *table = new QTableWidget();
+    setupTable(table, {"类型", "对象", "冲突项", "冲突项", "重叠时间"});
+    table->setRowCount(conflicts.size());
+    for (int row = 0; row < conflicts.size(); row++) {
+        const auto& conflict = conflicts[row];
+        table->setItem(row, 0, new QTableWidgetItem(conflict.kind));
+        table->setItem(row, 1, new QTableWidgetItem(conflict.owner));
+        table->setItem(row, 2, new QTableWidgetItem(conflict.first));
+        table->setItem(row, 3, new QTableWidgetItem(conflict.second));
+        table->setItem(row, 4, new QTableWidgetItem(conflict.when));
+    }
+    layout->addWidget(table);
+
+    QPushButton *closeButton = new QPushButton("关闭");
+    connect(closeButton, &QPushButton::clicked, &dialog, &QDialog::accept);
+    layout->addWidget(closeButton);
+
+    dialog.exec();
+}
+
+void MainWindow::runAutoSchedule()
+{
+    // 学期选项与选课管理的学期筛选一致，默认选中当前筛选的学期
+    QStringList semesterNames;
+    QList<int> semesterIds;
+    int current = 0;
+    for (int i = 0; i < semesterFilterCombo->count(); i++) {
+        const int semesterId = semesterFilterCombo->itemData(i).toInt();
+        if (semesterId <= 0) continue;
+        if (semesterId == selectedSemesterId()) current = semesterIds.size();
+        semesterNames << semesterFilterCombo->itemText(i);
+        semesterIds << semesterId;
+    }
+    if (semesterIds.isEmpty()) {
+        QMessageBox::warning(this, "自动排课", "没有可排课的学期");
+        return;
+    }
+
+    bool ok = false;
+    const QString semesterName = QInputDialog::getItem(this, "自动排课", "排课学期:",
+                                                       semesterNames, current, false, &ok);
+    if (!ok) return;
+
+    ScheduleSolver::Options options;
+    options.semesterId = semesterIds.value(semesterNames.indexOf(semesterName));
+    // 搜索线程数不超过批处理通道，避免后台排课占满全部核
+    options.threads = JobScheduler::getInstance().threadCount(JobScheduler::Lane::Batch);
+
+    // 搜索要用满时间预算，放到批处理通道执行；结果在任务结束后回到界面线程确认并写回
+    auto solver = std::make_shared<ScheduleSolver>();
+    auto result = std::make_shared<ScheduleSolver::Result>();
+    QPointer<MainWindow> window(this);
+    JobScheduler::getInstance().submit("自动排课 " + semesterName, JobScheduler::Lane::Batch,
+                                       [solver, result, options](JobContext& context) {
+        context.setProgress(0, "载入授课和教室");
+        if (!solver->load(options)) {
+            context.setProgress(0, "载入排课数据失败");
+            return false;
+        }
+        if (solver->teachingCount() == 0) {
+            context.setProgress(0, "该学期没有授课安排");
+            return false;
+        }
+        if (context.isCancelled()) return false;
+        context.setProgress(10, QString("搜索中（最多 %1 秒）").arg(options.timeBudgetMs / 1000));
+        *result = solver->solve();
+        if (context.isCancelled()) return false;
+        context.setProgress(100, result->summary());
+        return true;
+    }, [window, solver, result](const JobScheduler::JobInfo& info) {
+        if (!window) return;
+        if (info.status != JobScheduler::Status::Succeeded) {
+            if (info.status == JobScheduler::Status::Failed) {
+                QMessageBox::warning(window, "自动排课", info.message);
+            }
+            return;
+        }
+
+        const int answer = QMessageBox::question(
+            window, "自动排课",
+            QString("%1\n\n写回后将覆盖该学期全部授课的上课时间和教室，是否写回？").arg(result->summary()),
+            QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+        if (answer != QMessageBox::Yes) return;
+
+        if (solver->writeBack(*result)) {
+            QMessageBox::information(window, "自动排课", "排课结果已写回");
+            window->loadTeachings();
+        } else {
+            QMessageBox::warning(window, "自动排课", "写回排课结果失败，未做任何修改");
+        }
+    });
+    QMessageBox::information(this, "自动排课", "已提交后台任务，可在\"后台任务\"页查看进度，完成后会提示是否写回");
+}
+
+void MainWindow::runExamSchedule()
+{
+    const int semesterId = selectedSemesterId();
+    if (semesterId <= 0) {
+        QMessageBox::warning(this, "考试安排", "请先在学期筛选中选择一个学期");
+        return;
+    }
+
+    bool ok = false;
+    const int slotCount = QInputDialog::getInt(this, "考试安排", "考试场次数:", 10, 1,
+                                               ExamScheduler::kMaxSlots, 1, &ok);
+    if (!ok) return;
+
+    // 载入选课和着色搜索放到批处理通道，结果在任务结束后回到界面线程展示
+    const QString semesterName = semesterFilterCombo->currentText();
+    const int workers = JobScheduler::getInstance().threadCount(JobScheduler::Lane::Batch);
+    auto scheduler = std::make_shared<ExamScheduler>();
+    auto result = std::make_shared<ExamScheduler::Result>();
+    QPointer<MainWindow> window(this);
+    JobScheduler::getInstance().submit("考试安排 " + semesterName, JobScheduler::Lane::Batch,
+                                       [scheduler, result, semesterId, slotCount, workers](JobContext& context) {
+        context.setProgress(0, "载入选课并统计共同选课");
+        if (!scheduler->load(semesterId, workers)) {
+            context.setProgress(0, "载入选课数据失败");
+            return false;
+        }
+        if (scheduler->courseCount() == 0) {
+            context.setProgress(0, "该学期没有选课记录");
+            return false;
+        }
+        if (context.isCancelled()) return false;
+        context.setProgress(50, "安排考试场次");
+        *result = scheduler->schedule(slotCount);
+        context.setProgress(100, QString("使用场次 %1/%2，同场次冲突 %3 人次")
+                                     .arg(result->slotsUsed).arg(slotCount).arg(result->conflicts));
+        return true;
+    }, [window, scheduler, result, slotCount, semesterName](const JobScheduler::JobInfo& info) {
+        if (!window) return;
+        if (info.status == JobScheduler::Status::Succeeded) {
+            window->showExamSchedule(*scheduler, *result, slotCount, semesterName);
+        } else if (info.status == JobScheduler::Status::Failed) {
+            QMessageBox::warning(window, "考试安排", info.message);
+        }
+    });
+    QMessageBox::information(this, "考试安排", "已提交后台任务，可在\"后台任务\"页查看进度，完成后显示安排结果");
+}
+
+void MainWindow::showExamSchedule(ExamScheduler& scheduler, const ExamScheduler::Result& result,
+                                  int slotCount, const QString& semesterName)
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle(QString("考试安排 - %1").arg(semesterName));
+    dialog.resize(800, 500);
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+
+    layout->addWidget(new QLabel(QString("课程 %1 门，冲突边 %2 条，使用场次 %3/%4，"
+                                         "同场次冲突 %5 人次，耗时 %6 毫秒")
+                                     .arg(result.exams.size()).arg(scheduler.edgeCount())
+                                     .arg(result.slotsUsed).arg(slotCount)
+                                     .arg(result.conflicts).arg(result.elapsedMs)));
+
+    QTableWidget *table = new QTableWidget();
+    setupTable(table, {"考试场次", "课程ID", "课程名称", "考生人数", "冲突人次"});
+    table->setRowCount(result.exams.size());
+    for (int row = 0; row < result.exams.size(); row++) {
+        const auto& exam = result.exams[row];
+        table->setItem(row, 0, new QTableWidgetItem(QString::number(exam.slot)));
+        table->setItem(row, 1, new QTableWidgetItem(QString::number(exam.courseId)));
+        table->setItem(row, 2, new QTableWidgetItem(exam.name));
+        table->setItem(row, 3, new QTableWidgetItem(QString::number(exam.students)));
+        table->setItem(row, 4, new QTableWidgetItem(QString::number(exam.conflicts)));
+    }
+    layout->addWidget(table);
+
+    QHBoxLayout *buttons = new QHBoxLayout();
+    QPushButton *saveButton = new QPushButton("保存");
+    QPushButton *courseExportButton = new QPushButton("导出课程考试表");
+    QPushButton *studentExportButton = new QPushButton("导出学生考试表");
+    QPushButton *closeButton = new QPushButton("关闭");
+    buttons->addWidget(saveButton);
+    buttons->addWidget(courseExportButton);
+    buttons->addWidget(studentExportButton);
+    buttons->addStretch();
+    buttons->addWidget(closeButton);
+    layout->addLayout(buttons);
+
+    connect(saveButton, &QPushButton::clicked, &dialog, [&]() {
+        if (scheduler.save(result)) {
+            QMessageBox::information(&dialog, "考试安排", "考试安排已保存");
+        } else {
+            QMessageBox::warning(&dialog, "考试安排", "保存考试安排失败");
+        }
+    });
+    connect(courseExportButton, &QPushButton::clicked, &dialog, [&]() {
+        const QString path = QFileDialog::getSaveFileName(&dialog, "导出课程考试表",
+                                                          "课程考试表.csv", "CSV 文件 (*.csv)");
+        if (!path.isEmpty() && !scheduler.exportCourses(result, path)) {
+            QMessageBox::warning(&dialog, "导出失败", "无法写入文件: " + path);
+        }
+    });
+    connect(studentExportButton, &QPushButton::clicked, &dialog, [&]() {
+        const QString path = QFileDialog::getSaveFileName(&dialog, "导出学生考试表",
+                                                          "学生考试表.csv", "CSV 文件 (*.csv)");
+        if (!path.isEmpty() && !scheduler.exportStudents(result, path)) {
+            QMessageBox::warning(&dialog, "导出失败", "无法写入文件: " + path);
+        }
+    });
+    connect(closeButton, &QPushButton::clicked, &dialog, &QDialog::accept);
+
+    dialog.exec();
+}
+
+void MainWindow::showPrerequisites(QTableWidget* courseTable)
+{
+    const int row = courseTable->currentRow();
+    QTableWidgetItem* idItem = row >= 0 ? courseTable->item(row, 0) : nullptr;
+    if (!idItem) {
+        QMessageBox::warning(this, "先修课程", "请先选择一门课程");
+        return;
+    }
+    const int courseId = idItem->text().toInt();
+
+    PrerequisiteGraph& graph = PrerequisiteGraph::getInstance();
+    // 课程可能在上次载入后被修改过
+    graph.invalidate();
+
+    QDialog dialog(this);
+    dialog.setWindowTitle(QString("先修课程 - %1 %2").arg(courseId).arg(graph.courseName(courseId)));
+    dialog.resize(600, 500);
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+
+    QLabel *cycleLabel = new QLabel();
+    cycleLabel->setStyleSheet("color: #DC143C;");
+    cycleLabel->setWordWrap(true);
+    layout->addWidget(cycleLabel);
+
+    // 先修关系树：子节点为直接先修课程，逐层展开到没有先修为止
+    QTreeWidget *tree = new QTreeWidget();
+    tree->setHeaderLabels({"课程", "全部先修课程数"});
+    layout->addWidget(tree);
+
+    QLabel *summaryLabel = new QLabel();
+    summaryLabel->setWordWrap(true);
+    layout->addWidget(summaryLabel);
+
+    QHBoxLayout *editLayout = new QHBoxLayout();
+    QComboBox *courseCombo = new QComboBox();
+    for (const auto& course : graph.courses()) {
+        if (course.first == courseId) continue;
+        courseCombo->addItem(QString("%1 %2").arg(course.first).arg(course.second), course.first);
+    }
+    QPushButton *addButton = new QPushButton("添加先修");
+    QPushButton *removeButton = new QPushButton("删除所选先修");
+    QPushButton *closeButton = new QPushButton("关闭");
+    editLayout->addWidget(courseCombo, 1);
+    editLayout->addWidget(addButton);
+    editLayout->addWidget(removeButton);
+    editLayout->addWidget(closeButton);
+    layout->addLayout(editLayout);
+
+    auto label = [&graph](int id) { return QString("%1 %2").arg(id).arg(graph.courseName(id)); };
+
+    std::function<void(QTreeWidgetItem*, int, int)> addChildren =
+        [&](QTreeWidgetItem* parent, int id, int depth) {
+            for (int prerequisiteId : graph.directPrerequisites(id)) {
+                QTreeWidgetItem *item = new QTreeWidgetItem(parent);
+                item->setText(0, label(prerequisiteId));
+                item->setText(1, QString::number(graph.allPrerequisites(prerequisiteId).size()));
+                item->setData(0, Qt::UserRole, prerequisiteId);
+                // 深度不超过课程总数，存在循环依赖时也能结束
+                if (depth < courseCombo->count()) addChildren(item, prerequisiteId, depth + 1);
+            }
+        };
+
+    auto refresh = [&]() {
+        tree->clear();
+        QTreeWidgetItem *root = new QTreeWidgetItem(tree);
+        root->setText(0, label(courseId));
+        root->setText(1, QString::number(graph.allPrerequisites(courseId).size()));
+        addChildren(root, courseId, 0);
+        tree->expandAll();
+
+        QStringList dependents;
+        for (int id : graph.dependents(courseId)) dependents << label(id);
+        summaryLabel->setText(QString("以本课程为先修的课程：%1")
+                                  .arg(dependents.isEmpty() ? "无" : dependents.join("、")));
+
+        const QStringList cycles = graph.cycles();
+        cycleLabel->setVisible(!cycles.isEmpty());
+        cycleLabel->setText("以下课程存在循环先修依赖：" + cycles.join("、"));
+    };
+    refresh();
+
+    connect(addButton, &QPushButton::clicked, &dialog, [&]() {
+        const int prerequisiteId = courseCombo->currentData().toInt();
+        switch (graph.addPrerequisite(courseId, prerequisiteId)) {
+        case PrerequisiteGraph::AddResult::Added:
+            refresh();
+            break;
+        case PrerequisiteGraph::AddResult::Exists:
+            QMessageBox::information(&dialog, "先修课程", "该课程已经是先修课程");
+            break;
+        case PrerequisiteGraph::AddResult::Cycle:
+            QMessageBox::warning(&dialog, "先修课程",
+                                 QString("%1 已（间接）以本课程为先修，添加后会形成循环依赖")
+                                     .arg(label(prerequisiteId)));
+            break;
+        case PrerequisiteGraph::AddResult::Error:
+            QMessageBox::warning(&dialog, "先修课程", "添加先修课程失败");
+            break;
+        }
+    });
+    connect(removeButton, &QPushButton::clicked, &dialog, [&]() {
+        // 只能删除本课程的直接先修（树的第一层）
+        QTreeWidgetItem *item = tree->currentItem();
+        if (!item || !item->parent() || item->parent()->parent()) {
+            QMessageBox::warning(&dialog, "先修课程", "请选择本课程的一门直接先修课程");
+            return;
+        }
+        if (graph.removePrerequisite(courseId, item->data(0, Qt::UserRole).toInt())) {
+            refresh();
+        } else {
+            QMessageBox::warning(&dialog, "先修课程", "删除先修课程失败");
+        }
+    });
+    connect(closeButton, &QPushButton::clicked, &dialog, &QDialog::accept);
+
+    dialog.exec();
+}
+
 // 数据加载函数
 void MainWindow::loadTable(const QString& tableName, QTableWidget* table)
 {
-    auto data = db.executeSelect(tableName);
+    fillTable(tableName, table, db.executeSelect(tableName));
+}
+
+void MainWindow::fillTable(const QString& tableName, QTableWidget* table,
+                           const QList<QMap<QString, QVariant>>& data)
+{
+    if (!table) return;
+
+    // 维度表数据同时刷新本地关联用的缓存
+    DimensionCache& cache = DimensionCache::getInstance();
+    if (tableName == "students") {
+        cache.setStudents(data);
+    } else if (tableName == "teachers") {
+        cache.setTeachers(data);
+    } else if (tableName == "courses") {
+        cache.setCourses(data);
+    }
+
+    // 搜索索引在后台重建，之后的修改由 Database::recordChanged 增量更新
+    static const QHash<QString, QString> searchIdFields = {
+        {"students", "student_id"}, {"teachers", "teacher_id"}, {"courses", "course_id"}};
+    if (searchIdFields.contains(tableName)) {
+        SearchIndex::getInstance().rebuild(tableName, data, searchIdFields.value(tableName));
+    }
+
+    // 重新载入即丢弃未保存的编辑
+    table->blockSignals(true);
+    m_dirtyRows.remove(table);
     table->setRowCount(data.size());
 
     if (tableName == "students") {
-        // 确保列顺序与表头一致：{"学号", "姓名", "年龄", "学分"}
+        // 确保列顺序与表头一致：{"学号", "姓名", "年龄", "已获学分", "已修学分", "GPA"}
         for (int i = 0; i < data.size(); i++) {
             const auto& rowData = data[i];
             // 注意：executeSelect 返回的字段顺序是固定的
             // 在 Database::executeSelect() 中，students 表的查询字段顺序是：
-            // student_id, name, age, credits
+            // student_id, name, age, credits, attempted_credits, gpa
             table->setItem(i, 0, new QTableWidgetItem(rowData["student_id"].toString()));
             table->setItem(i, 1, new QTableWidgetItem(rowData["name"].toString()));
             table->setItem(i, 2, new QTableWidgetItem(rowData["age"].toString()));
             table->setItem(i, 3, new QTableWidgetItem(rowData["credits"].toString()));
+            table->setItem(i, 4, new QTableWidgetItem(rowData["attempted_credits"].toString()));
+            table->setItem(i, 5, new QTableWidgetItem(rowData["gpa"].toString()));
         }
     }
     else if (tableName == "teachers") {
@@ -268,14 +978,16 @@ void MainWindow::loadTable(const QString& tableName, QTableWidget* table)
         }
     }
     else if (tableName == "courses") {
-        // 列顺序：{"课程ID", "课程名称", "学分", "学期"}
+        // 列顺序：{"课程ID", "课程名称", "学分", "学期", "容量", "已选"}
         for (int i = 0; i < data.size(); i++) {
             const auto& rowData = data[i];
-            // 字段顺序：course_id, name, credit, semester
+            // 字段顺序：course_id, name, credit, semester, capacity, enrolled_count
             table->setItem(i, 0, new QTableWidgetItem(rowData["course_id"].toString()));
             table->setItem(i, 1, new QTableWidgetItem(rowData["name"].toString()));
             table->setItem(i, 2, new QTableWidgetItem(rowData["credit"].toString()));
             table->setItem(i, 3, new QTableWidgetItem(rowData["semester"].toString()));
+            table->setItem(i, 4, new QTableWidgetItem(rowData["capacity"].toString()));
+            table->setItem(i, 5, new QTableWidgetItem(rowData["enrolled_count"].toString()));
         }
     }
     else if (tableName == "users") {
@@ -302,105 +1014,160 @@ void MainWindow::loadTable(const QString& tableName, QTableWidget* table)
             table->setItem(i, 6, new QTableWidgetItem(rowData["created_at"].toString()));
         }
     }
+
+    // 编辑模式用：行版本存在首列的 UserRole，只读列去掉编辑标志
+    const QStringList fields = editableFields(tableName);
+    if (!fields.isEmpty()) {
+        for (int i = 0; i < data.size(); i++) {
+            table->item(i, 0)->setData(Qt::UserRole, data[i]["row_version"]);
+            for (int col = 0; col < fields.size(); col++) {
+                QTableWidgetItem* item = table->item(i, col);
+                if (item && fields[col].isEmpty()) {
+                    item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+                }
+            }
+        }
+    }
+    table->blockSignals(false);
 }
 
-void MainWindow::loadTeachings()
+QStringList MainWindow::editableFields(const QString& tableName)
 {
-    auto data = db.getTeachings();
-    teachingTable->setRowCount(data.size());
-
-    // 获取系统主题的交替行颜色
-    QPalette palette = teachingTable->palette();
-    QColor color1 = palette.color(QPalette::Base);
-    QColor color2 = palette.color(QPalette::AlternateBase);
-
-    QString lastCourseId = "";
-    bool useColor1 = true;
+    // 与表头列一一对应，空字符串表示只读列（主键和触发器维护的汇总列）
+    if (tableName == "students") return {"", "name", "age", "", "", ""};
+    if (tableName == "teachers") return {"", "name", "age"};
+    if (tableName == "courses") return {"", "name", "credit", "semester", "capacity", ""};
+    return {};
+}
 
-    // 表头顺序：{"教师工号", "教师姓名", "课程ID", "课程名称", "学期", "上课时间", "教室"}
-    // 数据库返回的字段顺序：teacher_id, teacher_name, course_id, course_name, semester, class_time, classroom
+void MainWindow::onCellEdited(const QString& tableName, QTableWidget* table,
+                              QTableWidgetItem* item)
+{
+    const QStringList fields = editableFields(tableName);
+    if (item->column() >= fields.size() || fields[item->column()].isEmpty()) return;
+
+    // 清空单元格写入NULL（如容量不限）
+    const QVariant value = item->text().trimmed().isEmpty()
+                               ? QVariant(QMetaType::fromType<QString>())
+                               : QVariant(item->text());
+    // 同一行的多次修改合并，保存时每行一条只含改动列的UPDATE
+    m_dirtyRows[table][item->row()].insert(fields[item->column()], value);
+
+    table->blockSignals(true);
+    item->setBackground(QColor(255, 243, 205));
+    table->blockSignals(false);
+}
 
-    for (int i = 0; i < data.size(); i++) {
-        const auto& row = data[i];
+void MainWindow::saveTableEdits(const QString& tableName, QTableWidget* table)
+{
+    const QHash<int, QVariantMap> dirtyRows = m_dirtyRows.take(table);
+    if (dirtyRows.isEmpty()) {
+        QMessageBox::information(this, "保存修改", "没有需要保存的修改");
+        return;
+    }
 
-        // 检查课程ID是否变化
-        QString currentCourseId = row["course_id"].toString();
-        if (currentCourseId != lastCourseId) {
-            useColor1 = !useColor1;  // 切换颜色
-            lastCourseId = currentCourseId;
+    QStringList conflicts, failures;
+    int saved = 0;
+
+    // 只处理改动过的行，耗时与表格总行数无关；所有行在一个事务里只提交一次，
+    // 版本冲突的行跳过，出错时整体回滚
+    UnitOfWork work;
+    QList<int> rows;
+    for (auto it = dirtyRows.begin(); it != dirtyRows.end(); ++it) {
+        QTableWidgetItem* idItem = table->item(it.key(), 0);
+        if (!idItem) continue;
+        work.update(tableName, idItem->text().toInt(), it.value(), idItem->data(Qt::UserRole).toInt());
+        rows << it.key();
+    }
+    const bool committed = work.commit();
+
+    table->blockSignals(true);
+    for (int i = 0; i < rows.size(); i++) {
+        const int row = rows[i];
+        QTableWidgetItem* idItem = table->item(row, 0);
+        const auto result = work.result(i);
+        if (result == Database::UpdateResult::Success) {
+            idItem->setData(Qt::UserRole, work.newVersion(i));
+            for (int col = 0; col < table->columnCount(); col++) {
+                if (QTableWidgetItem* item = table->item(row, col)) {
+                    item->setBackground(QBrush());
+                }
+            }
+            saved++;
+            continue;
         }
 
-        // 选择当前行的颜色
-        QColor rowColor = useColor1 ? color1 : color2;
-
-        // 根据表头顺序填充列
-        // 注意：这里必须严格按照表头顺序填充
-        teachingTable->setItem(i, 0, new QTableWidgetItem(row["teacher_id"].toString()));
-        teachingTable->setItem(i, 1, new QTableWidgetItem(row["teacher_name"].toString()));
-        teachingTable->setItem(i, 2, new QTableWidgetItem(row["course_id"].toString()));
-        teachingTable->setItem(i, 3, new QTableWidgetItem(row["course_name"].toString()));
-        teachingTable->setItem(i, 4, new QTableWidgetItem(row["semester"].toString()));
-        teachingTable->setItem(i, 5, new QTableWidgetItem(row["class_time"].toString()));
-        teachingTable->setItem(i, 6, new QTableWidgetItem(row["classroom"].toString()));
-
-        // 设置整行的背景色
-        for (int col = 0; col < teachingTable->columnCount(); col++) {
-            if (teachingTable->item(i, col)) {
-                teachingTable->item(i, col)->setBackground(rowColor);
-            }
+        // 冲突或失败的行保留为待保存状态
+        m_dirtyRows[table].insert(row, dirtyRows.value(row));
+        if (result == Database::UpdateResult::Conflict) {
+            conflicts << idItem->text();
+        } else {
+            failures << idItem->text();
         }
     }
-}
-
-void MainWindow::loadEnrollments()
-{
-    auto data = db.getEnrollments();
-    enrollmentTable->setRowCount(data.size());
+    table->blockSignals(false);
 
-    // 获取系统主题的交替行颜色
-    QPalette palette = enrollmentTable->palette();
-    QColor color1 = palette.color(QPalette::Base);
-    QColor color2 = palette.color(QPalette::AlternateBase);
+    if (saved > 0) {
+        // 名称等维度数据已变，本地关联缓存需重新加载
+        DimensionCache::getInstance().invalidate();
+    }
 
-    QString lastCourseId = "";
-    bool useColor1 = true;
+    if (!conflicts.isEmpty()) {
+        QMessageBox::warning(this, "保存冲突",
+                             QString("以下记录已被其他用户修改，未保存：%1\n请刷新后重新编辑")
+                                 .arg(conflicts.join(", ")));
+    }
+    if (!committed) {
+        QMessageBox::warning(this, "保存失败",
+                             QString("保存失败，本次修改均未写入，请检查输入：%1").arg(failures.join(", ")));
+    }
+    if (conflicts.isEmpty() && failures.isEmpty()) {
+        QMessageBox::information(this, "保存修改", QString("已保存 %1 行").arg(saved));
+    }
+}
 
-    // 表头顺序：{"学生学号", "学生姓名", "课程ID", "课程名称", "学期", "成绩"}
-    // 数据库返回的字段顺序：student_id, student_name, course_id, course_name, semester, score
+void MainWindow::loadTeachings()
+{
+    teachingModel->reload();
+}
 
-    for (int i = 0; i < data.size(); i++) {
-        const auto& row = data[i];
+void MainWindow::loadEnrollments()
+{
+    enrollmentModel->reload(selectedSemesterId());
+}
 
-        // 检查课程ID是否变化
-        QString currentCourseId = row["course_id"].toString();
-        if (currentCourseId != lastCourseId) {
-            useColor1 = !useColor1;  // 切换颜色
-            lastCourseId = currentCourseId;
-        }
+int MainWindow::selectedSemesterId() const
+{
+    return semesterFilterCombo ? semesterFilterCombo->currentData().toInt() : 0;
+}
 
-        // 选择当前行的颜色
-        QColor rowColor = useColor1 ? color1 : color2;
-
-        // 根据表头顺序填充列
-        enrollmentTable->setItem(i, 0, new QTableWidgetItem(row["student_id"].toString()));
-        enrollmentTable->setItem(i, 1, new QTableWidgetItem(row["student_name"].toString()));
-        enrollmentTable->setItem(i, 2, new QTableWidgetItem(row["course_id"].toString()));
-        enrollmentTable->setItem(i, 3, new QTableWidgetItem(row["course_name"].toString()));
-        enrollmentTable->setItem(i, 4, new QTableWidgetItem(row["semester"].toString()));
-        enrollmentTable->setItem(i, 5, new QTableWidgetItem(row["score"].toString()));
-
-        // 设置整行的背景色
-        for (int col = 0; col < enrollmentTable->columnCount(); col++) {
-            if (enrollmentTable->item(i, col)) {
-                enrollmentTable->item(i, col)->setBackground(rowColor);
-            }
+void MainWindow::fillSemesterFilter(const QList<QMap<QString, QVariant>>& semesters)
+{
+    const int current = selectedSemesterId();
+
+    // 重建选项时不触发重新查询
+    semesterFilterCombo->blockSignals(true);
+    semesterFilterCombo->clear();
+    semesterFilterCombo->addItem("全部学期", 0);
+    for (const auto& semester : semesters) {
+        QString label = semester["name"].toString();
+        if (semester["is_current"].toInt() == 1) {
+            label += "（当前）";
         }
+        semesterFilterCombo->addItem(label, semester["semester_id"].toInt());
     }
+    int index = semesterFilterCombo->findData(current);
+    semesterFilterCombo->setCurrentIndex(index >= 0 ? index : 0);
+    semesterFilterCombo->blockSignals(false);
 }
 
 void MainWindow::loadUsers()
 {
-    auto data = db.getUsers();
+    fillUsers(db.getUsers());
+}
+
+void MainWindow::fillUsers(const QList<QMap<QString, QVariant>>& data)
+{
     userTable->setRowCount(data.size());
 
     // 表头顺序：{"用户ID", "账号", "密码", "角色"}
@@ -532,18 +1299,8 @@ void MainWindow::onExecuteSQL()
     QString result = db.executeSQL(sql);
     sqlOutputEdit->setPlainText(result);
 
-    // 7. 刷新所有表格数据
-    for (auto it = tableMap.begin(); it != tableMap.end(); ++it) {
-        loadTable(it.key(), it.value());
-    }
-
-    // 刷新授课和选课表格
-    loadTeachings();
-    loadEnrollments();
-
-    if (m_currentUser.canManageUsers()) {
-        loadUsers();
-    }
+    // 7. 刷新所有表格数据（一次往返）
+    loadData();
 
     // 8. 更新状态标签
     QString resultText = sqlOutputEdit->toPlainText();
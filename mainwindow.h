@@ -2,10 +2,16 @@
 #define MAINWINDOW_H
 
 #include "basewindow.h"
+#include "examscheduler.h"
 #include <QTableWidget>
 #include <QLabel>
 #include <QTextEdit>
 #include <QPushButton>
+#include <QComboBox>
+#include <QTreeView>
+#include <QHash>
+
+class CourseTreeModel;
 
 class MainWindow : public BaseWindow
 {
@@ -17,6 +23,7 @@ public:
 
 private:
     void setupUI() override;
+    void loadData() override;
 
     // 创建标签页
     void createManagementTab(const QString& tabName,
@@ -33,6 +40,31 @@ private:
     void loadEnrollments();
     void loadUsers();
 
+    // 数据填充（数据来自单独查询或初始化存储过程的结果集）
+    void fillTable(const QString& tableName, QTableWidget* table,
+                   const QList<QMap<QString, QVariant>>& data);
+    void fillUsers(const QList<QMap<QString, QVariant>>& data);
+    void fillSemesterFilter(const QList<QMap<QString, QVariant>>& semesters);
+    int selectedSemesterId() const;
+
+    // 管理表格编辑模式
+    static QStringList editableFields(const QString& tableName);
+    void onCellEdited(const QString& tableName, QTableWidget* table, QTableWidgetItem* item);
+    void saveTableEdits(const QString& tableName, QTableWidget* table);
+
+    // 添加/修改授课，保存前检查同学期的教师和教室冲突
+    void editTeaching(bool create);
+
+    // 课表冲突检查与自动排课
+    void showConflictReport();
+    void runAutoSchedule();
+    void runExamSchedule();
+    void showExamSchedule(ExamScheduler& scheduler, const ExamScheduler::Result& result,
+                          int slotCount, const QString& semesterName);
+
+    // 课程先修关系
+    void showPrerequisites(QTableWidget* courseTable);
+
     // SQL执行函数
     void onExecuteSQL();
     void onClearSQL();
@@ -44,12 +76,17 @@ private:
 
     // 学生、教师、课程管理标签页的表格
     QMap<QString, QTableWidget*> tableMap;
+    // 编辑模式下各表格待保存的修改：行号 -> (字段 -> 新值)
+    QMap<QTableWidget*, QHash<int, QVariantMap>> m_dirtyRows;
 
-    // 授课管理
-    QTableWidget* teachingTable;
+    // 授课管理：按课程分组，展开时加载授课教师
+    QTreeView* teachingTree;
+    CourseTreeModel* teachingModel;
 
-    // 选课管理
-    QTableWidget* enrollmentTable;
+    // 选课管理：按课程分组，展开时加载选课学生
+    QTreeView* enrollmentTree;
+    CourseTreeModel* enrollmentModel;
+    QComboBox* semesterFilterCombo = nullptr;
 
     // 用户管理
     QTableWidget* userTable;
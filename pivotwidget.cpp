@@ -0,0 +1,139 @@
+#include "pivotwidget.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+
+namespace {
+const EnrollmentCube::Dimension kDimensions[] = {
+    EnrollmentCube::Dimension::Semester, EnrollmentCube::Dimension::Course,
+    EnrollmentCube::Dimension::Teacher, EnrollmentCube::Dimension::AgeBand};
+
+QString formatValue(const QVariant& value)
+{
+    return value.isValid() ? value.toString() : QString();
+}
+}
+
+PivotWidget::PivotWidget(QWidget *parent)
+    : QWidget(parent)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    QLabel *titleLabel = new QLabel("选课多维分析");
+    titleLabel->setAlignment(Qt::AlignCenter);
+    titleLabel->setStyleSheet("font-size: 14px; font-weight: bold;");
+    layout->addWidget(titleLabel);
+
+    QHBoxLayout *axisLayout = new QHBoxLayout();
+    rowCombo = new QComboBox();
+    columnCombo = new QComboBox();
+    for (EnrollmentCube::Dimension dimension : kDimensions) {
+        rowCombo->addItem(EnrollmentCube::dimensionName(dimension));
+        columnCombo->addItem(EnrollmentCube::dimensionName(dimension));
+    }
+    rowCombo->setCurrentIndex(static_cast<int>(EnrollmentCube::Dimension::Course));
+    columnCombo->setCurrentIndex(static_cast<int>(EnrollmentCube::Dimension::AgeBand));
+    measureCombo = new QComboBox();
+    measureCombo->addItems({"选课人数", "已评分人数", "平均分", "及格率(%)"});
+    axisLayout->addWidget(new QLabel("行:"));
+    axisLayout->addWidget(rowCombo);
+    axisLayout->addWidget(new QLabel("列:"));
+    axisLayout->addWidget(columnCombo);
+    axisLayout->addWidget(new QLabel("指标:"));
+    axisLayout->addWidget(measureCombo);
+    reloadButton = new QPushButton("载入");
+    axisLayout->addWidget(reloadButton);
+    axisLayout->addStretch();
+    statusLabel = new QLabel("尚未载入");
+    axisLayout->addWidget(statusLabel);
+    layout->addLayout(axisLayout);
+
+    // 切片：每个维度一个下拉框，“全部”表示不过滤
+    QHBoxLayout *filterLayout = new QHBoxLayout();
+    for (EnrollmentCube::Dimension dimension : kDimensions) {
+        QComboBox *combo = new QComboBox();
+        combo->setMinimumWidth(120);
+        combo->addItem("全部");
+        filterLayout->addWidget(new QLabel(EnrollmentCube::dimensionName(dimension) + ":"));
+        filterLayout->addWidget(combo);
+        filterCombos << combo;
+        connect(combo, &QComboBox::currentIndexChanged, this, &PivotWidget::showPivot);
+    }
+    filterLayout->addStretch();
+    layout->addLayout(filterLayout);
+
+    pivotTable = new QTableWidget();
+    pivotTable->setAlternatingRowColors(true);
+    pivotTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    pivotTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    layout->addWidget(pivotTable);
+
+    connect(reloadButton, &QPushButton::clicked, this, &PivotWidget::onReload);
+    connect(rowCombo, &QComboBox::currentIndexChanged, this, &PivotWidget::showPivot);
+    connect(columnCombo, &QComboBox::currentIndexChanged, this, &PivotWidget::showPivot);
+    connect(measureCombo, &QComboBox::currentIndexChanged, this, &PivotWidget::showPivot);
+}
+
+void PivotWidget::onReload()
+{
+    EnrollmentCube::getInstance().invalidate();
+    m_loaded = true;
+    fillFilters();
+    showPivot();
+}
+
+void PivotWidget::fillFilters()
+{
+    EnrollmentCube& cube = EnrollmentCube::getInstance();
+    for (int i = 0; i < filterCombos.size(); i++) {
+        QComboBox *combo = filterCombos[i];
+        const QVariant previous = combo->currentData();
+        combo->blockSignals(true);
+        combo->clear();
+        combo->addItem("全部");
+        for (const auto& member : cube.members(kDimensions[i])) {
+            combo->addItem(member.second, member.first);
+        }
+        const int index = previous.isValid() ? combo->findData(previous) : 0;
+        combo->setCurrentIndex(qMax(0, index));
+        combo->blockSignals(false);
+    }
+}
+
+void PivotWidget::showPivot()
+{
+    if (!m_loaded) return;
+
+    QHash<int, int> filters;
+    for (int i = 0; i < filterCombos.size(); i++) {
+        const QVariant key = filterCombos[i]->currentData();
+        if (key.isValid()) filters.insert(static_cast<int>(kDimensions[i]), key.toInt());
+    }
+
+    const EnrollmentCube::Pivot pivot = EnrollmentCube::getInstance().pivot(
+        kDimensions[rowCombo->currentIndex()], kDimensions[columnCombo->currentIndex()],
+        static_cast<EnrollmentCube::Measure>(measureCombo->currentIndex()), filters);
+
+    // 最后一行、最后一列为合计
+    const int rows = pivot.rowLabels.size();
+    const int columns = pivot.columnLabels.size();
+    pivotTable->setUpdatesEnabled(false);
+    pivotTable->clear();
+    pivotTable->setRowCount(rows + 1);
+    pivotTable->setColumnCount(columns + 1);
+    pivotTable->setHorizontalHeaderLabels(QStringList(pivot.columnLabels) << "合计");
+    pivotTable->setVerticalHeaderLabels(QStringList(pivot.rowLabels) << "合计");
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            pivotTable->setItem(row, column, new QTableWidgetItem(formatValue(pivot.cells[row][column])));
+        }
+        pivotTable->setItem(row, columns, new QTableWidgetItem(formatValue(pivot.rowTotals[row])));
+    }
+    for (int column = 0; column < columns; column++) {
+        pivotTable->setItem(rows, column, new QTableWidgetItem(formatValue(pivot.columnTotals[column])));
+    }
+    pivotTable->setItem(rows, columns, new QTableWidgetItem(formatValue(pivot.grandTotal)));
+    pivotTable->setUpdatesEnabled(true);
+
+    statusLabel->setText(QString("%1 × %2，计算 %3 微秒").arg(rows).arg(columns).arg(pivot.elapsedUs));
+}
@@ -0,0 +1,37 @@
+#ifndef PIVOTWIDGET_H
+#define PIVOTWIDGET_H
+
+#include "enrollmentcube.h"
+#include <QWidget>
+#include <QTableWidget>
+#include <QComboBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QList>
+
+// 选课多维分析标签页：选择行、列维度和指标，其余维度可切片；结果由内存中的汇总格计算
+class PivotWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PivotWidget(QWidget *parent = nullptr);
+
+private slots:
+    void onReload();
+    void showPivot();
+
+private:
+    void fillFilters();
+
+    QComboBox *rowCombo;
+    QComboBox *columnCombo;
+    QComboBox *measureCombo;
+    QList<QComboBox*> filterCombos;                     // 下标即 EnrollmentCube::Dimension
+    QPushButton *reloadButton;
+    QLabel *statusLabel;
+    QTableWidget *pivotTable;
+    bool m_loaded = false;
+};
+
+#endif // PIVOTWIDGET_H
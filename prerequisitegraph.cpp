@@ -0,0 +1,310 @@
+#include "prerequisitegraph.h"
+#include "database.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <algorithm>
+
+PrerequisiteGraph& PrerequisiteGraph::getInstance()
+{
+    static PrerequisiteGraph instance;
+    return instance;
+}
+
+PrerequisiteGraph::PrerequisiteGraph()
+{
+    Database& db = Database::getInstance();
+    QObject::connect(&db, &Database::enrollmentScoreChanged, &db,
+                     [this](int studentId, int courseId, const QVariant& score) {
+                         onScoreChanged(studentId, courseId, score);
+                     });
+    // 课程增删改或SQL执行页的写入都可能改动课程和先修关系，整图在下次使用时重新载入
+    QObject::connect(&db, &Database::enrollmentDataInvalidated, &db, [this]() { invalidate(); });
+    QObject::connect(&db, &Database::recordChanged, &db, [this](const QString& table) {
+        if (table == "courses") invalidate();
+    });
+}
+
+void PrerequisiteGraph::invalidate()
+{
+    m_courseIds.clear();
+    m_index.clear();
+    m_names.clear();
+    m_direct.clear();
+    m_closure.clear();
+    m_cycles.clear();
+    m_passed.clear();
+    m_loaded = false;
+}
+
+void PrerequisiteGraph::ensureLoaded()
+{
+    if (m_loaded) return;
+
+    QElapsedTimer timer;
+    timer.start();
+    invalidate();
+
+    QSqlDatabase db = Database::getInstance().connection();
+
+    QSqlQuery courseQuery(db);
+    courseQuery.setForwardOnly(true);
+    if (!courseQuery.exec("SELECT course_id, name FROM courses ORDER BY course_id")) {
+        qWarning() << "载入课程失败:" << courseQuery.lastError().text();
+        return;
+    }
+    while (courseQuery.next()) {
+        const int courseId = courseQuery.value(0).toInt();
+        m_index.insert(courseId, static_cast<int>(m_courseIds.size()));
+        m_courseIds.push_back(courseId);
+        m_names.insert(courseId, courseQuery.value(1).toString());
+    }
+
+    m_direct.assign(m_courseIds.size(), {});
+    QSqlQuery edgeQuery(db);
+    edgeQuery.setForwardOnly(true);
+    if (!edgeQuery.exec("SELECT course_id, prerequisite_id FROM course_prerequisites")) {
+        qWarning() << "载入先修关系失败:" << edgeQuery.lastError().text();
+        return;
+    }
+    while (edgeQuery.next()) {
+        const int course = m_index.value(edgeQuery.value(0).toInt(), -1);
+        const int prerequisite = m_index.value(edgeQuery.value(1).toInt(), -1);
+        if (course < 0 || prerequisite < 0) continue;
+        m_direct[course].push_back(prerequisite);
+    }
+
+    computeClosure();
+    m_loaded = true;
+    qDebug() << "先修关系已载入: 课程" << m_courseIds.size() << "循环" << m_cycles.size()
+             << "耗时" << timer.elapsed() << "毫秒";
+}
+
+void PrerequisiteGraph::computeClosure()
+{
+    const int n = static_cast<int>(m_courseIds.size());
+    m_closure.assign(n, QBitArray(n));
+    m_cycles.clear();
+
+    // Kahn 拓扑排序：先修课程在前，闭包 = 直接先修 ∪ 各直接先修的闭包
+    std::vector<int> pending(n, 0);
+    std::vector<std::vector<int>> dependents(n);
+    for (int course = 0; course < n; course++) {
+        pending[course] = static_cast<int>(m_direct[course].size());
+        for (int prerequisite : m_direct[course]) dependents[prerequisite].push_back(course);
+    }
+
+    std::vector<int> ready;
+    for (int course = 0; course < n; course++) {
+        if (pending[course] == 0) ready.push_back(course);
+    }
+    int ordered = 0;
+    while (!ready.empty()) {
+        const int course = ready.back();
+        ready.pop_back();
+        ordered++;
+        for (int prerequisite : m_direct[course]) {
+            m_closure[course].setBit(prerequisite);
+            m_closure[course] |= m_closure[prerequisite];
+        }
+        for (int dependent : dependents[course]) {
+            if (--pending[dependent] == 0) ready.push_back(dependent);
+        }
+    }
+    if (ordered == n) return;
+
+    // 剩下的课程在环上或依赖环：反复合并直到不再变化，并记录环上的课程
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int course = 0; course < n; course++) {
+            if (pending[course] == 0) continue;
+            QBitArray closure = m_closure[course];
+            for (int prerequisite : m_direct[course]) {
+                closure.setBit(prerequisite);
+                closure |= m_closure[prerequisite];
+            }
+            if (closure != m_closure[course]) {
+                m_closure[course] = closure;
+                changed = true;
+            }
+        }
+    }
+    for (int course = 0; course < n; course++) {
+        if (pending[course] > 0 && m_closure[course].testBit(course)) {
+            const int courseId = m_courseIds[course];
+            m_cycles << QString("%1 %2").arg(courseId).arg(m_names.value(courseId));
+        }
+    }
+    if (!m_cycles.isEmpty()) {
+        qWarning() << "先修关系存在循环依赖:" << m_cycles;
+    }
+}
+
+QList<int> PrerequisiteGraph::courseIds(const QBitArray& bits) const
+{
+    QList<int> ids;
+    for (int i = 0; i < bits.size(); i++) {
+        if (bits.testBit(i)) ids << m_courseIds[i];
+    }
+    return ids;
+}
+
+QList<QPair<int, QString>> PrerequisiteGraph::courses()
+{
+    ensureLoaded();
+    QList<QPair<int, QString>> result;
+    for (int courseId : m_courseIds) {
+        result << qMakePair(courseId, m_names.value(courseId));
+    }
+    return result;
+}
+
+QString PrerequisiteGraph::courseName(int courseId)
+{
+    ensureLoaded();
+    return m_names.value(courseId);
+}
+
+QList<int> PrerequisiteGraph::directPrerequisites(int courseId)
+{
+    ensureLoaded();
+    QList<int> ids;
+    const int course = m_index.value(courseId, -1);
+    if (course < 0) return ids;
+    for (int prerequisite : m_direct[course]) ids << m_courseIds[prerequisite];
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+QList<int> PrerequisiteGraph::allPrerequisites(int courseId)
+{
+    ensureLoaded();
+    const int course = m_index.value(courseId, -1);
+    return course < 0 ? QList<int>() : courseIds(m_closure[course]);
+}
+
+QList<int> PrerequisiteGraph::dependents(int courseId)
+{
+    ensureLoaded();
+    QList<int> ids;
+    const int target = m_index.value(courseId, -1);
+    if (target < 0) return ids;
+    for (size_t course = 0; course < m_direct.size(); course++) {
+        if (std::find(m_direct[course].begin(), m_direct[course].end(), target)
+            != m_direct[course].end()) {
+            ids << m_courseIds[course];
+        }
+    }
+    return ids;
+}
+
+QStringList PrerequisiteGraph::cycles()
+{
+    ensureLoaded();
+    return m_cycles;
+}
+
+const QBitArray& PrerequisiteGraph::passedCourses(int studentId)
+{
+    auto it = m_passed.find(studentId);
+    if (it != m_passed.end()) return it.value();
+
+    QBitArray passed(static_cast<int>(m_courseIds.size()));
+    QSqlQuery query(Database::getInstance().connection());
+    query.prepare("SELECT course_id FROM enrollments WHERE student_id = ? AND score >= 60");
+    query.addBindValue(studentId);
+    if (query.exec()) {
+        while (query.next()) {
+            const int course = m_index.value(query.value(0).toInt(), -1);
+            if (course >= 0) passed.setBit(course);
+        }
+    } else {
+        qWarning() << "载入已通过课程失败:" << query.lastError().text();
+    }
+    return m_passed.insert(studentId, passed).value();
+}
+
+void PrerequisiteGraph::onScoreChanged(int studentId, int courseId, const QVariant& score)
+{
+    // 只维护已经载入过的学生，其余学生下次检查时再查询
+    auto it = m_passed.find(studentId);
+    if (it == m_passed.end()) return;
+    const int course = m_index.value(courseId, -1);
+    if (course < 0) return;
+    it.value().setBit(course, score.isValid() && score.toDouble() >= 60);
+}
+
+QList<int> PrerequisiteGraph::missingPrerequisites(int studentId, int courseId)
+{
+    ensureLoaded();
+    // 载入之后（可能由其他客户端）新增的课程，重新载入后再检查，不能当作没有先修要求
+    if (!m_index.contains(courseId)) {
+        invalidate();
+        ensureLoaded();
+    }
+    const int course = m_index.value(courseId, -1);
+    if (course < 0 || m_closure[course].count(true) == 0) return QList<int>();
+    return courseIds(m_closure[course] & ~passedCourses(studentId));
+}
+
+bool PrerequisiteGraph::isSatisfied(int studentId, int courseId)
+{
+    return missingPrerequisites(studentId, courseId).isEmpty();
+}
+
+PrerequisiteGraph::AddResult PrerequisiteGraph::addPrerequisite(int courseId, int prerequisiteId)
+{
+    // 课程表可能在载入之后新增过课程
+    if (!m_index.contains(courseId) || !m_index.contains(prerequisiteId)) invalidate();
+    ensureLoaded();
+
+    const int course = m_index.value(courseId, -1);
+    const int prerequisite = m_index.value(prerequisiteId, -1);
+    if (course < 0 || prerequisite < 0) return AddResult::Error;
+
+    // 先修课程本身（传递地）依赖该课程时，加入这条边就会成环
+    if (course == prerequisite || m_closure[prerequisite].testBit(course)) {
+        return AddResult::Cycle;
+    }
+    if (std::find(m_direct[course].begin(), m_direct[course].end(), prerequisite)
+        != m_direct[course].end()) {
+        return AddResult::Exists;
+    }
+
+    QSqlQuery query(Database::getInstance().connection());
+    query.prepare("INSERT INTO course_prerequisites (course_id, prerequisite_id) VALUES (?, ?)");
+    query.addBindValue(courseId);
+    query.addBindValue(prerequisiteId);
+    if (!query.exec()) {
+        qWarning() << "添加先修课程失败:" << query.lastError().text();
+        return AddResult::Error;
+    }
+
+    m_direct[course].push_back(prerequisite);
+    computeClosure();
+    return AddResult::Added;
+}
+
+bool PrerequisiteGraph::removePrerequisite(int courseId, int prerequisiteId)
+{
+    QSqlQuery query(Database::getInstance().connection());
+    query.prepare("DELETE FROM course_prerequisites WHERE course_id = ? AND prerequisite_id = ?");
+    query.addBindValue(courseId);
+    query.addBindValue(prerequisiteId);
+    if (!query.exec()) {
+        qWarning() << "删除先修课程失败:" << query.lastError().text();
+        return false;
+    }
+
+    ensureLoaded();
+    const int course = m_index.value(courseId, -1);
+    const int prerequisite = m_index.value(prerequisiteId, -1);
+    if (course >= 0 && prerequisite >= 0) {
+        auto& direct = m_direct[course];
+        direct.erase(std::remove(direct.begin(), direct.end(), prerequisite), direct.end());
+        computeClosure();
+    }
+    return true;
+}
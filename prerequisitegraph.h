@@ -0,0 +1,61 @@
+#ifndef PREREQUISITEGRAPH_H
+#define PREREQUISITEGRAPH_H
+
+#include <QBitArray>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <vector>
+
+// 课程先修关系：载入时按拓扑序预先算好每门课程全部（传递）先修课程的位图，
+// 学生已通过课程也是同样下标的位图，选课前的先修检查只是一次按位运算
+class PrerequisiteGraph
+{
+public:
+    static PrerequisiteGraph& getInstance();
+
+    enum class AddResult { Added, Exists, Cycle, Error };
+
+    QList<QPair<int, QString>> courses();               // 全部课程（ID, 名称），按ID排序
+    QString courseName(int courseId);
+
+    QList<int> directPrerequisites(int courseId);
+    QList<int> allPrerequisites(int courseId);          // 传递闭包
+    QList<int> dependents(int courseId);                // 直接以该课程为先修的课程
+    QStringList cycles();                               // 载入时发现的循环依赖（只能由SQL直接写入）
+
+    // 学生尚未通过（成绩>=60）的先修课程，为空表示满足
+    QList<int> missingPrerequisites(int studentId, int courseId);
+    bool isSatisfied(int studentId, int courseId);
+
+    // 加入后会形成环时拒绝
+    AddResult addPrerequisite(int courseId, int prerequisiteId);
+    bool removePrerequisite(int courseId, int prerequisiteId);
+
+    void invalidate();
+
+private:
+    PrerequisiteGraph();
+    PrerequisiteGraph(const PrerequisiteGraph&) = delete;
+    PrerequisiteGraph& operator=(const PrerequisiteGraph&) = delete;
+
+    void ensureLoaded();
+    void computeClosure();
+    const QBitArray& passedCourses(int studentId);
+    void onScoreChanged(int studentId, int courseId, const QVariant& score);
+    QList<int> courseIds(const QBitArray& bits) const;
+
+    std::vector<int> m_courseIds;                       // 下标 → 课程ID
+    QHash<int, int> m_index;                            // 课程ID → 下标
+    QHash<int, QString> m_names;
+    std::vector<std::vector<int>> m_direct;             // 下标 → 直接先修课程下标
+    std::vector<QBitArray> m_closure;                   // 下标 → 全部先修课程位图
+    QStringList m_cycles;
+    QHash<int, QBitArray> m_passed;                     // 学生ID → 已通过课程位图，按需载入
+    bool m_loaded = false;
+};
+
+#endif // PREREQUISITEGRAPH_H
@@ -0,0 +1,254 @@
+#include "rankingservice.h"
+#include "database.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+bool rankOrder(float leftScore, int leftId, float rightScore, int rightId)
+{
+    return leftScore > rightScore || (leftScore == rightScore && leftId < rightId);
+}
+
+} // namespace
+
+RankingService& RankingService::getInstance()
+{
+    static RankingService instance;
+    return instance;
+}
+
+RankingService::RankingService()
+{
+    Database& db = Database::getInstance();
+    QObject::connect(&db, &Database::enrollmentScoreChanged, &db,
+                     [this](int studentId, int courseId, const QVariant& score) {
+                         onScoreChanged(studentId, courseId, score);
+                     });
+    QObject::connect(&db, &Database::enrollmentDataInvalidated, &db, [this]() { invalidate(); });
+}
+
+float RankingService::SemesterTotal::average() const
+{
+    // 保留两位小数，避免浮点误差把同分拆成不同名次
+    return credits > 0 ? static_cast<float>(std::round(weightedScore / credits * 100) / 100) : 0;
+}
+
+void RankingService::Ranking::sortAll()
+{
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return rankOrder(a.score, a.studentId, b.score, b.studentId);
+    });
+
+    distinct.clear();
+    for (const Entry& entry : entries) {
+        if (distinct.empty() || distinct.back() != entry.score) {
+            distinct.push_back(entry.score);
+        }
+    }
+}
+
+void RankingService::Ranking::insert(int studentId, float score)
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), Entry{score, studentId},
+                               [](const Entry& a, const Entry& b) {
+                                   return rankOrder(a.score, a.studentId, b.score, b.studentId);
+                               });
+    entries.insert(it, Entry{score, studentId});
+
+    auto d = std::lower_bound(distinct.begin(), distinct.end(), score, std::greater<float>());
+    if (d == distinct.end() || *d != score) {
+        distinct.insert(d, score);
+    }
+}
+
+void RankingService::Ranking::remove(int studentId, float score)
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), Entry{score, studentId},
+                               [](const Entry& a, const Entry& b) {
+                                   return rankOrder(a.score, a.studentId, b.score, b.studentId);
+                               });
+    if (it == entries.end() || it->studentId != studentId) return;
+
+    // 该分数的最后一人被移走时，去重数组中也删去该分数
+    const bool lastWithScore =
+        (it == entries.begin() || (it - 1)->score != score) &&
+        (it + 1 == entries.end() || (it + 1)->score != score);
+    entries.erase(it);
+
+    if (lastWithScore) {
+        auto d = std::lower_bound(distinct.begin(), distinct.end(), score, std::greater<float>());
+        if (d != distinct.end() && *d == score) {
+            distinct.erase(d);
+        }
+    }
+}
+
+RankingService::RankInfo RankingService::Ranking::rankOf(float score) const
+{
+    RankInfo info;
+    info.total = static_cast<int>(entries.size());
+    // 比该分数高的人数 +1 即竞争排名；比它高的不同分数个数 +1 即密集排名
+    auto it = std::lower_bound(entries.begin(), entries.end(), score,
+                               [](const Entry& entry, float value) { return entry.score > value; });
+    info.competition = static_cast<int>(it - entries.begin()) + 1;
+    auto d = std::lower_bound(distinct.begin(), distinct.end(), score, std::greater<float>());
+    info.dense = static_cast<int>(d - distinct.begin()) + 1;
+    return info;
+}
+
+void RankingService::ensureLoaded()
+{
+    if (m_loaded) return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    m_courseMeta.clear();
+    m_courses.clear();
+    m_semesters.clear();
+    m_courseScores.clear();
+    m_semesterTotals.clear();
+
+    QSqlQuery courseQuery(Database::getInstance().connection());
+    courseQuery.setForwardOnly(true);
+    if (!courseQuery.exec("SELECT course_id, semester_id, credit FROM courses")) {
+        qWarning() << "排名载入课程失败:" << courseQuery.lastError().text();
+        return;
+    }
+    while (courseQuery.next()) {
+        m_courseMeta.insert(courseQuery.value(0).toInt(),
+                            {courseQuery.value(1).toInt(), courseQuery.value(2).toDouble()});
+    }
+
+    // 只有已评分（score>0）的选课参与排名
+    QSqlQuery query(Database::getInstance().connection());
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT course_id, student_id, score FROM enrollments WHERE score > 0")) {
+        qWarning() << "排名载入成绩失败:" << query.lastError().text();
+        return;
+    }
+    if (query.size() > 0) {
+        m_courseScores.reserve(query.size());
+    }
+    while (query.next()) {
+        const int courseId = query.value(0).toInt();
+        const int studentId = query.value(1).toInt();
+        const float score = query.value(2).toFloat();
+
+        m_courses[courseId].entries.push_back({score, studentId});
+        m_courseScores.insert(key(courseId, studentId), score);
+
+        const CourseMeta meta = m_courseMeta.value(courseId);
+        SemesterTotal& total = m_semesterTotals[key(meta.semesterId, studentId)];
+        total.weightedScore += score * meta.credit;
+        total.credits += meta.credit;
+    }
+
+    for (auto it = m_semesterTotals.cbegin(); it != m_semesterTotals.cend(); ++it) {
+        const int semesterId = static_cast<int>(it.key() >> 32);
+        const int studentId = static_cast<int>(it.key() & 0xffffffffu);
+        if (it.value().credits > 0) {
+            m_semesters[semesterId].entries.push_back({it.value().average(), studentId});
+        }
+    }
+
+    // 各课程、各学期互不相关，并行排序
+    QList<Ranking*> rankings;
+    rankings.reserve(m_courses.size() + m_semesters.size());
+    for (auto it = m_courses.begin(); it != m_courses.end(); ++it) rankings.append(&it.value());
+    for (auto it = m_semesters.begin(); it != m_semesters.end(); ++it) rankings.append(&it.value());
+    QtConcurrent::blockingMap(rankings, [](Ranking* ranking) { ranking->sortAll(); });
+
+    m_loaded = true;
+    qDebug() << "排名已载入:" << m_courseScores.size() << "条成绩,"
+             << m_courses.size() << "门课程," << m_semesters.size() << "个学期, 耗时"
+             << timer.elapsed() << "毫秒";
+}
+
+void RankingService::invalidate()
+{
+    m_loaded = false;
+    m_courseMeta.clear();
+    m_courses.clear();
+    m_semesters.clear();
+    m_courseScores.clear();
+    m_semesterTotals.clear();
+}
+
+void RankingService::applySemesterDelta(int semesterId, int studentId,
+                                        double weightedScore, double credits)
+{
+    SemesterTotal& total = m_semesterTotals[key(semesterId, studentId)];
+    Ranking& ranking = m_semesters[semesterId];
+
+    if (total.credits > 1e-9) {
+        ranking.remove(studentId, total.average());
+    }
+    total.weightedScore += weightedScore;
+    total.credits += credits;
+    if (total.credits > 1e-9) {
+        ranking.insert(studentId, total.average());
+    } else {
+        m_semesterTotals.remove(key(semesterId, studentId));
+    }
+}
+
+void RankingService::onScoreChanged(int studentId, int courseId, const QVariant& score)
+{
+    // 尚未载入时无需维护，下次查询会全量载入
+    if (!m_loaded) return;
+
+    if (!m_courseMeta.contains(courseId)) {
+        invalidate();
+        return;
+    }
+    const CourseMeta meta = m_courseMeta.value(courseId);
+    const quint64 scoreKey = key(courseId, studentId);
+    Ranking& ranking = m_courses[courseId];
+
+    // 只调整受影响的课程和学期：二分定位删除旧位置，再二分插入新位置
+    if (m_courseScores.contains(scoreKey)) {
+        const float oldScore = m_courseScores.take(scoreKey);
+        ranking.remove(studentId, oldScore);
+        applySemesterDelta(meta.semesterId, studentId, -oldScore * meta.credit, -meta.credit);
+    }
+
+    const float newScore = score.isValid() ? score.toFloat() : 0;
+    if (newScore > 0) {
+        ranking.insert(studentId, newScore);
+        m_courseScores.insert(scoreKey, newScore);
+        applySemesterDelta(meta.semesterId, studentId, newScore * meta.credit, meta.credit);
+    }
+}
+
+RankingService::RankInfo RankingService::courseRank(int courseId, int studentId)
+{
+    ensureLoaded();
+
+    auto scoreIt = m_courseScores.constFind(key(courseId, studentId));
+    if (scoreIt == m_courseScores.constEnd()) return RankInfo();
+
+    auto rankingIt = m_courses.constFind(courseId);
+    if (rankingIt == m_courses.constEnd()) return RankInfo();
+    return rankingIt.value().rankOf(scoreIt.value());
+}
+
+RankingService::RankInfo RankingService::semesterRank(int semesterId, int studentId)
+{
+    ensureLoaded();
+
+    auto totalIt = m_semesterTotals.constFind(key(semesterId, studentId));
+    if (totalIt == m_semesterTotals.constEnd() || totalIt.value().credits <= 1e-9) {
+        return RankInfo();
+    }
+
+    auto rankingIt = m_semesters.constFind(semesterId);
+    if (rankingIt == m_semesters.constEnd()) return RankInfo();
+    return rankingIt.value().rankOf(totalIt.value().average());
+}
@@ -0,0 +1,79 @@
+#ifndef RANKINGSERVICE_H
+#define RANKINGSERVICE_H
+
+#include <QHash>
+#include <QVariant>
+#include <vector>
+
+// 排名服务：每门课程按成绩、每个学期按学分加权平均分维护有序数组，
+// 首次查询时全量载入并行排序，之后随 Database 的成绩变化信号增量调整位置
+class RankingService
+{
+public:
+    static RankingService& getInstance();
+
+    struct RankInfo {
+        int competition = 0;    // 竞争排名（1224）
+        int dense = 0;          // 密集排名（1223）
+        int total = 0;          // 参与排名人数
+        bool isValid() const { return total > 0; }
+    };
+
+    // 未评分或不存在时返回无效 RankInfo；查询均为 O(log n)
+    RankInfo courseRank(int courseId, int studentId);
+    RankInfo semesterRank(int semesterId, int studentId);
+
+    void invalidate();
+
+private:
+    RankingService();
+    RankingService(const RankingService&) = delete;
+    RankingService& operator=(const RankingService&) = delete;
+
+    struct Entry {
+        float score;
+        int studentId;
+    };
+
+    // 分数降序、同分学号升序；distinct 为去重后的分数（降序），用于密集排名
+    struct Ranking {
+        std::vector<Entry> entries;
+        std::vector<float> distinct;
+
+        void sortAll();
+        void insert(int studentId, float score);
+        void remove(int studentId, float score);
+        RankInfo rankOf(float score) const;
+    };
+
+    struct CourseMeta {
+        int semesterId = 0;
+        double credit = 0;
+    };
+
+    // 学生在某学期的已评分课程累计，用于学期加权平均分
+    struct SemesterTotal {
+        double weightedScore = 0;
+        double credits = 0;
+        float average() const;
+    };
+
+    static quint64 key(int groupId, int studentId)
+    {
+        return (static_cast<quint64>(static_cast<quint32>(groupId)) << 32) |
+               static_cast<quint32>(studentId);
+    }
+
+    void ensureLoaded();
+    void onScoreChanged(int studentId, int courseId, const QVariant& score);
+    void applySemesterDelta(int semesterId, int studentId, double weightedScore, double credits);
+
+    QHash<int, CourseMeta> m_courseMeta;
+    QHash<int, Ranking> m_courses;
+    QHash<int, Ranking> m_semesters;
+    QHash<quint64, float> m_courseScores;           // (课程, 学生) -> 成绩
+    QHash<quint64, SemesterTotal> m_semesterTotals; // (学期, 学生) -> 累计
+    bool m_loaded = false;
+};
+
+#endif // RANKINGSERVICE_H
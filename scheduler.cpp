@@ -0,0 +1,388 @@
+#include "scheduler.h"
+#include "database.h"
+#include "transaction.h"
+#include "timetable.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QDebug>
+#include <QtConcurrent>
+#include <QtMath>
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+int dayOf(int block) { return block / ScheduleSolver::kBlocksPerDay; }
+
+// 位图里有空闲时间块的天数，决定还能放下几次课
+int distinctDays(const ScheduleSolver::BlockSet& blocks)
+{
+    int days = 0;
+    for (int day = 0; day < ScheduleSolver::kDays; day++) {
+        for (int slot = 0; slot < ScheduleSolver::kBlocksPerDay; slot++) {
+            if (blocks[day * ScheduleSolver::kBlocksPerDay + slot]) {
+                days++;
+                break;
+            }
+        }
+    }
+    return days;
+}
+
+// 教师不可用时间只看星期和节次，与任一节重叠的时间块都不可用
+ScheduleSolver::BlockSet unavailableBlocks(const QString& text)
+{
+    ScheduleSolver::BlockSet blocks;
+    if (text.trimmed().isEmpty()) return blocks;
+
+    bool ok = false;
+    const QList<TimeSlot> timeSlots = Timetable::parse(text, &ok);
+    for (const TimeSlot& slot : timeSlots) {
+        if (slot.day > ScheduleSolver::kDays) continue;
+        for (int index = 0; index < ScheduleSolver::kBlocksPerDay; index++) {
+            const int periodStart = index * 2 + 1;
+            if (slot.periodStart <= periodStart + 1 && slot.periodEnd >= periodStart) {
+                blocks.set((slot.day - 1) * ScheduleSolver::kBlocksPerDay + index);
+            }
+        }
+    }
+    return blocks;
+}
+
+} // namespace
+
+bool ScheduleSolver::Result::betterThan(const Result& other) const
+{
+    if (hardViolations() != other.hardViolations()) return hardViolations() < other.hardViolations();
+    if (studentConflicts != other.studentConflicts) return studentConflicts < other.studentConflicts;
+    return utilization > other.utilization;
+}
+
+QString ScheduleSolver::Result::summary() const
+{
+    return QString("授课 %1 个，教师冲突 %2 处，缺少教室 %3 个，学生冲突 %4 人次，"
+                   "教室座位利用率 %5%（%6 次尝试，耗时 %7 毫秒）")
+        .arg(assignments.size()).arg(teacherConflicts).arg(roomShortages)
+        .arg(studentConflicts).arg(utilization * 100, 0, 'f', 1)
+        .arg(attempts).arg(elapsedMs);
+}
+
+bool ScheduleSolver::load(const Options& options)
+{
+    m_options = options;
+    m_teachings.clear();
+    m_teacherUnavailable.clear();
+    m_courseNeighbors.clear();
+    m_rooms.clear();
+
+    QSqlDatabase db = Database::getInstance().connection();
+
+    QSqlQuery roomQuery(db);
+    roomQuery.setForwardOnly(true);
+    if (!roomQuery.exec("SELECT name, capacity FROM classrooms ORDER BY capacity IS NULL, capacity")) {
+        qWarning() << "载入教室失败:" << roomQuery.lastError().text();
+        return false;
+    }
+    while (roomQuery.next()) {
+        m_rooms.push_back({roomQuery.value(0).toString(),
+                           roomQuery.value(1).isNull() ? INT_MAX : roomQuery.value(1).toInt()});
+    }
+
+    QSqlQuery teachingQuery(db);
+    teachingQuery.setForwardOnly(true);
+    teachingQuery.prepare("SELECT t.id, t.teacher_id, t.course_id, c.name, te.name, "
+                          "IFNULL(c.credit, 0), IFNULL(c.capacity, c.enrolled_count), "
+                          "te.unavailable_time "
+                          "FROM teachings t "
+                          "JOIN courses c ON t.course_id = c.course_id "
+                          "JOIN teachers te ON t.teacher_id = te.teacher_id "
+                          "WHERE c.semester_id = ? ORDER BY t.id");
+    teachingQuery.addBindValue(options.semesterId);
+    if (!teachingQuery.exec()) {
+        qWarning() << "载入授课失败:" << teachingQuery.lastError().text();
+        return false;
+    }
+
+    QHash<int, int> teacherIndex, courseIndex, courseSections;
+    QHash<int, int> courseSize;
+    while (teachingQuery.next()) {
+        const int teacherId = teachingQuery.value(1).toInt();
+        const int courseId = teachingQuery.value(2).toInt();
+        if (!teacherIndex.contains(teacherId)) {
+            teacherIndex.insert(teacherId, static_cast<int>(m_teacherUnavailable.size()));
+            m_teacherUnavailable.push_back(unavailableBlocks(teachingQuery.value(7).toString()));
+        }
+        if (!courseIndex.contains(courseId)) {
+            courseIndex.insert(courseId, courseIndex.size());
+        }
+        courseSections[courseId]++;
+        courseSize.insert(courseId, teachingQuery.value(6).toInt());
+
+        // 每两学分一次课，至少1次、至多3次
+        const int sessions = qBound(1, qCeil(teachingQuery.value(5).toDouble() / 2.0), 3);
+        m_teachings.push_back({teachingQuery.value(0).toInt(), teacherIndex.value(teacherId),
+                               courseIndex.value(courseId), 0, sessions, 0,
+                               QString("%1（%2）").arg(teachingQuery.value(3).toString(),
+                                                      teachingQuery.value(4).toString())});
+    }
+
+    // 按下标反查课程ID，计算每个授课分摊的人数和第一个放得下的教室
+    QList<int> courseIdByIndex(courseIndex.size());
+    for (auto it = courseIndex.cbegin(); it != courseIndex.cend(); ++it) {
+        courseIdByIndex[it.value()] = it.key();
+    }
+    for (Teaching& teaching : m_teachings) {
+        const int courseId = courseIdByIndex[teaching.courseIndex];
+        const int sections = courseSections.value(courseId, 1);
+        teaching.size = (courseSize.value(courseId) + sections - 1) / sections;
+        teaching.firstRoom = static_cast<int>(
+            std::lower_bound(m_rooms.begin(), m_rooms.end(), teaching.size,
+                             [](const Room& room, int size) { return room.capacity < size; })
+            - m_rooms.begin());
+    }
+
+    // 课程间共同选课人数：两门课排在同一时间块时冲突的学生数
+    m_courseNeighbors.assign(courseIndex.size(), {});
+    QSqlQuery pairQuery(db);
+    pairQuery.setForwardOnly(true);
+    pairQuery.prepare("SELECT a.course_id, b.course_id, COUNT(*) "
+                      "FROM enrollments a "
+                      "JOIN enrollments b ON a.student_id = b.student_id AND a.course_id < b.course_id "
+                      "JOIN courses ca ON a.course_id = ca.course_id "
+                      "JOIN courses cb ON b.course_id = cb.course_id "
+                      "WHERE ca.semester_id = ? AND cb.semester_id = ? "
+                      "GROUP BY a.course_id, b.course_id");
+    pairQuery.addBindValue(options.semesterId);
+    pairQuery.addBindValue(options.semesterId);
+    if (!pairQuery.exec()) {
+        qWarning() << "载入共同选课失败:" << pairQuery.lastError().text();
+        return false;
+    }
+    while (pairQuery.next()) {
+        const int first = courseIndex.value(pairQuery.value(0).toInt(), -1);
+        const int second = courseIndex.value(pairQuery.value(1).toInt(), -1);
+        if (first < 0 || second < 0) continue;     // 没有授课的课程不参与排课
+        const int weight = pairQuery.value(2).toInt();
+        m_courseNeighbors[first].push_back({second, weight});
+        m_courseNeighbors[second].push_back({first, weight});
+    }
+
+    qDebug() << "排课数据已载入: 授课" << m_teachings.size() << "教师" << m_teacherUnavailable.size()
+             << "教室" << m_rooms.size();
+    return true;
+}
+
+ScheduleSolver::Result ScheduleSolver::attempt(std::mt19937& rng) const
+{
+    const int teachingCount = static_cast<int>(m_teachings.size());
+    const int roomCount = static_cast<int>(m_rooms.size());
+
+    std::vector<BlockSet> teacherBusy(m_teacherUnavailable.size());
+    std::vector<BlockSet> roomBusy(roomCount);
+    std::vector<BlockSet> courseBlocks(m_courseNeighbors.size());
+    std::vector<BlockSet> roomFree(roomCount + 1);    // 后缀并集：容量不小于第 r 个教室的任一教室空闲
+    std::vector<bool> placed(teachingCount, false);
+
+    Result result;
+    qint64 seatsUsed = 0;
+    qint64 seatsOffered = 0;
+
+    auto studentCost = [&](int courseIndex, int block) {
+        int cost = 0;
+        for (const auto& neighbor : m_courseNeighbors[courseIndex]) {
+            if (courseBlocks[neighbor.first][block]) cost += neighbor.second;
+        }
+        return cost;
+    };
+
+    // 在候选时间块中逐次挑学生冲突最少的块，各次课不在同一天；同代价时随机
+    auto pickBlocks = [&](const Teaching& teaching, BlockSet candidates) {
+        QList<int> blocks;
+        for (int session = 0; session < teaching.sessions; session++) {
+            int bestBlock = -1;
+            quint64 bestCost = ULLONG_MAX;
+            for (int block = 0; block < kBlocks; block++) {
+                if (!candidates[block]) continue;
+                const quint64 cost = (quint64(studentCost(teaching.courseIndex, block)) << 8) | (rng() & 0xFF);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestBlock = block;
+                }
+            }
+            if (bestBlock < 0) break;
+            blocks << bestBlock;
+            for (int slot = 0; slot < kBlocksPerDay; slot++) {
+                candidates.reset(dayOf(bestBlock) * kBlocksPerDay + slot);
+            }
+        }
+        return blocks;
+    };
+
+    BlockSet allBlocks;
+    allBlocks.set();
+
+    for (int step = 0; step < teachingCount; step++) {
+        roomFree[roomCount].reset();
+        for (int room = roomCount - 1; room >= 0; room--) {
+            roomFree[room] = roomFree[room + 1] | ~roomBusy[room];
+        }
+
+        // 动态选择可选时间块最少的授课（最受约束优先），同分时随机
+        int chosen = -1;
+        size_t chosenDomain = SIZE_MAX;
+        int ties = 0;
+        for (int index = 0; index < teachingCount; index++) {
+            if (placed[index]) continue;
+            const Teaching& teaching = m_teachings[index];
+            BlockSet domain = ~(teacherBusy[teaching.teacherIndex]
+                                | m_teacherUnavailable[teaching.teacherIndex]);
+            if (roomCount > 0) domain &= roomFree[teaching.firstRoom];
+            const size_t size = domain.count();
+            if (size < chosenDomain) {
+                chosen = index;
+                chosenDomain = size;
+                ties = 1;
+            } else if (size == chosenDomain && rng() % ++ties == 0) {
+                chosen = index;
+            }
+        }
+        placed[chosen] = true;
+
+        const Teaching& teaching = m_teachings[chosen];
+        const BlockSet teacherFree = ~(teacherBusy[teaching.teacherIndex]
+                                       | m_teacherUnavailable[teaching.teacherIndex]);
+
+        // 最合适（最小的够用）教室优先，只要它的空闲时间还放得下全部课次
+        int room = -1;
+        QList<int> blocks;
+        for (int candidate = teaching.firstRoom; candidate < roomCount; candidate++) {
+            const BlockSet free = teacherFree & ~roomBusy[candidate];
+            if (distinctDays(free) >= teaching.sessions) {
+                room = candidate;
+                blocks = pickBlocks(teaching, free);
+                break;
+            }
+        }
+        if (room < 0) {
+            if (roomCount > 0) result.roomShortages++;
+            // 教师空闲时间不够时只能重复排课，计入硬约束违反
+            blocks = pickBlocks(teaching, distinctDays(teacherFree) >= teaching.sessions
+                                              ? teacherFree : allBlocks);
+        }
+
+        Assignment assignment;
+        assignment.teachingId = teaching.id;
+        assignment.label = teaching.label;
+        QList<TimeSlot> timeSlots;
+        BlockSet chosenBlocks;
+        for (int block : blocks) {
+            if (!teacherFree[block]) result.teacherConflicts++;
+            result.studentConflicts += studentCost(teaching.courseIndex, block);
+            chosenBlocks.set(block);
+
+            TimeSlot slot;
+            slot.day = dayOf(block) + 1;
+            slot.periodStart = (block % kBlocksPerDay) * 2 + 1;
+            slot.periodEnd = slot.periodStart + 1;
+            slot.weekStart = m_options.weekStart;
+            slot.weekEnd = m_options.weekEnd;
+            timeSlots << slot;
+        }
+        std::sort(timeSlots.begin(), timeSlots.end(),
+                  [](const TimeSlot& a, const TimeSlot& b) { return a.day < b.day; });
+        assignment.classTime = Timetable::format(timeSlots);
+
+        teacherBusy[teaching.teacherIndex] |= chosenBlocks;
+        courseBlocks[teaching.courseIndex] |= chosenBlocks;
+        if (room >= 0) {
+            roomBusy[room] |= chosenBlocks;
+            assignment.classroom = m_rooms[room].name;
+            if (m_rooms[room].capacity != INT_MAX) {
+                seatsUsed += qint64(teaching.size) * blocks.size();
+                seatsOffered += qint64(m_rooms[room].capacity) * blocks.size();
+            }
+        }
+        result.assignments << assignment;
+    }
+
+    result.utilization = seatsOffered > 0 ? double(seatsUsed) / seatsOffered : 0;
+    return result;
+}
+
+ScheduleSolver::Result ScheduleSolver::solve() const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const int threads = m_options.threads > 0 ? m_options.threads : QThread::idealThreadCount();
+    QList<int> seeds;
+    for (int i = 0; i < threads; i++) seeds << i;
+
+    // 各线程独立随机重启，互不共享状态，最后取最优；搜索线程沿用调用线程的优先级
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    pool.setThreadPriority(QThread::currentThread()->priority());
+    const QList<Result> candidates = QtConcurrent::blockingMapped(
+        &pool, seeds, [this, &timer](int seed) {
+            std::mt19937 rng(static_cast<quint32>(seed) * 7919u + 1u);
+            Result best;
+            int attempts = 0;
+            do {
+                Result current = attempt(rng);
+                attempts++;
+                if (attempts == 1 || current.betterThan(best)) {
+                    best = std::move(current);
+                }
+                // 所有约束都满足且没有学生冲突时已不可能更好（只剩利用率）
+            } while (timer.elapsed() < m_options.timeBudgetMs
+                     && !(best.hardViolations() == 0 && best.studentConflicts == 0
+                          && attempts >= 8));
+            best.attempts = attempts;
+            return best;
+        });
+
+    Result best;
+    int attempts = 0;
+    for (int i = 0; i < candidates.size(); i++) {
+        attempts += candidates[i].attempts;
+        if (i == 0 || candidates[i].betterThan(best)) best = candidates[i];
+    }
+    best.attempts = attempts;
+    best.elapsedMs = timer.elapsed();
+
+    qDebug() << "自动排课:" << best.summary();
+    return best;
+}
+
+bool ScheduleSolver::writeBack(const Result& result) const
+{
+    if (result.assignments.isEmpty()) return false;
+
+    Transaction transaction;
+
+    // 没有分到教室的授课保留原来的教室
+    QSqlQuery query(Database::getInstance().connection());
+    query.prepare("UPDATE teachings SET class_time = ?, classroom = IFNULL(?, classroom) WHERE id = ?");
+    for (const Assignment& assignment : result.assignments) {
+        query.addBindValue(assignment.classTime);
+        query.addBindValue(assignment.classroom.isEmpty() ? QVariant() : QVariant(assignment.classroom));
+        query.addBindValue(assignment.teachingId);
+        if (!query.exec()) {
+            qWarning() << "写回排课结果失败:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    // 提交时读查询缓存随之失效
+    if (!transaction.commit()) {
+        qWarning() << "提交排课事务失败:" << transaction.lastError().text();
+        return false;
+    }
+
+    TimetableIndex::getInstance().invalidate();
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <bitset>
+#include <random>
+#include <vector>
+
+// 自动排课：为一个学期的全部授课分配上课时间和教室
+// 时间按 周一~周五 × 每天5个两节连排的时间块（1-2、3-4、5-6、7-8、9-10节）建模，
+// 教师、教室、课程的占用都是25位的位图，约束传播和冲突代价计算都是位运算
+class ScheduleSolver
+{
+public:
+    static constexpr int kDays = 5;
+    static constexpr int kBlocksPerDay = 5;
+    static constexpr int kBlocks = kDays * kBlocksPerDay;
+    using BlockSet = std::bitset<kBlocks>;
+
+    struct Options {
+        int semesterId = 0;
+        int timeBudgetMs = 5000;    // 搜索时间预算
+        int threads = 0;            // 0 表示按CPU核数；搜索线程沿用调用线程的优先级
+        int weekStart = 1;          // 写回的教学周范围
+        int weekEnd = 16;
+    };
+
+    struct Assignment {
+        int teachingId = 0;
+        QString label;              // 课程名称（教师姓名）
+        QString classTime;          // 已格式化为 teachings.class_time 文本
+        QString classroom;          // 为空表示没有可用教室，写回时保留原教室
+    };
+
+    struct Result {
+        QList<Assignment> assignments;
+        int teacherConflicts = 0;   // 教师同一时间块重复排课或排进不可用时间（硬约束）
+        int roomShortages = 0;      // 找不到容量足够的空闲教室的授课（硬约束）
+        int studentConflicts = 0;   // 同时选了两门课的学生在同一时间块上课的人次
+        double utilization = 0;     // 座位利用率：选课人数 / 所用教室容量
+        int attempts = 0;
+        qint64 elapsedMs = 0;
+
+        int hardViolations() const { return teacherConflicts + roomShortages; }
+        // 目标按 硬约束违反数 → 学生冲突 → 教室利用率 依次比较
+        bool betterThan(const Result& other) const;
+        QString summary() const;
+    };
+
+    // 载入学期内的授课、教师不可用时间、教室和课程间共同选课人数；失败返回false
+    bool load(const Options& options);
+    int teachingCount() const { return static_cast<int>(m_teachings.size()); }
+
+    // 多线程随机化贪心搜索，在时间预算内保留目标最优的方案
+    Result solve() const;
+
+    // 在一个事务内写回 teachings.class_time / classroom
+    bool writeBack(const Result& result) const;
+
+private:
+    struct Teaching {
+        int id;
+        int teacherIndex;
+        int courseIndex;
+        int size;               // 该授课的学生数（同一课程多位教师时平均分摊）
+        int sessions;           // 每周上课次数，各次安排在不同的天
+        int firstRoom;          // 第一个容量足够的教室下标（教室按容量升序）
+        QString label;
+    };
+
+    struct Room {
+        QString name;
+        int capacity;           // 不限容量时为 INT_MAX
+    };
+
+    Result attempt(std::mt19937& rng) const;
+
+    Options m_options;
+    std::vector<Teaching> m_teachings;
+    std::vector<BlockSet> m_teacherUnavailable;
+    std::vector<std::vector<std::pair<int, int>>> m_courseNeighbors;   // 课程下标 → (课程下标, 共同选课人数)
+    std::vector<Room> m_rooms;
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,248 @@
+#include "searchindex.h"
+#include "database.h"
+#include <QCollator>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// 各声母在中文排序规则下的第一个字（I、U、V 没有对应的拼音声母）
+const char16_t kInitialBoundaries[] = u"阿八嚓哒妸发旮哈讥咔垃痳拏噢妑七呥扨它穵夕丫帀";
+const char kInitialLetters[] = "abcdefghjklmnopqrstwxyz";
+const int kInitialCount = 23;
+
+const int kPrefixScanLimit = 5000;      // 单字符前缀查找最多核对的键数
+
+} // namespace
+
+SearchIndex& SearchIndex::getInstance()
+{
+    static SearchIndex instance;
+    return instance;
+}
+
+SearchIndex::SearchIndex()
+{
+    Database& db = Database::getInstance();
+    QObject::connect(&db, &Database::recordChanged, &db,
+                     [this](const QString& table, int id, const QVariantMap& data) {
+                         onRecordChanged(table, id, data);
+                     });
+}
+
+QString SearchIndex::pinyinInitials(const QString& text)
+{
+    // 排序器不能跨线程共享；常用汉字只有几千个，逐字缓存比较结果
+    thread_local QCollator collator(QLocale(QLocale::Chinese, QLocale::China));
+    thread_local QHash<char16_t, char> cache;
+
+    QString initials;
+    for (QChar ch : text) {
+        const char16_t code = ch.unicode();
+        if (code < 0x4E00 || code > 0x9FFF) continue;
+
+        auto it = cache.constFind(code);
+        if (it == cache.constEnd()) {
+            const QString single(ch);
+            int low = 0, high = kInitialCount - 1, found = -1;
+            while (low <= high) {
+                const int mid = (low + high) / 2;
+                if (collator.compare(QString(QChar(kInitialBoundaries[mid])), single) <= 0) {
+                    found = mid;
+                    low = mid + 1;
+                } else {
+                    high = mid - 1;
+                }
+            }
+            it = cache.insert(code, found >= 0 ? kInitialLetters[found] : '\0');
+        }
+        if (it.value()) initials += QLatin1Char(it.value());
+    }
+    return initials;
+}
+
+quint64 SearchIndex::gramKey(const QChar* chars, int length)
+{
+    quint64 key = static_cast<quint64>(length) << 48;
+    for (int i = 0; i < length; i++) {
+        key |= static_cast<quint64>(chars[i].unicode()) << (16 * (2 - i));
+    }
+    return key;
+}
+
+void SearchIndex::Index::append(int id, const QString& name, bool keepSorted)
+{
+    const int index = static_cast<int>(records.size());
+    Record record{id, name, {QString::number(id), name.toLower(), pinyinInitials(name)}, true};
+
+    for (const QString& key : record.keys) {
+        if (key.isEmpty()) continue;
+        for (int length = 2; length <= 3; length++) {
+            for (int i = 0; i + length <= key.size(); i++) {
+                std::vector<int>& postings = grams[gramKey(key.constData() + i, length)];
+                if (postings.empty() || postings.back() != index) postings.push_back(index);
+            }
+        }
+        std::pair<QString, int> entry(key, index);
+        if (keepSorted) {
+            sortedKeys.insert(std::lower_bound(sortedKeys.begin(), sortedKeys.end(), entry), entry);
+        } else {
+            sortedKeys.push_back(entry);
+        }
+    }
+
+    records.push_back(std::move(record));
+    byId.insert(id, index);
+}
+
+void SearchIndex::Index::remove(int id)
+{
+    auto it = byId.find(id);
+    if (it == byId.end()) return;
+    records[it.value()].alive = false;
+    byId.erase(it);
+}
+
+std::shared_ptr<SearchIndex::Index> SearchIndex::build(QString idField, QString nameField,
+                                                       std::vector<std::pair<int, QString>> rows)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto index = std::make_shared<Index>();
+    index->idField = idField;
+    index->nameField = nameField;
+    index->records.reserve(rows.size());
+    index->sortedKeys.reserve(rows.size() * 3);
+    for (const auto& row : rows) {
+        index->append(row.first, row.second, false);
+    }
+    std::sort(index->sortedKeys.begin(), index->sortedKeys.end());
+
+    qDebug() << "搜索索引已建立:" << rows.size() << "条记录," << index->grams.size()
+             << "个二元/三元组, 耗时" << timer.elapsed() << "毫秒";
+    return index;
+}
+
+void SearchIndex::rebuild(const QString& table, const QList<QMap<QString, QVariant>>& rows,
+                          const QString& idField, const QString& nameField)
+{
+    std::vector<std::pair<int, QString>> data;
+    data.reserve(rows.size());
+    for (const auto& row : rows) {
+        data.emplace_back(row.value(idField).toInt(), row.value(nameField).toString());
+    }
+
+    // 之前的写入已包含在这份数据中；尚未完成的旧重建结果直接丢弃
+    m_pendingChanges.remove(table);
+    m_building.insert(table, QtConcurrent::run(&SearchIndex::build, idField, nameField, std::move(data)));
+}
+
+SearchIndex::Index* SearchIndex::ready(const QString& table)
+{
+    auto building = m_building.find(table);
+    if (building != m_building.end()
+        && (building.value().isFinished() || !m_indexes.contains(table))) {
+        std::shared_ptr<Index> index = building.value().result();
+        m_building.erase(building);
+        for (const Change& change : m_pendingChanges.take(table)) {
+            apply(*index, change);
+        }
+        m_indexes.insert(table, index);
+    }
+    auto it = m_indexes.constFind(table);
+    return it == m_indexes.constEnd() ? nullptr : it.value().get();
+}
+
+void SearchIndex::apply(Index& index, const Change& change)
+{
+    if (change.data.isEmpty()) {
+        index.remove(change.id);
+        return;
+    }
+    // 只有名称变化（或新增记录）需要重新生成检索键
+    if (!change.data.contains(index.nameField)) return;
+    index.remove(change.id);
+    index.append(change.id, change.data.value(index.nameField).toString(), true);
+}
+
+void SearchIndex::onRecordChanged(const QString& table, int id, const QVariantMap& data)
+{
+    const Change change{id, data};
+    if (m_building.contains(table)) {
+        m_pendingChanges[table] << change;
+    }
+    auto it = m_indexes.find(table);
+    if (it != m_indexes.end()) {
+        apply(*it.value(), change);
+    }
+}
+
+QList<SearchIndex::Match> SearchIndex::search(const QString& table, const QString& text, int limit)
+{
+    QList<Match> matches;
+    Index* index = ready(table);
+    const QString query = text.trimmed().toLower();
+    if (!index || query.isEmpty()) return matches;
+
+    std::vector<int> candidates;
+    if (query.size() == 1) {
+        auto it = std::lower_bound(index->sortedKeys.begin(), index->sortedKeys.end(),
+                                   std::make_pair(query, -1));
+        for (int n = 0; it != index->sortedKeys.end() && n < kPrefixScanLimit
+                        && it->first.startsWith(query); ++it, ++n) {
+            candidates.push_back(it->second);
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    } else {
+        const int length = query.size() == 2 ? 2 : 3;
+        std::vector<const std::vector<int>*> lists;
+        for (int i = 0; i + length <= query.size(); i++) {
+            auto it = index->grams.constFind(gramKey(query.constData() + i, length));
+            if (it == index->grams.constEnd()) return matches;
+            lists.push_back(&it.value());
+        }
+        // 从最短的倒排表开始求交集
+        std::sort(lists.begin(), lists.end(),
+                  [](const std::vector<int>* a, const std::vector<int>* b) { return a->size() < b->size(); });
+        lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+        candidates = *lists.front();
+        std::vector<int> next;
+        for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+            next.clear();
+            std::set_intersection(candidates.begin(), candidates.end(),
+                                  lists[i]->begin(), lists[i]->end(), std::back_inserter(next));
+            candidates.swap(next);
+        }
+    }
+
+    for (int candidate : candidates) {
+        const Record& record = index->records[candidate];
+        if (!record.alive) continue;
+        int best = -1;
+        for (int kind = 0; kind < KeyKindCount; kind++) {
+            const QString& key = record.keys[kind];
+            const int quality = key == query ? 0 : key.startsWith(query) ? 1 : key.contains(query) ? 2 : -1;
+            if (quality < 0) continue;
+            const int rank = quality * 2 + (kind == InitialsKey ? 1 : 0);
+            if (best < 0 || rank < best) best = rank;
+        }
+        if (best >= 0) matches.append({record.id, record.name, best});
+    }
+
+    auto order = [](const Match& a, const Match& b) {
+        if (a.rank != b.rank) return a.rank < b.rank;
+        if (a.name.size() != b.name.size()) return a.name.size() < b.name.size();
+        return a.id < b.id;
+    };
+    if (matches.size() > limit) {
+        std::partial_sort(matches.begin(), matches.begin() + limit, matches.end(), order);
+        matches.erase(matches.begin() + limit, matches.end());
+    } else {
+        std::sort(matches.begin(), matches.end(), order);
+    }
+    return matches;
+}
@@ -0,0 +1,82 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QVariant>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// 管理标签页的即时搜索：每张表在后台线程建立内存索引，
+// 检索键为 ID、名称（小写）和中文名称的拼音首字母；
+// 1个字符按有序键前缀查找，2个字符查二元组倒排表，更长的查询对三元组倒排表求交集后逐条核对
+// 之后随 Database::recordChanged 增量更新（删除和改名只打墓碑，新记录追加在末尾）
+class SearchIndex
+{
+public:
+    static SearchIndex& getInstance();
+
+    struct Match {
+        int id;
+        QString name;
+        int rank;           // 越小越靠前：精确 < 前缀 < 包含，名称/ID 优先于拼音首字母
+    };
+
+    // 用已取回的整表数据在后台重建索引，完成前的查询使用旧索引（没有旧索引时等待）
+    void rebuild(const QString& table, const QList<QMap<QString, QVariant>>& rows,
+                 const QString& idField, const QString& nameField = "name");
+
+    QList<Match> search(const QString& table, const QString& text, int limit = 50);
+
+    // 中文字符取拼音首字母（按中文排序规则与各声母首字比较），其他字符忽略
+    static QString pinyinInitials(const QString& text);
+
+private:
+    SearchIndex();
+    SearchIndex(const SearchIndex&) = delete;
+    SearchIndex& operator=(const SearchIndex&) = delete;
+
+    enum KeyKind { IdKey, NameKey, InitialsKey, KeyKindCount };
+
+    struct Record {
+        int id;
+        QString name;
+        QString keys[KeyKindCount];
+        bool alive;
+    };
+
+    struct Index {
+        QString idField;
+        QString nameField;
+        std::vector<Record> records;
+        QHash<int, int> byId;                                   // ID → 当前有效记录下标
+        QHash<quint64, std::vector<int>> grams;                 // 二元/三元组 → 记录下标（升序）
+        std::vector<std::pair<QString, int>> sortedKeys;        // (检索键, 记录下标)，按键排序
+
+        void append(int id, const QString& name, bool keepSorted);
+        void remove(int id);
+    };
+
+    struct Change {
+        int id;
+        QVariantMap data;   // 为空表示删除
+    };
+
+    static std::shared_ptr<Index> build(QString idField, QString nameField,
+                                        std::vector<std::pair<int, QString>> rows);
+    static quint64 gramKey(const QChar* chars, int length);
+
+    Index* ready(const QString& table);
+    void onRecordChanged(const QString& table, int id, const QVariantMap& data);
+    static void apply(Index& index, const Change& change);
+
+    QHash<QString, std::shared_ptr<Index>> m_indexes;
+    QHash<QString, QFuture<std::shared_ptr<Index>>> m_building;
+    QHash<QString, QList<Change>> m_pendingChanges;             // 后台重建期间的写入，完成后重放
+};
+
+#endif // SEARCHINDEX_H
@@ -0,0 +1,111 @@
+#include "statisticswidget.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QStringList>
+
+StatisticsWidget::StatisticsWidget(int teacherId, QWidget *parent)
+    : QWidget(parent)
+    , m_teacherId(teacherId)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    QLabel *titleLabel = new QLabel(teacherId > 0 ? "我的课程成绩统计" : "成绩分布统计");
+    titleLabel->setAlignment(Qt::AlignCenter);
+    titleLabel->setStyleSheet("font-size: 14px; font-weight: bold;");
+    layout->addWidget(titleLabel);
+
+    QHBoxLayout *controlLayout = new QHBoxLayout();
+    controlLayout->addWidget(new QLabel("统计维度:"));
+    groupByCombo = new QComboBox();
+    groupByCombo->addItem("按课程");
+    groupByCombo->addItem("按学期");
+    controlLayout->addWidget(groupByCombo);
+
+    // 统计数据在本地计算，只有点击时才从服务器载入成绩
+    reloadButton = new QPushButton("载入并统计");
+    controlLayout->addWidget(reloadButton);
+    controlLayout->addStretch();
+
+    statusLabel = new QLabel("尚未载入成绩");
+    controlLayout->addWidget(statusLabel);
+    layout->addLayout(controlLayout);
+
+    statsTable = new QTableWidget();
+    statsTable->setColumnCount(12);
+    statsTable->setHorizontalHeaderLabels({"课程/学期", "人数", "平均分", "标准差", "最低", "最高",
+                                           "中位数", "P25", "P75", "P90", "及格率",
+                                           "分布(0-9,10-19,…,90-100)"});
+    statsTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    statsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+    statsTable->horizontalHeader()->setSectionResizeMode(11, QHeaderView::ResizeToContents);
+    statsTable->setAlternatingRowColors(true);
+    statsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    statsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    layout->addWidget(statsTable);
+
+    connect(reloadButton, &QPushButton::clicked, this, &StatisticsWidget::onReload);
+    connect(groupByCombo, &QComboBox::currentIndexChanged, this, &StatisticsWidget::onGroupByChanged);
+}
+
+void StatisticsWidget::onReload()
+{
+    if (m_analytics.load(m_teacherId) < 0) {
+        QMessageBox::warning(this, "错误", "载入成绩失败");
+        return;
+    }
+    m_loaded = true;
+    showStats();
+}
+
+void StatisticsWidget::onGroupByChanged()
+{
+    // 切换维度只需在已载入的数组上重算
+    if (m_loaded) {
+        showStats();
+    }
+}
+
+void StatisticsWidget::showStats()
+{
+    const GradeAnalytics::GroupBy groupBy = groupByCombo->currentIndex() == 1
+                                                ? GradeAnalytics::GroupBy::Semester
+                                                : GradeAnalytics::GroupBy::Course;
+    const QList<GradeStats> results = m_analytics.compute(groupBy);
+
+    statsTable->setUpdatesEnabled(false);
+    statsTable->setRowCount(results.size());
+    for (int row = 0; row < results.size(); row++) {
+        const GradeStats& stats = results[row];
+
+        QStringList bins;
+        for (int count : stats.histogram) {
+            bins << QString::number(count);
+        }
+
+        const QStringList values = {
+            stats.label,
+            QString::number(stats.count),
+            QString::number(stats.mean, 'f', 2),
+            QString::number(stats.stddev, 'f', 2),
+            QString::number(stats.min, 'f', 1),
+            QString::number(stats.max, 'f', 1),
+            QString::number(stats.median, 'f', 1),
+            QString::number(stats.p25, 'f', 1),
+            QString::number(stats.p75, 'f', 1),
+            QString::number(stats.p90, 'f', 1),
+            QString::number(stats.passRate * 100, 'f', 1) + "%",
+            bins.join(" | ")
+        };
+        for (int col = 0; col < values.size(); col++) {
+            statsTable->setItem(row, col, new QTableWidgetItem(values[col]));
+        }
+    }
+    statsTable->setUpdatesEnabled(true);
+
+    statusLabel->setText(QString("共 %1 条成绩，载入 %2 ms，计算 %3 ms")
+                             .arg(m_analytics.scoreCount())
+                             .arg(m_analytics.lastLoadMs())
+                             .arg(m_analytics.lastComputeMs()));
+}
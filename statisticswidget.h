@@ -0,0 +1,37 @@
+#ifndef STATISTICSWIDGET_H
+#define STATISTICSWIDGET_H
+
+#include <QWidget>
+#include <QTableWidget>
+#include <QComboBox>
+#include <QPushButton>
+#include <QLabel>
+#include "gradeanalytics.h"
+
+// 成绩统计标签页，管理员窗口和教师窗口共用
+// teacherId>0 时只统计该教师所授课程
+class StatisticsWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit StatisticsWidget(int teacherId = 0, QWidget *parent = nullptr);
+
+private slots:
+    void onReload();
+    void onGroupByChanged();
+
+private:
+    void showStats();
+
+    int m_teacherId;
+    GradeAnalytics m_analytics;
+    bool m_loaded = false;
+
+    QComboBox *groupByCombo;
+    QPushButton *reloadButton;
+    QLabel *statusLabel;
+    QTableWidget *statsTable;
+};
+
+#endif // STATISTICSWIDGET_H
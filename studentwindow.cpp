@@ -1,4 +1,8 @@
 #include "studentwindow.h"
+#include "rankingservice.h"
+#include "timetable.h"
+#include "prerequisitegraph.h"
+#include "waitlist.h"
 #include <QApplication>
 #include <QMessageBox>
 #include <QVBoxLayout>
@@ -6,7 +10,6 @@
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QHeaderView>
-#include <QSqlQuery>
 
 StudentWindow::StudentWindow(const User &user, QWidget *parent)
     : BaseWindow(user, parent)
@@ -55,7 +58,7 @@ void StudentWindow::setupUI()
     infoLayout->addWidget(infoLabel);
 
     infoTable = new QTableWidget();
-    setupCommonTable(infoTable, {"学号", "姓名", "年龄", "学分"});
+    setupCommonTable(infoTable, {"学号", "姓名", "年龄", "已获学分", "已修学分", "GPA"});
     infoLayout->addWidget(infoTable);
 
     // 使用基类的密码修改组
@@ -74,7 +77,8 @@ void StudentWindow::setupUI()
     enrollmentLayout->addWidget(enrollmentLabel);
 
     myEnrollmentsTable = new QTableWidget();
-    setupCommonTable(myEnrollmentsTable, {"课程名称", "教师", "学期", "上课时间", "上课教室", "课程学分", "成绩"});
+    setupCommonTable(myEnrollmentsTable, {"课程名称", "教师", "学期", "上课时间", "上课教室", "课程学分", "成绩",
+                                          "课程排名", "学期排名"});
     enrollmentLayout->addWidget(myEnrollmentsTable);
 
     // 刷新按钮
@@ -86,8 +90,45 @@ void StudentWindow::setupUI()
 
     tabWidget->addTab(enrollmentTab, "我的选课");
 
+    // === 选课标签页 ===
+    registrationTab = new QWidget();
+    QVBoxLayout *registrationLayout = new QVBoxLayout(registrationTab);
+
+    QLabel *registrationLabel = new QLabel("本学期可选课程");
+    registrationLabel->setAlignment(Qt::AlignCenter);
+    registrationLabel->setStyleSheet("font-size: 14px; font-weight: bold;");
+    registrationLayout->addWidget(registrationLabel);
+
+    registrationTable = new QTableWidget();
+    setupCommonTable(registrationTable, {"课程ID", "课程名称", "教师", "学期", "上课时间",
+                                         "学分", "已选/容量", "状态"});
+    registrationLayout->addWidget(registrationTable);
+
+    QHBoxLayout *registrationButtonLayout = new QHBoxLayout();
+    QPushButton *registerButton = new QPushButton("选课");
+    registerButton->setStyleSheet("background-color: #228B22; color: white; padding: 5px;");
+    QPushButton *dropButton = new QPushButton("退课");
+    QPushButton *refreshRegistrationButton = new QPushButton("刷新");
+    registrationButtonLayout->addWidget(registerButton);
+    registrationButtonLayout->addWidget(dropButton);
+    registrationButtonLayout->addWidget(refreshRegistrationButton);
+    registrationButtonLayout->addStretch();
+    registrationLayout->addLayout(registrationButtonLayout);
+
+    tabWidget->addTab(registrationTab, "选课");
+
     // === 连接信号槽 ===
     connect(refreshEnrollmentButton, &QPushButton::clicked, this, &StudentWindow::loadEnrollments);
+    connect(registerButton, &QPushButton::clicked, this, &StudentWindow::onRegisterCourse);
+    connect(dropButton, &QPushButton::clicked, this, &StudentWindow::onDropCourse);
+    connect(refreshRegistrationButton, &QPushButton::clicked,
+            this, &StudentWindow::loadRegistrationCourses);
+    // 选课列表在切换到该标签页时才加载
+    connect(tabWidget, &QTabWidget::currentChanged, this, [this](int index) {
+        if (tabWidget->widget(index) == registrationTab) {
+            loadRegistrationCourses();
+        }
+    });
 
     // 重要：只有当changePasswordButton不为空时才连接
     if (changePasswordButton) {
@@ -115,8 +156,22 @@ void StudentWindow::onChangePassword()
 
 void StudentWindow::loadData()
 {
-    loadStudentInfo();
-    loadEnrollments();
+    if (m_studentId <= 0) {
+        QMessageBox::warning(this, "错误", "未找到对应的学生信息");
+        return;
+    }
+
+    // 一次往返取回学生信息和选课记录
+    auto resultSets = db.bootstrapStudent(m_studentId);
+    if (resultSets.size() != 2) {
+        // 存储过程不可用时退回逐个查询
+        loadStudentInfo();
+        loadEnrollments();
+        return;
+    }
+
+    fillStudentInfo(resultSets[0]);
+    fillEnrollments(resultSets[1]);
 }
 
 void StudentWindow::loadStudentInfo()
@@ -126,9 +181,19 @@ void StudentWindow::loadStudentInfo()
         return;
     }
 
-    auto students = db.executeSelect("students",
-                                     QString("student_id = %1").arg(m_studentId));
+    fillStudentInfo(db.executeSelect("students",
+                                     QString("student_id = %1").arg(m_studentId)));
+}
+
+void StudentWindow::loadEnrollments()
+{
+    if (m_studentId <= 0) return;
+
+    fillEnrollments(db.getStudentEnrollments(m_studentId));
+}
 
+void StudentWindow::fillStudentInfo(const QList<QMap<QString, QVariant>>& students)
+{
     infoTable->setRowCount(students.size());
 
     for (int i = 0; i < students.size(); i++) {
@@ -136,41 +201,191 @@ void StudentWindow::loadStudentInfo()
         infoTable->setItem(i, 0, new QTableWidgetItem(student["student_id"].toString()));
         infoTable->setItem(i, 1, new QTableWidgetItem(student["name"].toString()));
         infoTable->setItem(i, 2, new QTableWidgetItem(student["age"].toString()));
+        // 学分/GPA为 students 表上增量维护的汇总列，按主键直接读取
         infoTable->setItem(i, 3, new QTableWidgetItem(student["credits"].toString()));
+        infoTable->setItem(i, 4, new QTableWidgetItem(student["attempted_credits"].toString()));
+        infoTable->setItem(i, 5, new QTableWidgetItem(student["gpa"].toString()));
     }
 }
 
-void StudentWindow::loadEnrollments()
+void StudentWindow::fillEnrollments(const QList<QMap<QString, QVariant>>& enrollments)
+{
+    myEnrollmentsTable->setRowCount(enrollments.size());
+
+    RankingService& ranking = RankingService::getInstance();
+    auto rankText = [](const RankingService::RankInfo& info) {
+        return info.isValid() ? QString("%1/%2").arg(info.competition).arg(info.total)
+                              : QString("-");
+    };
+
+    for (int row = 0; row < enrollments.size(); row++) {
+        const auto& enrollment = enrollments[row];
+        myEnrollmentsTable->setItem(row, 0, new QTableWidgetItem(enrollment["course_name"].toString()));
+        myEnrollmentsTable->setItem(row, 1, new QTableWidgetItem(enrollment["teacher_name"].toString()));
+        myEnrollmentsTable->setItem(row, 2, new QTableWidgetItem(enrollment["semester"].toString()));
+        myEnrollmentsTable->setItem(row, 3, new QTableWidgetItem(enrollment["class_time"].toString()));
+        myEnrollmentsTable->setItem(row, 4, new QTableWidgetItem(enrollment["classroom"].toString()));
+        myEnrollmentsTable->setItem(row, 5, new QTableWidgetItem(enrollment["credit"].toString()));
+        myEnrollmentsTable->setItem(row, 6, new QTableWidgetItem(enrollment["score"].toString()));
+
+        // 排名由本地排名服务查询，显示为 名次/人数
+        const int courseId = enrollment["course_id"].toInt();
+        const int semesterId = enrollment["semester_id"].toInt();
+        myEnrollmentsTable->setItem(row, 7, new QTableWidgetItem(
+            rankText(ranking.courseRank(courseId, m_studentId))));
+        myEnrollmentsTable->setItem(row, 8, new QTableWidgetItem(
+            rankText(ranking.semesterRank(semesterId, m_studentId))));
+    }
+}
+
+void StudentWindow::loadRegistrationCourses()
 {
     if (m_studentId <= 0) return;
 
-    QSqlQuery query;
-    QString sql = QString(
-                      "SELECT c.name as course_name, "
-                      "te.name as teacher_name, c.semester, "
-                      "t.class_time, t.classroom, c.credit, e.score "
-                      "FROM enrollments e "
-                      "LEFT JOIN courses c ON e.course_id = c.course_id "
-                      "LEFT JOIN teachings t ON e.course_id = t.course_id "
-                      "LEFT JOIN teachers te ON t.teacher_id = te.teacher_id "
-                      "WHERE e.student_id = %1 "
-                      "ORDER BY c.semester DESC, e.course_id"
-                      ).arg(m_studentId);
-
-    if (query.exec(sql)) {
-        myEnrollmentsTable->setRowCount(0);
-
-        int row = 0;
-        while (query.next()) {
-            myEnrollmentsTable->insertRow(row);
-            myEnrollmentsTable->setItem(row, 0, new QTableWidgetItem(query.value("course_name").toString()));
-            myEnrollmentsTable->setItem(row, 1, new QTableWidgetItem(query.value("teacher_name").toString()));
-            myEnrollmentsTable->setItem(row, 2, new QTableWidgetItem(query.value("semester").toString()));
-            myEnrollmentsTable->setItem(row, 3, new QTableWidgetItem(query.value("class_time").toString()));
-            myEnrollmentsTable->setItem(row, 4, new QTableWidgetItem(query.value("classroom").toString()));
-            myEnrollmentsTable->setItem(row, 5, new QTableWidgetItem(query.value("credit").toString()));
-            myEnrollmentsTable->setItem(row, 6, new QTableWidgetItem(query.value("score").toString()));
-            row++;
+    // 管理员在其他客户端修改的先修关系不会通知到本会话，刷新选课列表时一并重新载入
+    PrerequisiteGraph::getInstance().invalidate();
+    const auto courses = db.getRegistrationCourses(m_studentId);
+    registrationTable->setRowCount(courses.size());
+
+    for (int row = 0; row < courses.size(); row++) {
+        const auto& course = courses[row];
+        const QVariant capacity = course["capacity"];
+        const int enrolledCount = course["enrolled_count"].toInt();
+
+        QString status;
+        if (course["enrolled"].toBool()) {
+            status = "已选";
+        } else if (course["waitlisted"].toBool()) {
+            const int position = WaitlistService::getInstance().position(
+                m_studentId, course["course_id"].toInt());
+            status = position > 0 ? QString("候补第%1位").arg(position) : QString("候补中");
+        } else if (!capacity.isNull() && enrolledCount >= capacity.toInt()) {
+            status = "已满";
+        } else {
+            status = "可选";
         }
+
+        registrationTable->setItem(row, 0, new QTableWidgetItem(course["course_id"].toString()));
+        registrationTable->setItem(row, 1, new QTableWidgetItem(course["course_name"].toString()));
+        registrationTable->setItem(row, 2, new QTableWidgetItem(course["teacher_name"].toString()));
+        registrationTable->setItem(row, 3, new QTableWidgetItem(course["semester"].toString()));
+        registrationTable->setItem(row, 4, new QTableWidgetItem(course["class_time"].toString()));
+        registrationTable->setItem(row, 5, new QTableWidgetItem(course["credit"].toString()));
+        registrationTable->setItem(row, 6, new QTableWidgetItem(
+            QString("%1/%2").arg(enrolledCount)
+                .arg(capacity.isNull() ? QString("不限") : capacity.toString())));
+        registrationTable->setItem(row, 7, new QTableWidgetItem(status));
     }
 }
+
+int StudentWindow::selectedRegistrationCourse() const
+{
+    const int row = registrationTable->currentRow();
+    if (row < 0 || !registrationTable->item(row, 0)) return 0;
+    return registrationTable->item(row, 0)->text().toInt();
+}
+
+void StudentWindow::onRegisterCourse()
+{
+    const int courseId = selectedRegistrationCourse();
+    if (courseId <= 0) {
+        QMessageBox::warning(this, "选课", "请先选择一门课程");
+        return;
+    }
+
+    // 先修课程和上课时间冲突都在本地用位图检查，不占用服务器
+    PrerequisiteGraph& prerequisites = PrerequisiteGraph::getInstance();
+    const QList<int> missing = prerequisites.missingPrerequisites(m_studentId, courseId);
+    if (!missing.isEmpty()) {
+        QStringList names;
+        for (int id : missing) names << QString("%1 %2").arg(id).arg(prerequisites.courseName(id));
+        QMessageBox::warning(this, "选课失败", "尚未通过先修课程：\n" + names.join("\n"));
+        return;
+    }
+
+    const QStringList conflicts =
+        TimetableIndex::getInstance().checkEnrollment(m_studentId, courseId);
+    if (!conflicts.isEmpty()) {
+        QMessageBox::warning(this, "选课失败", "上课时间冲突：\n" + conflicts.join("\n"));
+        return;
+    }
+
+    switch (db.registerCourse(m_studentId, courseId)) {
+    case Database::RegistrationResult::Registered:
+        QMessageBox::information(this, "选课成功", "选课成功");
+        break;
+    case Database::RegistrationResult::AlreadyEnrolled:
+        QMessageBox::information(this, "选课", "你已经选了这门课程");
+        break;
+    case Database::RegistrationResult::CourseFull:
+        if (QMessageBox::question(this, "课程名额已满",
+                                  "课程名额已满，是否加入候补？有名额释放时将按顺序自动选上。")
+            == QMessageBox::Yes) {
+            switch (WaitlistService::getInstance().join(m_studentId, courseId)) {
+            case Database::WaitlistResult::Joined:
+                QMessageBox::information(this, "候补", "已加入候补");
+                break;
+            case Database::WaitlistResult::AlreadyWaiting:
+                QMessageBox::information(this, "候补", "你已经在候补队列中");
+                break;
+            case Database::WaitlistResult::AlreadyEnrolled:
+                QMessageBox::information(this, "候补", "你已经选了这门课程");
+                break;
+            case Database::WaitlistResult::NotFound:
+            case Database::WaitlistResult::Error:
+                QMessageBox::warning(this, "候补", "加入候补失败，请稍后重试");
+                break;
+            }
+        }
+        break;
+    case Database::RegistrationResult::NotFound:
+        QMessageBox::warning(this, "选课失败", "课程不存在");
+        break;
+    case Database::RegistrationResult::Error:
+        QMessageBox::warning(this, "选课失败", "选课失败，请稍后重试");
+        break;
+    }
+
+    loadRegistrationCourses();
+    loadEnrollments();
+}
+
+void StudentWindow::onDropCourse()
+{
+    const int courseId = selectedRegistrationCourse();
+    if (courseId <= 0) {
+        QMessageBox::warning(this, "退课", "请先选择一门课程");
+        return;
+    }
+
+    // 候补中的课程“退课”即退出候补
+    const int row = registrationTable->currentRow();
+    if (registrationTable->item(row, 7)
+        && registrationTable->item(row, 7)->text().startsWith("候补")) {
+        if (QMessageBox::question(this, "退出候补", "确定要退出这门课程的候补吗？")
+            != QMessageBox::Yes) {
+            return;
+        }
+        if (WaitlistService::getInstance().leave(m_studentId, courseId)) {
+            QMessageBox::information(this, "退出候补", "已退出候补");
+        } else {
+            QMessageBox::warning(this, "退出候补", "不在候补队列中或已被递补选上");
+        }
+        loadRegistrationCourses();
+        loadEnrollments();
+        return;
+    }
+
+    if (QMessageBox::question(this, "退课", "确定要退选这门课程吗？") != QMessageBox::Yes) {
+        return;
+    }
+
+    if (db.dropCourse(m_studentId, courseId)) {
+        QMessageBox::information(this, "退课成功", "已退选该课程");
+    } else {
+        QMessageBox::warning(this, "退课失败", "未选该课程或课程已有成绩，不能退选");
+    }
+
+    loadRegistrationCourses();
+    loadEnrollments();
+}
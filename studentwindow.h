@@ -18,6 +18,8 @@ public:
 
 private slots:
     void onChangePassword();
+    void onRegisterCourse();
+    void onDropCourse();
 
 private:
     void setupUI() override;
@@ -25,6 +27,11 @@ private:
 
     void loadStudentInfo();
     void loadEnrollments();
+    void loadRegistrationCourses();
+    int selectedRegistrationCourse() const;
+
+    void fillStudentInfo(const QList<QMap<QString, QVariant>>& students);
+    void fillEnrollments(const QList<QMap<QString, QVariant>>& enrollments);
 
     int m_studentId;
 
@@ -33,6 +40,8 @@ private:
     QLabel* infoLabel;
     QTableWidget* infoTable;
     QTableWidget* myEnrollmentsTable;
+    QWidget* registrationTab;
+    QTableWidget* registrationTable;
 };
 
 #endif // STUDENTWINDOW_H
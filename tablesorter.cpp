@@ -0,0 +1,233 @@
+#include "tablesorter.h"
+#include <QApplication>
+#include <QHeaderView>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+TableSorter* TableSorter::attach(QTableWidget* table)
+{
+    if (TableSorter* existing = table->findChild<TableSorter*>(QString(), Qt::FindDirectChildrenOnly)) {
+        return existing;
+    }
+    return new TableSorter(table);
+}
+
+TableSorter::TableSorter(QTableWidget* table)
+    : QObject(table)
+    , m_table(table)
+    , m_collator(QLocale(QLocale::Chinese, QLocale::China))
+{
+    // 学期等带数字的文本按数值比较
+    m_collator.setNumericMode(true);
+
+    // 使用自定义排序，不启用 QTableWidget 自带的逐项比较排序
+    table->setSortingEnabled(false);
+    table->horizontalHeader()->setSectionsClickable(true);
+    connect(table->horizontalHeader(), &QHeaderView::sectionClicked, this, &TableSorter::onHeaderClicked);
+
+    QAbstractItemModel* model = table->model();
+    connect(model, &QAbstractItemModel::dataChanged, this, &TableSorter::invalidate);
+    connect(model, &QAbstractItemModel::rowsInserted, this, &TableSorter::invalidate);
+    connect(model, &QAbstractItemModel::rowsRemoved, this, &TableSorter::invalidate);
+    connect(model, &QAbstractItemModel::modelReset, this, &TableSorter::invalidate);
+}
+
+void TableSorter::invalidate()
+{
+    if (m_reordering) return;
+    m_keys.clear();
+    if (!m_columns.isEmpty()) {
+        // 数据重新载入后不再是排序状态
+        m_columns.clear();
+        m_table->horizontalHeader()->setSortIndicatorShown(false);
+    }
+}
+
+void TableSorter::onHeaderClicked(int column)
+{
+    QList<QPair<int, Qt::SortOrder>> columns = m_columns;
+    int existing = -1;
+    for (int i = 0; i < columns.size(); i++) {
+        if (columns[i].first == column) existing = i;
+    }
+
+    if (QApplication::keyboardModifiers() & Qt::ShiftModifier) {
+        // 追加或切换次要排序列
+        if (existing >= 0) {
+            columns[existing].second = columns[existing].second == Qt::AscendingOrder
+                                           ? Qt::DescendingOrder : Qt::AscendingOrder;
+        } else {
+            columns.append(qMakePair(column, Qt::AscendingOrder));
+        }
+    } else {
+        const Qt::SortOrder order = existing == 0 && columns[0].second == Qt::AscendingOrder
+                                        ? Qt::DescendingOrder : Qt::AscendingOrder;
+        columns = {qMakePair(column, order)};
+    }
+    sortBy(columns);
+}
+
+const TableSorter::ColumnKeys& TableSorter::keysFor(int column)
+{
+    auto it = m_keys.constFind(column);
+    if (it != m_keys.constEnd()) return it.value();
+
+    const int rows = m_table->rowCount();
+    ColumnKeys keys;
+    keys.empty.assign(rows, 0);
+
+    // 全部非空值都是整数（或数字）时按数值排序
+    QStringList texts;
+    texts.reserve(rows);
+    bool integers = true, reals = true;
+    for (int row = 0; row < rows; row++) {
+        QTableWidgetItem* item = m_table->item(row, column);
+        const QString text = item ? item->text().trimmed() : QString();
+        texts << text;
+        if (text.isEmpty()) {
+            keys.empty[row] = 1;
+            continue;
+        }
+        bool ok = false;
+        if (integers) {
+            text.toInt(&ok);
+            integers = ok;
+        }
+        if (!integers && reals) {
+            text.toDouble(&ok);
+            reals = ok;
+        }
+    }
+
+    if (integers || reals) {
+        keys.type = integers ? KeyType::Integer : KeyType::Real;
+        keys.numbers.resize(rows, 0);
+        for (int row = 0; row < rows; row++) {
+            if (keys.empty[row]) continue;
+            if (integers) {
+                // 符号位取反后按无符号比较即为有符号顺序
+                keys.numbers[row] = static_cast<quint32>(texts[row].toInt()) ^ 0x80000000u;
+            } else {
+                const double value = texts[row].toDouble();
+                quint64 bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                keys.numbers[row] = (bits & 0x8000000000000000ull) ? ~bits : bits | 0x8000000000000000ull;
+            }
+        }
+    } else {
+        keys.texts.reserve(rows);
+        for (int row = 0; row < rows; row++) {
+            keys.texts.push_back(m_collator.sortKey(texts[row]));
+        }
+    }
+    return m_keys.insert(column, std::move(keys)).value();
+}
+
+void TableSorter::radixSort(std::vector<int>& order, const std::vector<quint64>& keys, int bytes)
+{
+    // LSD 基数排序，每趟8位；每趟按计数分配，保持稳定
+    std::vector<int> buffer(order.size());
+    for (int pass = 0; pass < bytes; pass++) {
+        const int shift = pass * 8;
+        size_t counts[257] = {0};
+        for (int index : order) counts[((keys[index] >> shift) & 0xff) + 1]++;
+        // 这一字节全部相同则跳过
+        if (std::find(counts + 1, counts + 257, order.size()) != counts + 257) continue;
+        for (int i = 0; i < 256; i++) counts[i + 1] += counts[i];
+        for (int index : order) buffer[counts[(keys[index] >> shift) & 0xff]++] = index;
+        order.swap(buffer);
+    }
+}
+
+void TableSorter::sortColumn(std::vector<int>& order, int column, Qt::SortOrder sortOrder)
+{
+    const ColumnKeys& keys = keysFor(column);
+    const bool descending = sortOrder == Qt::DescendingOrder;
+
+    if (keys.type == KeyType::Text) {
+        std::stable_sort(order.begin(), order.end(), [&keys, descending](int a, int b) {
+            const int result = keys.texts[a].compare(keys.texts[b]);
+            return descending ? result > 0 : result < 0;
+        });
+    } else if (descending) {
+        std::vector<quint64> inverted(keys.numbers.size());
+        for (size_t i = 0; i < inverted.size(); i++) inverted[i] = ~keys.numbers[i];
+        radixSort(order, inverted, keys.type == KeyType::Integer ? 4 : 8);
+    } else {
+        radixSort(order, keys.numbers, keys.type == KeyType::Integer ? 4 : 8);
+    }
+
+    std::stable_partition(order.begin(), order.end(), [&keys](int row) { return !keys.empty[row]; });
+}
+
+void TableSorter::sortBy(const QList<QPair<int, Qt::SortOrder>>& columns)
+{
+    if (columns.isEmpty() || (m_guard && !m_guard())) return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 从最次要的列开始逐列稳定排序，结果即多列排序；初始顺序为当前显示顺序
+    std::vector<int> order(m_table->rowCount());
+    for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<int>(i);
+    for (int i = columns.size() - 1; i >= 0; i--) {
+        sortColumn(order, columns[i].first, columns[i].second);
+    }
+    const qint64 sortMs = timer.elapsed();
+
+    applyOrder(order);
+    m_columns = columns;
+    m_table->horizontalHeader()->setSortIndicator(columns[0].first, columns[0].second);
+    m_table->horizontalHeader()->setSortIndicatorShown(true);
+
+    qDebug() << "表格排序:" << order.size() << "行, 排序" << sortMs << "毫秒, 重排"
+             << timer.elapsed() - sortMs << "毫秒";
+}
+
+void TableSorter::applyOrder(const std::vector<int>& order)
+{
+    const int rows = static_cast<int>(order.size());
+    const int columns = m_table->columnCount();
+
+    // 取出全部单元格再按新顺序放回，单元格携带的数据（如行版本）随之移动
+    m_reordering = true;
+    const bool signalsBlocked = m_table->blockSignals(true);
+    m_table->setUpdatesEnabled(false);
+
+    std::vector<QTableWidgetItem*> items(static_cast<size_t>(rows) * columns);
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            items[static_cast<size_t>(row) * columns + column] = m_table->takeItem(row, column);
+        }
+    }
+    for (int row = 0; row < rows; row++) {
+        const size_t source = static_cast<size_t>(order[row]) * columns;
+        for (int column = 0; column < columns; column++) {
+            if (QTableWidgetItem* item = items[source + column]) m_table->setItem(row, column, item);
+        }
+    }
+
+    // 已算好的排序键跟着行一起重排
+    for (auto it = m_keys.begin(); it != m_keys.end(); ++it) {
+        ColumnKeys& keys = it.value();
+        std::vector<char> empty(rows);
+        for (int row = 0; row < rows; row++) empty[row] = keys.empty[order[row]];
+        keys.empty.swap(empty);
+        if (keys.type == KeyType::Text) {
+            std::vector<QCollatorSortKey> texts;
+            texts.reserve(rows);
+            for (int row = 0; row < rows; row++) texts.push_back(keys.texts[order[row]]);
+            keys.texts.swap(texts);
+        } else {
+            std::vector<quint64> numbers(rows);
+            for (int row = 0; row < rows; row++) numbers[row] = keys.numbers[order[row]];
+            keys.numbers.swap(numbers);
+        }
+    }
+
+    m_table->setUpdatesEnabled(true);
+    m_table->blockSignals(signalsBlocked);
+    m_reordering = false;
+}
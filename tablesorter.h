@@ -0,0 +1,59 @@
+#ifndef TABLESORTER_H
+#define TABLESORTER_H
+
+#include <QObject>
+#include <QCollator>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QTableWidget>
+#include <functional>
+#include <vector>
+
+// 表头点击排序：每列第一次排序时为所有行预先算好排序键（整数/小数列为64位可比较键，
+// 文本列为中文排序规则的 QCollatorSortKey），数值列用基数排序，文本列只比较排序键；
+// 每次排序都是稳定的，Shift+点击追加次要排序列。表格内容变化后排序键失效，下次排序重算
+class TableSorter : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 返回表格已有的排序器，没有时创建（作为表格的子对象）
+    static TableSorter* attach(QTableWidget* table);
+
+    // 返回 false 时不排序（例如有按行号暂存的未保存修改）
+    void setGuard(std::function<bool()> guard) { m_guard = std::move(guard); }
+
+    // 按 (列, 顺序) 依次作为主、次要排序列
+    void sortBy(const QList<QPair<int, Qt::SortOrder>>& columns);
+
+private slots:
+    void onHeaderClicked(int column);
+    void invalidate();
+
+private:
+    explicit TableSorter(QTableWidget* table);
+
+    enum class KeyType { Integer, Real, Text };
+
+    struct ColumnKeys {
+        KeyType type = KeyType::Text;
+        std::vector<quint64> numbers;           // 数值列：保序编码后的键
+        std::vector<QCollatorSortKey> texts;    // 文本列
+        std::vector<char> empty;                // 空单元格总是排在最后
+    };
+
+    const ColumnKeys& keysFor(int column);
+    void sortColumn(std::vector<int>& order, int column, Qt::SortOrder sortOrder);
+    static void radixSort(std::vector<int>& order, const std::vector<quint64>& keys, int bytes);
+    void applyOrder(const std::vector<int>& order);
+
+    QTableWidget* m_table;
+    QCollator m_collator;
+    QHash<int, ColumnKeys> m_keys;
+    QList<QPair<int, Qt::SortOrder>> m_columns;
+    std::function<bool()> m_guard;
+    bool m_reordering = false;
+};
+
+#endif // TABLESORTER_H
@@ -1,4 +1,7 @@
 #include "teacherwindow.h"
+#include "statisticswidget.h"
+#include "gradebookwidget.h"
+#include "attendancewidget.h"
 #include <QApplication>
 #include <QMessageBox>
 #include <QVBoxLayout>
@@ -6,7 +9,6 @@
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QHeaderView>
-#include <QSqlQuery>
 
 TeacherWindow::TeacherWindow(const User &user, QWidget *parent)
     : BaseWindow(user, parent)
@@ -86,31 +88,19 @@ void TeacherWindow::setupUI()
 
     tabWidget->addTab(teachingTab, "我的授课");
 
-    // === 学生成绩管理标签页 ===
-    QWidget *studentsTab = new QWidget();
-    QVBoxLayout *studentsLayout = new QVBoxLayout(studentsTab);
+    // === 学生成绩管理标签页（成绩册，按课程打开时加载） ===
+    gradebook = new GradebookWidget();
+    tabWidget->addTab(gradebook, "学生成绩");
 
-    QLabel *studentsLabel = new QLabel("我的学生成绩管理");
-    studentsLabel->setAlignment(Qt::AlignCenter);
-    studentsLabel->setStyleSheet("font-size: 14px; font-weight: bold;");
-    studentsLayout->addWidget(studentsLabel);
+    // === 课堂点名标签页 ===
+    attendance = new AttendanceWidget(m_teacherId);
+    tabWidget->addTab(attendance, "课堂点名");
 
-    studentsTable = new QTableWidget();
-    setupCommonTable(studentsTable, {"学生学号", "学生姓名", "课程名称", "学期", "成绩"});
-    studentsLayout->addWidget(studentsTable);
-
-    // 刷新按钮
-    QHBoxLayout *refreshStudentsLayout = new QHBoxLayout();
-    QPushButton *refreshStudentsButton = new QPushButton("刷新");
-    refreshStudentsLayout->addWidget(refreshStudentsButton);
-    refreshStudentsLayout->addStretch();
-    studentsLayout->addLayout(refreshStudentsLayout);
-
-    tabWidget->addTab(studentsTab, "学生成绩");
+    // === 成绩统计标签页（仅统计本人所授课程） ===
+    tabWidget->addTab(new StatisticsWidget(m_teacherId), "成绩统计");
 
     // === 连接信号槽 ===
     connect(refreshTeachingButton, &QPushButton::clicked, this, &TeacherWindow::loadMyTeachings);
-    connect(refreshStudentsButton, &QPushButton::clicked, this, &TeacherWindow::loadCourseStudents);
 
     // 重要：检查指针不为空再连接
     if (changePasswordButton) {
@@ -138,9 +128,22 @@ void TeacherWindow::onChangePassword()
 
 void TeacherWindow::loadData()
 {
-    loadTeacherInfo();
-    loadMyTeachings();
-    loadCourseStudents();
+    if (m_teacherId <= 0) {
+        QMessageBox::warning(this, "错误", "未找到对应的教师信息");
+        return;
+    }
+
+    // 一次往返取回教师信息和我的授课；学生成绩在成绩册中按课程加载
+    auto resultSets = db.bootstrapTeacher(m_teacherId);
+    if (resultSets.size() != 2) {
+        // 存储过程不可用时退回逐个查询
+        loadTeacherInfo();
+        loadMyTeachings();
+        return;
+    }
+
+    fillTeacherInfo(resultSets[0]);
+    fillMyTeachings(resultSets[1]);
 }
 
 void TeacherWindow::loadTeacherInfo()
@@ -150,9 +153,19 @@ void TeacherWindow::loadTeacherInfo()
         return;
     }
 
-    auto teachers = db.executeSelect("teachers",
-                                     QString("teacher_id = %1").arg(m_teacherId));
+    fillTeacherInfo(db.executeSelect("teachers",
+                                     QString("teacher_id = %1").arg(m_teacherId)));
+}
 
+void TeacherWindow::loadMyTeachings()
+{
+    if (m_teacherId <= 0) return;
+
+    fillMyTeachings(db.getTeacherTeachings(m_teacherId));
+}
+
+void TeacherWindow::fillTeacherInfo(const QList<QMap<QString, QVariant>>& teachers)
+{
     infoTable->setRowCount(teachers.size());
 
     for (int i = 0; i < teachers.size(); i++) {
@@ -163,70 +176,19 @@ void TeacherWindow::loadTeacherInfo()
     }
 }
 
-void TeacherWindow::loadMyTeachings()
+void TeacherWindow::fillMyTeachings(const QList<QMap<QString, QVariant>>& teachings)
 {
-    if (m_teacherId <= 0) return;
-
-    QString sql = QString(
-                      "SELECT t.course_id, c.name as course_name, "
-                      "c.semester, t.class_time, t.classroom "
-                      "FROM teachings t "
-                      "LEFT JOIN courses c ON t.course_id = c.course_id "
-                      "WHERE t.teacher_id = %1 "
-                      "ORDER BY c.semester DESC"
-                      ).arg(m_teacherId);
-
-    QSqlQuery query;
-    query.prepare(sql);
-
-    if (query.exec()) {
-        teachingsTable->setRowCount(0);
-
-        int row = 0;
-        while (query.next()) {
-            teachingsTable->insertRow(row);
-            teachingsTable->setItem(row, 0, new QTableWidgetItem(query.value("course_id").toString()));
-            teachingsTable->setItem(row, 1, new QTableWidgetItem(query.value("course_name").toString()));
-            teachingsTable->setItem(row, 2, new QTableWidgetItem(query.value("semester").toString()));
-            teachingsTable->setItem(row, 3, new QTableWidgetItem(query.value("class_time").toString()));
-            teachingsTable->setItem(row, 4, new QTableWidgetItem(query.value("classroom").toString()));
-            row++;
-        }
+    teachingsTable->setRowCount(teachings.size());
+
+    for (int row = 0; row < teachings.size(); row++) {
+        const auto& teaching = teachings[row];
+        teachingsTable->setItem(row, 0, new QTableWidgetItem(teaching["course_id"].toString()));
+        teachingsTable->setItem(row, 1, new QTableWidgetItem(teaching["course_name"].toString()));
+        teachingsTable->setItem(row, 2, new QTableWidgetItem(teaching["semester"].toString()));
+        teachingsTable->setItem(row, 3, new QTableWidgetItem(teaching["class_time"].toString()));
+        teachingsTable->setItem(row, 4, new QTableWidgetItem(teaching["classroom"].toString()));
     }
-}
 
-void TeacherWindow::loadCourseStudents()
-{
-    if (m_teacherId <= 0) return;
-
-    QString sql = QString(
-                      "SELECT e.student_id, s.name as student_name, "
-                      "c.name as course_name, c.semester, e.score "
-                      "FROM enrollments e "
-                      "LEFT JOIN students s ON e.student_id = s.student_id "
-                      "LEFT JOIN courses c ON e.course_id = c.course_id "
-                      "WHERE e.course_id IN ("
-                      "    SELECT t.course_id FROM teachings t "
-                      "    WHERE t.teacher_id = %1"
-                      ") "
-                      "ORDER BY c.semester DESC, e.course_id"
-                      ).arg(m_teacherId);
-
-    QSqlQuery query;
-    query.prepare(sql);
-
-    if (query.exec()) {
-        studentsTable->setRowCount(0);
-
-        int row = 0;
-        while (query.next()) {
-            studentsTable->insertRow(row);
-            studentsTable->setItem(row, 0, new QTableWidgetItem(query.value("student_id").toString()));
-            studentsTable->setItem(row, 1, new QTableWidgetItem(query.value("student_name").toString()));
-            studentsTable->setItem(row, 2, new QTableWidgetItem(query.value("course_name").toString()));
-            studentsTable->setItem(row, 3, new QTableWidgetItem(query.value("semester").toString()));
-            studentsTable->setItem(row, 4, new QTableWidgetItem(query.value("score").toString()));
-            row++;
-        }
-    }
+    gradebook->setCourses(teachings);
+    attendance->setCourses(teachings);
 }
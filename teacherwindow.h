@@ -8,6 +8,9 @@
 #include <QLineEdit>
 #include <QPushButton>
 
+class GradebookWidget;
+class AttendanceWidget;
+
 class TeacherWindow : public BaseWindow
 {
     Q_OBJECT
@@ -25,7 +28,9 @@ private:
 
     void loadTeacherInfo();
     void loadMyTeachings();
-    void loadCourseStudents();
+
+    void fillTeacherInfo(const QList<QMap<QString, QVariant>>& teachers);
+    void fillMyTeachings(const QList<QMap<QString, QVariant>>& teachings);
 
     int m_teacherId;
 
@@ -34,7 +39,8 @@ private:
     QLabel* infoLabel;
     QTableWidget* infoTable;
     QTableWidget* teachingsTable;
-    QTableWidget* studentsTable;
+    GradebookWidget* gradebook;
+    AttendanceWidget* attendance;
 };
 
 #endif // TEACHERWINDOW_H
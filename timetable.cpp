@@ -0,0 +1,446 @@
+#include "timetable.h"
+#include "database.h"
+#include <QRegularExpression>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QDebug>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+
+const QStringList kDayNames = {"周一", "周二", "周三", "周四", "周五", "周六", "周日"};
+
+int bitIndex(int week, int day, int period)
+{
+    return ((week - 1) * Timetable::kDays + (day - 1)) * Timetable::kPeriods + (period - 1);
+}
+
+int dayFromText(const QString& text)
+{
+    static const QString chineseDays = "一二三四五六日";
+    static const QStringList englishDays = {"mon", "tue", "wed", "thu", "fri", "sat", "sun"};
+
+    if (text == "天") return 7;
+    const int chinese = chineseDays.indexOf(text);
+    if (chinese >= 0) return chinese + 1;
+    const int english = englishDays.indexOf(text.left(3).toLower());
+    if (english >= 0) return english + 1;
+    const int number = text.toInt();
+    return number >= 1 && number <= 7 ? number : 0;
+}
+
+} // namespace
+
+QString TimeSlot::toString() const
+{
+    QString text = QString("%1 第%2-%3节 %4-%5周")
+                       .arg(kDayNames.value(day - 1))
+                       .arg(periodStart).arg(periodEnd)
+                       .arg(weekStart).arg(weekEnd);
+    if (parity == Parity::Odd) text += " 单周";
+    if (parity == Parity::Even) text += " 双周";
+    return text;
+}
+
+QList<TimeSlot> Timetable::parse(const QString& text, bool* ok)
+{
+    static const QRegularExpression dayPattern(
+        "(?:周|星期|礼拜)([一二三四五六日天1-7])|\\b(Mon|Tue|Wed|Thu|Fri|Sat|Sun)[a-z]*",
+        QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression periodPattern(
+        "第?\\s*(\\d{1,2})\\s*(?:[-~～至到]\\s*(\\d{1,2}))?\\s*节");
+    static const QRegularExpression weekPattern(
+        "第?\\s*(\\d{1,2})\\s*(?:[-~～至到]\\s*(\\d{1,2}))?\\s*周");
+
+    QList<TimeSlot> timeSlots;
+    if (ok) *ok = false;
+    if (text.trimmed().isEmpty()) return timeSlots;
+
+    // 每个"星期几"开始一段，直到下一个"星期几"
+    QList<QRegularExpressionMatch> days;
+    auto dayIt = dayPattern.globalMatch(text);
+    while (dayIt.hasNext()) {
+        days.append(dayIt.next());
+    }
+    if (days.isEmpty()) return timeSlots;
+
+    // 写在最后、对所有段都适用的周次，如 "周一1-2节 周三3-4节 1-16周"
+    int defaultWeekStart = 1;
+    int defaultWeekEnd = kWeeks;
+    const QString tail = text.mid(days.last().capturedEnd());
+    auto tailWeek = weekPattern.match(tail);
+    if (tailWeek.hasMatch() && !periodPattern.match(tail.mid(tailWeek.capturedEnd())).hasMatch()) {
+        defaultWeekStart = tailWeek.captured(1).toInt();
+        defaultWeekEnd = tailWeek.captured(2).isEmpty() ? defaultWeekStart
+                                                        : tailWeek.captured(2).toInt();
+    }
+
+    for (int i = 0; i < days.size(); i++) {
+        const int segmentStart = days[i].capturedEnd();
+        const int segmentEnd = i + 1 < days.size() ? days[i + 1].capturedStart() : text.size();
+        const QString segment = text.mid(segmentStart, segmentEnd - segmentStart);
+
+        TimeSlot slot;
+        slot.day = dayFromText(days[i].captured(1).isEmpty() ? days[i].captured(2)
+                                                             : days[i].captured(1));
+
+        auto period = periodPattern.match(segment);
+        if (slot.day == 0 || !period.hasMatch()) return {};
+        slot.periodStart = period.captured(1).toInt();
+        slot.periodEnd = period.captured(2).isEmpty() ? slot.periodStart
+                                                      : period.captured(2).toInt();
+
+        auto week = weekPattern.match(segment, period.capturedEnd());
+        if (week.hasMatch()) {
+            slot.weekStart = week.captured(1).toInt();
+            slot.weekEnd = week.captured(2).isEmpty() ? slot.weekStart : week.captured(2).toInt();
+        } else {
+            slot.weekStart = defaultWeekStart;
+            slot.weekEnd = defaultWeekEnd;
+        }
+        if (segment.contains("单")) slot.parity = TimeSlot::Parity::Odd;
+        if (segment.contains("双")) slot.parity = TimeSlot::Parity::Even;
+
+        if (slot.periodStart < 1 || slot.periodEnd > kPeriods || slot.periodStart > slot.periodEnd ||
+            slot.weekStart < 1 || slot.weekEnd > kWeeks || slot.weekStart > slot.weekEnd) {
+            return {};
+        }
+        timeSlots.append(slot);
+    }
+
+    if (ok) *ok = true;
+    return timeSlots;
+}
+
+QString Timetable::format(const QList<TimeSlot>& timeSlots)
+{
+    QStringList parts;
+    for (const TimeSlot& slot : timeSlots) {
+        parts << slot.toString();
+    }
+    return parts.join("; ");
+}
+
+Timetable::Occupancy Timetable::toOccupancy(const QList<TimeSlot>& timeSlots)
+{
+    Occupancy occupancy;
+    for (const TimeSlot& slot : timeSlots) {
+        for (int week = slot.weekStart; week <= slot.weekEnd; week++) {
+            if (slot.parity == TimeSlot::Parity::Odd && week % 2 == 0) continue;
+            if (slot.parity == TimeSlot::Parity::Even && week % 2 == 1) continue;
+            for (int period = slot.periodStart; period <= slot.periodEnd; period++) {
+                occupancy.set(bitIndex(week, slot.day, period));
+            }
+        }
+    }
+    return occupancy;
+}
+
+QString Timetable::describeOverlap(const Occupancy& a, const Occupancy& b)
+{
+    const Occupancy overlap = a & b;
+    if (overlap.none()) return QString();
+
+    for (size_t bit = 0; bit < overlap.size(); bit++) {
+        if (overlap.test(bit)) {
+            const int index = static_cast<int>(bit);
+            const int period = index % kPeriods + 1;
+            const int day = index / kPeriods % kDays + 1;
+            const int week = index / (kPeriods * kDays) + 1;
+            return QString("第%1周 %2 第%3节").arg(week).arg(kDayNames.value(day - 1)).arg(period);
+        }
+    }
+    return QString();
+}
+
+QString Timetable::normalizeClassroom(const QString& classroom)
+{
+    QString normalized = classroom.simplified().toUpper();
+    normalized.remove(' ');
+    return normalized;
+}
+
+TimetableIndex& TimetableIndex::getInstance()
+{
+    static TimetableIndex instance;
+    return instance;
+}
+
+TimetableIndex::TimetableIndex()
+{
+    Database& db = Database::getInstance();
+    QObject::connect(&db, &Database::enrollmentScoreChanged, &db,
+                     [this](int studentId, int courseId, const QVariant& score) {
+                         onScoreChanged(studentId, courseId, score);
+                     });
+    QObject::connect(&db, &Database::enrollmentDataInvalidated, &db, [this]() { invalidate(); });
+}
+
+void TimetableIndex::invalidate()
+{
+    m_loaded = false;
+    m_teachings.clear();
+    m_unparsed.clear();
+    m_courseNames.clear();
+    m_courseSemesters.clear();
+    m_semesterNames.clear();
+    m_courseOccupancy.clear();
+    m_teacherOccupancy.clear();
+    m_classroomOccupancy.clear();
+    m_studentCourses.clear();
+    m_studentOccupancy.clear();
+}
+
+QString TimetableIndex::courseLabel(int courseId) const
+{
+    return QString("%1(%2)").arg(m_courseNames.value(courseId, "未知课程")).arg(courseId);
+}
+
+QString TimetableIndex::semesterLabel(int semesterId) const
+{
+    return semesterId > 0 ? m_semesterNames.value(semesterId, QString::number(semesterId))
+                          : QString("未分学期");
+}
+
+void TimetableIndex::ensureLoaded()
+{
+    if (m_loaded) return;
+
+    QElapsedTimer timer;
+    timer.start();
+    invalidate();
+
+    QSqlDatabase db = Database::getInstance().connection();
+
+    QSqlQuery courseQuery(db);
+    courseQuery.setForwardOnly(true);
+    if (courseQuery.exec("SELECT course_id, name, IFNULL(semester_id, 0), semester FROM courses")) {
+        while (courseQuery.next()) {
+            const int courseId = courseQuery.value(0).toInt();
+            const int semesterId = courseQuery.value(2).toInt();
+            m_courseNames.insert(courseId, courseQuery.value(1).toString());
+            m_courseSemesters.insert(courseId, semesterId);
+            if (semesterId > 0) m_semesterNames.insert(semesterId, courseQuery.value(3).toString());
+        }
+    }
+
+    QSqlQuery teachingQuery(db);
+    teachingQuery.setForwardOnly(true);
+    if (!teachingQuery.exec("SELECT teacher_id, course_id, class_time, classroom FROM teachings")) {
+        qWarning() << "载入课表失败:" << teachingQuery.lastError().text();
+        return;
+    }
+    while (teachingQuery.next()) {
+        const QString classTime = teachingQuery.value(2).toString();
+        if (classTime.trimmed().isEmpty()) continue;
+
+        bool ok = false;
+        const QList<TimeSlot> timeSlots = Timetable::parse(classTime, &ok);
+        const int courseId = teachingQuery.value(1).toInt();
+        TeachingEntry entry{teachingQuery.value(0).toInt(), courseId, m_courseSemesters.value(courseId),
+                            Timetable::normalizeClassroom(teachingQuery.value(3).toString()),
+                            Timetable::toOccupancy(timeSlots)};
+        if (!ok) {
+            m_unparsed << QString("%1 教师%2：%3").arg(courseLabel(entry.courseId))
+                              .arg(entry.teacherId).arg(classTime);
+            continue;
+        }
+
+        m_courseOccupancy[entry.courseId] |= entry.occupancy;
+        m_teacherOccupancy[semesterKey(entry.semesterId, entry.teacherId)] |= entry.occupancy;
+        if (!entry.classroom.isEmpty()) {
+            m_classroomOccupancy[{entry.semesterId, entry.classroom}] |= entry.occupancy;
+        }
+        m_teachings.append(entry);
+    }
+
+    QSqlQuery enrollmentQuery(db);
+    enrollmentQuery.setForwardOnly(true);
+    if (!enrollmentQuery.exec("SELECT student_id, course_id FROM enrollments")) {
+        qWarning() << "载入选课失败:" << enrollmentQuery.lastError().text();
+        return;
+    }
+    while (enrollmentQuery.next()) {
+        const int studentId = enrollmentQuery.value(0).toInt();
+        const int courseId = enrollmentQuery.value(1).toInt();
+        m_studentCourses[studentId].append(courseId);
+        m_studentOccupancy[semesterKey(m_courseSemesters.value(courseId), studentId)]
+            |= m_courseOccupancy.value(courseId);
+    }
+
+    m_loaded = true;
+    qDebug() << "课表索引已载入: 授课" << m_teachings.size() << "学生" << m_studentCourses.size()
+             << "无法解析" << m_unparsed.size() << "耗时" << timer.elapsed() << "毫秒";
+}
+
+void TimetableIndex::onScoreChanged(int studentId, int courseId, const QVariant& score)
+{
+    if (!m_loaded) return;
+
+    QList<int>& courses = m_studentCourses[studentId];
+    const bool removed = !score.isValid();
+    if (removed) {
+        courses.removeAll(courseId);
+    } else if (!courses.contains(courseId)) {
+        courses.append(courseId);
+    } else {
+        return;  // 仅成绩变化，课表不变
+    }
+
+    // 学生在该学期的占用位图由同学期所选课程重新合并，退课时不能简单清位（可能与其他课程共用时段）
+    const int semesterId = m_courseSemesters.value(courseId);
+    Timetable::Occupancy occupancy;
+    for (int id : courses) {
+        if (m_courseSemesters.value(id) == semesterId) {
+            occupancy |= m_courseOccupancy.value(id);
+        }
+    }
+    m_studentOccupancy[semesterKey(semesterId, studentId)] = occupancy;
+}
+
+QStringList TimetableIndex::checkTeaching(int teacherId, int courseId, const QString& classTime,
+                                          const QString& classroom)
+{
+    ensureLoaded();
+
+    QStringList conflicts;
+    bool ok = false;
+    const Timetable::Occupancy occupancy = Timetable::toOccupancy(Timetable::parse(classTime, &ok));
+    if (!ok) {
+        conflicts << QString("上课时间无法识别：%1").arg(classTime);
+        return conflicts;
+    }
+
+    // 先用同学期的整体位图做一次与运算，只有重叠时才逐条找出冲突的授课
+    const int semesterId = m_courseSemesters.value(courseId);
+    const QString room = Timetable::normalizeClassroom(classroom);
+    const bool teacherBusy =
+        (m_teacherOccupancy.value(semesterKey(semesterId, teacherId)) & occupancy).any();
+    const bool roomBusy = !room.isEmpty()
+        && (m_classroomOccupancy.value({semesterId, room}) & occupancy).any();
+    if (!teacherBusy && !roomBusy) return conflicts;
+
+    for (const TeachingEntry& entry : m_teachings) {
+        if (entry.semesterId != semesterId) continue;
+        if (entry.courseId == courseId && entry.teacherId == teacherId) continue;
+        const QString when = Timetable::describeOverlap(entry.occupancy, occupancy);
+        if (when.isEmpty()) continue;
+
+        if (teacherBusy && entry.teacherId == teacherId) {
+            conflicts << QString("教师已有课程 %1（%2）").arg(courseLabel(entry.courseId), when);
+        } else if (roomBusy && entry.classroom == room) {
+            conflicts << QString("教室 %1 已被课程 %2 占用（%3）")
+                             .arg(classroom, courseLabel(entry.courseId), when);
+        }
+    }
+    return conflicts;
+}
+
+QStringList TimetableIndex::checkEnrollment(int studentId, int courseId)
+{
+    ensureLoaded();
+
+    QStringList conflicts;
+    const int semesterId = m_courseSemesters.value(courseId);
+    const Timetable::Occupancy course = m_courseOccupancy.value(courseId);
+    if ((m_studentOccupancy.value(semesterKey(semesterId, studentId)) & course).none()) return conflicts;
+
+    for (int enrolledId : m_studentCourses.value(studentId)) {
+        if (enrolledId == courseId || m_courseSemesters.value(enrolledId) != semesterId) continue;
+        const QString when = Timetable::describeOverlap(m_courseOccupancy.value(enrolledId), course);
+        if (!when.isEmpty()) {
+            conflicts << QString("与已选课程 %1 时间冲突（%2）").arg(courseLabel(enrolledId), when);
+        }
+    }
+    return conflicts;
+}
+
+QList<TimetableIndex::Conflict> TimetableIndex::conflictReport()
+{
+    ensureLoaded();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 按 学期×教师、学期×教室、学期×学生 分组，每组内部两两按位与
+    struct Group {
+        QString kind;
+        QString owner;
+        QList<QPair<QString, Timetable::Occupancy>> items;
+    };
+    QList<Group> groups;
+
+    QHash<quint64, int> teacherGroup;
+    QHash<QPair<int, QString>, int> classroomGroup;
+    for (const TeachingEntry& entry : m_teachings) {
+        const QString label = courseLabel(entry.courseId);
+        const QString semester = semesterLabel(entry.semesterId);
+        const quint64 teacherKey = semesterKey(entry.semesterId, entry.teacherId);
+        if (!teacherGroup.contains(teacherKey)) {
+            teacherGroup.insert(teacherKey, groups.size());
+            groups.append({"教师", QString("%1（%2）").arg(entry.teacherId).arg(semester), {}});
+        }
+        groups[teacherGroup[teacherKey]].items.append({label, entry.occupancy});
+
+        if (entry.classroom.isEmpty()) continue;
+        const QPair<int, QString> roomKey{entry.semesterId, entry.classroom};
+        if (!classroomGroup.contains(roomKey)) {
+            classroomGroup.insert(roomKey, groups.size());
+            groups.append({"教室", QString("%1（%2）").arg(entry.classroom, semester), {}});
+        }
+        groups[classroomGroup[roomKey]].items.append(
+            {QString("%1 教师%2").arg(label).arg(entry.teacherId), entry.occupancy});
+    }
+
+    for (auto it = m_studentCourses.cbegin(); it != m_studentCourses.cend(); ++it) {
+        if (it.value().size() < 2) continue;
+        QMap<int, QList<int>> bySemester;
+        for (int courseId : it.value()) {
+            bySemester[m_courseSemesters.value(courseId)].append(courseId);
+        }
+        for (auto semester = bySemester.cbegin(); semester != bySemester.cend(); ++semester) {
+            if (semester.value().size() < 2) continue;
+            Group group{"学生", QString("%1（%2）").arg(it.key()).arg(semesterLabel(semester.key())), {}};
+            for (int courseId : semester.value()) {
+                group.items.append({courseLabel(courseId), m_courseOccupancy.value(courseId)});
+            }
+            groups.append(group);
+        }
+    }
+
+    const QList<QList<Conflict>> partial = QtConcurrent::blockingMapped(
+        groups, [](const Group& group) {
+            QList<Conflict> conflicts;
+            Timetable::Occupancy seen;
+            for (int i = 0; i < group.items.size(); i++) {
+                // 与之前所有项的并集不重叠时可以跳过逐对比较
+                if ((seen & group.items[i].second).any()) {
+                    for (int j = 0; j < i; j++) {
+                        const QString when = Timetable::describeOverlap(group.items[j].second,
+                                                                        group.items[i].second);
+                        if (!when.isEmpty()) {
+                            conflicts.append({group.kind, group.owner, group.items[j].first,
+                                              group.items[i].first, when});
+                        }
+                    }
+                }
+                seen |= group.items[i].second;
+            }
+            return conflicts;
+        });
+
+    QList<Conflict> report;
+    for (const QString& unparsed : m_unparsed) {
+        report.append({"无法解析", QString(), unparsed, QString(), QString()});
+    }
+    for (const QList<Conflict>& conflicts : partial) {
+        report.append(conflicts);
+    }
+
+    qDebug() << "课表冲突检查:" << groups.size() << "组," << report.size() << "项, 耗时"
+             << timer.elapsed() << "毫秒";
+    return report;
+}
@@ -0,0 +1,108 @@
+#ifndef TIMETABLE_H
+#define TIMETABLE_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <bitset>
+
+// 课表时间段：某个星期几的连续节次，在一段教学周内（可限单/双周）
+struct TimeSlot {
+    enum class Parity { All, Odd, Even };
+
+    int day = 1;            // 1-7，周一到周日
+    int periodStart = 1;    // 1-kPeriods
+    int periodEnd = 1;
+    int weekStart = 1;      // 1-kWeeks
+    int weekEnd = 1;
+    Parity parity = Parity::All;
+
+    QString toString() const;
+};
+
+// 教师/教室/学生/课程的周课表占用位图：周 × 星期 × 节次 各占1位，
+// 冲突检查即两个位图按位与
+class Timetable
+{
+public:
+    static constexpr int kWeeks = 20;
+    static constexpr int kDays = 7;
+    static constexpr int kPeriods = 12;
+    using Occupancy = std::bitset<kWeeks * kDays * kPeriods>;
+
+    // 解析 teachings.class_time 自由文本，如 "周一 1-2节 1-16周; 周三3-4节(单周)"
+    // 没有周次时视为整个学期；无法识别时返回空列表并置 ok=false
+    static QList<TimeSlot> parse(const QString& text, bool* ok = nullptr);
+    static QString format(const QList<TimeSlot>& timeSlots);
+    static Occupancy toOccupancy(const QList<TimeSlot>& timeSlots);
+    // 两个占用位图第一个重叠的时间，如 "第3周 周一 第2节"；无重叠时返回空字符串
+    static QString describeOverlap(const Occupancy& a, const Occupancy& b);
+    static QString normalizeClassroom(const QString& classroom);
+};
+
+// 全库课表占用索引：首次使用时从授课/选课表载入，之后随选课变化增量维护。
+// 教师、教室、学生的占用按课程所属学期分开，不同学期的课程不算冲突
+class TimetableIndex
+{
+public:
+    static TimetableIndex& getInstance();
+
+    struct Conflict {
+        QString kind;       // 教师 / 教室 / 学生 / 无法解析
+        QString owner;      // 冲突所属的教师、教室或学生
+        QString first;
+        QString second;
+        QString when;
+    };
+
+    // 新增授课或选课前的检查，只与同一学期的课程比较，返回冲突说明（为空表示无冲突）
+    QStringList checkTeaching(int teacherId, int courseId, const QString& classTime,
+                              const QString& classroom);
+    QStringList checkEnrollment(int studentId, int courseId);
+
+    // 全库冲突报告：教师、教室、学生分别并行检查
+    QList<Conflict> conflictReport();
+
+    void invalidate();
+
+private:
+    TimetableIndex();
+    TimetableIndex(const TimetableIndex&) = delete;
+    TimetableIndex& operator=(const TimetableIndex&) = delete;
+
+    struct TeachingEntry {
+        int teacherId;
+        int courseId;
+        int semesterId;
+        QString classroom;
+        Timetable::Occupancy occupancy;
+    };
+
+    // 教师/学生按学期的占用键：学期ID在高32位
+    static quint64 semesterKey(int semesterId, int id)
+    {
+        return (quint64(quint32(semesterId)) << 32) | quint32(id);
+    }
+
+    void ensureLoaded();
+    void onScoreChanged(int studentId, int courseId, const QVariant& score);
+    QString courseLabel(int courseId) const;
+    QString semesterLabel(int semesterId) const;
+
+    QList<TeachingEntry> m_teachings;
+    QStringList m_unparsed;                                 // 无法解析的上课时间
+    QHash<int, QString> m_courseNames;
+    QHash<int, int> m_courseSemesters;                      // 课程 → 学期ID，未归入学期为0
+    QHash<int, QString> m_semesterNames;
+    QHash<int, Timetable::Occupancy> m_courseOccupancy;     // 课程所有授课时间的并集
+    QHash<quint64, Timetable::Occupancy> m_teacherOccupancy;
+    QHash<QPair<int, QString>, Timetable::Occupancy> m_classroomOccupancy;   // (学期, 教室)
+    QHash<int, QList<int>> m_studentCourses;                // 各学期的选课都在内
+    QHash<quint64, Timetable::Occupancy> m_studentOccupancy;
+    bool m_loaded = false;
+};
+
+#endif // TIMETABLE_H
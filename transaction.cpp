@@ -0,0 +1,216 @@
+#include "transaction.h"
+#include <QSqlQuery>
+#include <QDebug>
+
+namespace {
+
+// 连接按线程分配，事务嵌套深度和待发通知也按线程记录
+struct ThreadTransactions {
+    int depth = 0;
+    QList<std::function<void()>> pending;
+};
+thread_local ThreadTransactions t_transactions;
+
+} // namespace
+
+Transaction::Transaction()
+    : m_db(Database::getInstance().connection())
+{
+    ThreadTransactions& state = t_transactions;
+    m_level = state.depth + 1;
+    m_pendingMark = state.pending.size();
+
+    if (m_level == 1) {
+        m_active = m_db.transaction();
+        if (!m_active) m_error = m_db.lastError();
+    } else {
+        m_active = execSavepoint(QString("SAVEPOINT sp_%1").arg(m_level));
+    }
+    if (!m_active) {
+        qWarning() << "开启事务失败:" << m_error.text();
+        return;
+    }
+
+    state.depth = m_level;
+    if (m_level > 1) {
+        Database::getInstance().countTransaction(Database::TransactionEvent::Savepoint);
+    }
+}
+
+Transaction::~Transaction()
+{
+    if (m_active) rollback();
+}
+
+bool Transaction::inTransaction()
+{
+    return t_transactions.depth > 0;
+}
+
+bool Transaction::deferUntilCommit(std::function<void()> notify)
+{
+    ThreadTransactions& state = t_transactions;
+    if (state.depth == 0) return false;
+    state.pending.append(std::move(notify));
+    return true;
+}
+
+bool Transaction::execSavepoint(const QString& statement)
+{
+    QSqlQuery query(m_db);
+    if (query.exec(statement)) return true;
+    m_error = query.lastError();
+    qWarning() << "保存点操作失败:" << statement << m_error.text();
+    return false;
+}
+
+bool Transaction::commit()
+{
+    if (!m_active) return false;
+
+    ThreadTransactions& state = t_transactions;
+    Q_ASSERT(state.depth == m_level);
+
+    // 内层只释放保存点，写入随最外层一起提交
+    if (m_level > 1) {
+        if (!execSavepoint(QString("RELEASE SAVEPOINT sp_%1").arg(m_level))) {
+            rollback();
+            return false;
+        }
+        m_active = false;
+        state.depth = m_level - 1;
+        return true;
+    }
+
+    m_active = false;
+    state.depth = 0;
+    Database& database = Database::getInstance();
+    if (!m_db.commit()) {
+        m_error = m_db.lastError();
+        qWarning() << "提交事务失败:" << m_error.text();
+        m_db.rollback();
+        state.pending.clear();
+        database.countTransaction(Database::TransactionEvent::Rollback);
+        return false;
+    }
+    database.countTransaction(Database::TransactionEvent::Commit);
+
+    // 通知中可能再开启事务，先取出再执行
+    const QList<std::function<void()>> pending = std::move(state.pending);
+    state.pending.clear();
+    database.invalidateReadCache();
+    for (const auto& notify : pending) {
+        notify();
+    }
+    return true;
+}
+
+void Transaction::rollback()
+{
+    if (!m_active) return;
+    m_active = false;
+
+    ThreadTransactions& state = t_transactions;
+    Q_ASSERT(state.depth == m_level);
+    state.depth = m_level - 1;
+    // 撤销的写入产生的通知一并丢弃
+    state.pending.resize(m_pendingMark);
+
+    if (m_level > 1) {
+        const QString name = QString("sp_%1").arg(m_level);
+        if (execSavepoint("ROLLBACK TO SAVEPOINT " + name)) {
+            execSavepoint("RELEASE SAVEPOINT " + name);
+        }
+        return;
+    }
+
+    if (!m_db.rollback()) {
+        qWarning() << "回滚事务失败:" << m_db.lastError().text();
+    }
+    Database::getInstance().countTransaction(Database::TransactionEvent::Rollback);
+}
+
+int UnitOfWork::add(Write write)
+{
+    m_writes.append(std::move(write));
+    return m_writes.size() - 1;
+}
+
+int UnitOfWork::insert(const QString& table, const QVariantMap& data)
+{
+    Write write;
+    write.kind = Kind::Insert;
+    write.table = table;
+    write.data = data;
+    return add(write);
+}
+
+int UnitOfWork::update(const QString& table, int id, const QVariantMap& data)
+{
+    Write write;
+    write.kind = Kind::Update;
+    write.table = table;
+    write.id = id;
+    write.data = data;
+    return add(write);
+}
+
+int UnitOfWork::update(const QString& table, int id, const QVariantMap& data, int expectedVersion)
+{
+    Write write;
+    write.kind = Kind::VersionedUpdate;
+    write.table = table;
+    write.id = id;
+    write.data = data;
+    write.expectedVersion = expectedVersion;
+    return add(write);
+}
+
+int UnitOfWork::remove(const QString& table, int id)
+{
+    Write write;
+    write.kind = Kind::Delete;
+    write.table = table;
+    write.id = id;
+    return add(write);
+}
+
+bool UnitOfWork::commit()
+{
+    Database& database = Database::getInstance();
+    bool ok = m_transaction.isActive();
+    for (Write& write : m_writes) {
+        if (!ok) break;
+
+        switch (write.kind) {
+        case Kind::Insert:
+            ok = database.executeInsert(write.table, write.data);
+            write.result = ok ? Database::UpdateResult::Success : Database::UpdateResult::Error;
+            break;
+        case Kind::Update:
+            ok = database.executeUpdate(write.table, write.id, write.data);
+            write.result = ok ? Database::UpdateResult::Success : Database::UpdateResult::Error;
+            break;
+        case Kind::VersionedUpdate:
+            write.result = database.executeUpdate(write.table, write.id, write.data,
+                                                  write.expectedVersion, &write.newVersion);
+            ok = write.result != Database::UpdateResult::Error;
+            break;
+        case Kind::Delete:
+            ok = database.executeDelete(write.table, write.id);
+            write.result = ok ? Database::UpdateResult::Success : Database::UpdateResult::Error;
+            break;
+        }
+        if (!ok) {
+            qWarning() << "工作单元写入失败:" << write.table << write.id;
+        }
+    }
+
+    if (ok && m_transaction.commit()) return true;
+
+    m_transaction.rollback();
+    for (Write& write : m_writes) {
+        write.result = Database::UpdateResult::Error;
+    }
+    return false;
+}
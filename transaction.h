@@ -0,0 +1,84 @@
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#include "database.h"
+#include <QList>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <functional>
+
+// 作用域事务：在当前线程的连接上开启，析构时若未提交则回滚。
+// 可以嵌套：最外层使用真正的事务，内层使用保存点，内层回滚只撤销自己的部分。
+// 事务内通过 Database 写入产生的通知（recordChanged 等）推迟到最外层提交后发出，回滚时丢弃。
+// 同一线程内的事务必须按作用域先进后出，不能跨线程使用
+class Transaction
+{
+public:
+    Transaction();
+    ~Transaction();
+
+    // 开启失败（连接不可用等）时为 false，此时 commit() 直接返回 false
+    bool isActive() const { return m_active; }
+    bool isNested() const { return m_level > 1; }
+    bool commit();
+    void rollback();
+    QSqlError lastError() const { return m_error; }
+
+    // 当前线程是否处于事务中
+    static bool inTransaction();
+    // 当前线程处于事务中时把 notify 排到最外层提交之后并返回 true，否则返回 false 由调用方立即执行
+    static bool deferUntilCommit(std::function<void()> notify);
+
+private:
+    Transaction(const Transaction&) = delete;
+    Transaction& operator=(const Transaction&) = delete;
+
+    bool execSavepoint(const QString& statement);
+
+    QSqlDatabase m_db;
+    int m_level = 0;            // 1为最外层，>1为保存点
+    int m_pendingMark = 0;      // 开启时已排队的通知数，内层回滚时截断到这里
+    bool m_active = false;
+    QSqlError m_error;
+};
+
+// 工作单元：构造时开启事务，之后的检查查询与写入处在同一事务中。
+// 写入先登记，commit() 时按登记顺序执行，只提交一次；任一写入出错整体回滚。
+// 带版本检查的更新遇到冲突不算出错，结果见 result()
+class UnitOfWork
+{
+public:
+    UnitOfWork() = default;
+
+    // 均返回该写入的序号，用于提交后查询结果
+    int insert(const QString& table, const QVariantMap& data);
+    int update(const QString& table, int id, const QVariantMap& data);
+    int update(const QString& table, int id, const QVariantMap& data, int expectedVersion);
+    int remove(const QString& table, int id);
+
+    int size() const { return m_writes.size(); }
+    bool commit();
+    // 提交后各写入的结果；提交失败时全部为 Error
+    Database::UpdateResult result(int index) const { return m_writes[index].result; }
+    // 带版本检查的更新成功后的新版本
+    int newVersion(int index) const { return m_writes[index].newVersion; }
+
+private:
+    enum class Kind { Insert, Update, VersionedUpdate, Delete };
+    struct Write {
+        Kind kind;
+        QString table;
+        int id = 0;
+        QVariantMap data;
+        int expectedVersion = 0;
+        Database::UpdateResult result = Database::UpdateResult::Error;
+        int newVersion = 0;
+    };
+
+    int add(Write write);
+
+    Transaction m_transaction;
+    QList<Write> m_writes;
+};
+
+#endif // TRANSACTION_H
@@ -0,0 +1,218 @@
+#include "waitlist.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QDebug>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+
+WaitlistService& WaitlistService::getInstance()
+{
+    static WaitlistService instance;
+    return instance;
+}
+
+WaitlistService::WaitlistService()
+{
+    Database& db = Database::getInstance();
+    // 有意不排队：递补在释放名额的线程里直接完成（负载测试的工作线程没有事件循环），
+    // 因此全部成员都由 m_mutex 保护
+    QObject::connect(&db, &Database::seatsReleased, [this](int courseId) { promote(courseId); });
+    QObject::connect(&db, &Database::enrollmentDataInvalidated, [this]() { invalidate(); });
+}
+
+void WaitlistService::invalidate()
+{
+    QMutexLocker locker(&m_mutex);
+    m_queues.clear();
+}
+
+void WaitlistService::reload(int courseId)
+{
+    Queue queue;
+    QSqlQuery query(Database::getInstance().connection());
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, student_id, priority, requested_at FROM waitlist WHERE course_id = ?");
+    query.addBindValue(courseId);
+    if (!query.exec()) {
+        qWarning() << "载入候补队列失败:" << query.lastError().text();
+        QMutexLocker locker(&m_mutex);
+        m_queues.remove(courseId);
+        return;
+    }
+    while (query.next()) {
+        queue.insert(Entry{query.value(2).toInt(),
+                           query.value(3).toDateTime().toMSecsSinceEpoch(),
+                           query.value(0).toLongLong(),
+                           query.value(1).toInt()});
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_queues.insert(courseId, std::move(queue));
+}
+
+const WaitlistService::Queue& WaitlistService::queueLocked(int courseId)
+{
+    auto it = m_queues.find(courseId);
+    if (it != m_queues.end()) return it.value();
+
+    // 查询期间不持锁，其他线程可能同时载入同一课程，结果相同
+    m_mutex.unlock();
+    reload(courseId);
+    m_mutex.lock();
+    // 载入失败时不留下空队列，以免被当成"没有候补"
+    static const Queue empty;
+    it = m_queues.find(courseId);
+    return it != m_queues.end() ? it.value() : empty;
+}
+
+Database::WaitlistResult WaitlistService::join(int studentId, int courseId)
+{
+    const Database::WaitlistResult result = Database::getInstance().joinWaitlist(studentId, courseId);
+    if (result == Database::WaitlistResult::Joined) {
+        reload(courseId);
+        promote(courseId);
+    }
+    return result;
+}
+
+bool WaitlistService::leave(int studentId, int courseId)
+{
+    if (!Database::getInstance().leaveWaitlist(studentId, courseId)) return false;
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_queues.find(courseId);
+    if (it != m_queues.end()) {
+        Queue& queue = it.value();
+        for (auto entry = queue.begin(); entry != queue.end(); ++entry) {
+            if (entry->studentId == studentId) {
+                queue.erase(entry);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+int WaitlistService::position(int studentId, int courseId)
+{
+    QMutexLocker locker(&m_mutex);
+    const Queue& queue = queueLocked(courseId);
+    int rank = 1;
+    for (const Entry& entry : queue) {
+        if (entry.studentId == studentId) return rank;
+        rank++;
+    }
+    return 0;
+}
+
+int WaitlistService::waitingCount(int courseId)
+{
+    QMutexLocker locker(&m_mutex);
+    return static_cast<int>(queueLocked(courseId).size());
+}
+
+int WaitlistService::promote(int courseId)
+{
+    {
+        // 内存队列只是镜像，可能落后于其他客户端的加入，是否有候补一律以数据库为准
+        QMutexLocker locker(&m_mutex);
+        if (m_promoting.contains(courseId)) {
+            m_pending.insert(courseId);
+            return 0;
+        }
+        m_promoting.insert(courseId);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int total = 0;
+    int transactions = 0;
+    int failures = 0;
+    for (;;) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_pending.remove(courseId);
+        }
+        QList<int> promoted;
+        const int count = Database::getInstance().promoteWaitlist(courseId, kBatchSize, &promoted);
+        if (count < 0) {
+            if (++failures < kRetryAttempts) {
+                QThread::msleep(kRetryDelayMs * failures);
+                continue;
+            }
+            // 仍然失败时不能等到下一次名额释放，交给主线程事件循环稍后再试
+            {
+                QMutexLocker locker(&m_mutex);
+                m_promoting.remove(courseId);
+            }
+            qWarning() << "候补递补失败，稍后重试: 课程" << courseId;
+            QTimer::singleShot(kRescheduleMs, &Database::getInstance(), [this, courseId]() {
+                promote(courseId);
+            });
+            break;
+        }
+        failures = 0;
+        if (count > 0) {
+            total += count;
+            transactions++;
+        }
+
+        QMutexLocker locker(&m_mutex);
+        auto it = m_queues.find(courseId);
+        if (it != m_queues.end() && !promoted.isEmpty()) {
+            Queue& queue = it.value();
+            for (auto entry = queue.begin(); entry != queue.end();) {
+                entry = promoted.contains(entry->studentId) ? queue.erase(entry) : std::next(entry);
+            }
+        }
+        // 整批用满说明可能还有名额；递补期间又释放的名额也在这里接着处理
+        if (count < kBatchSize && !m_pending.contains(courseId)) {
+            m_promoting.remove(courseId);
+            break;
+        }
+    }
+
+    if (total > 0) {
+        const qint64 us = timer.nsecsElapsed() / 1000;
+        recordLatency(us, total);
+        qDebug() << "候补递补: 课程" << courseId << "人数" << total
+                 << "事务" << transactions << "耗时" << us << "微秒";
+    }
+    return total;
+}
+
+void WaitlistService::recordLatency(qint64 us, int students)
+{
+    QMutexLocker locker(&m_mutex);
+    if (static_cast<int>(m_latencyUs.size()) < kLatencySamples) {
+        m_latencyUs.push_back(us);
+    } else {
+        m_latencyUs[m_latencyNext] = us;
+        m_latencyNext = (m_latencyNext + 1) % kLatencySamples;
+    }
+    m_promotions++;
+    m_promotedStudents += students;
+}
+
+WaitlistService::LatencyStats WaitlistService::latencyStats() const
+{
+    std::vector<qint64> samples;
+    LatencyStats stats;
+    {
+        QMutexLocker locker(&m_mutex);
+        samples = m_latencyUs;
+        stats.promotions = m_promotions;
+        stats.promotedStudents = m_promotedStudents;
+    }
+    if (samples.empty()) return stats;
+
+    std::sort(samples.begin(), samples.end());
+    const size_t last = samples.size() - 1;
+    stats.p50Us = samples[last / 2];
+    stats.p95Us = samples[last * 95 / 100];
+    stats.maxUs = samples.back();
+    return stats;
+}
@@ -0,0 +1,83 @@
+#ifndef WAITLIST_H
+#define WAITLIST_H
+
+#include "database.h"
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <set>
+#include <vector>
+
+// 候补服务：数据库 waitlist 表是唯一的权威数据，这里按课程保存一份有序镜像用于查询名次；
+// 名额释放（退课、扩容）时自动整批递补，同一课程的并发释放合并为一次递补循环
+class WaitlistService
+{
+public:
+    static WaitlistService& getInstance();
+
+    static constexpr int kBatchSize = 50;       // 每个事务最多递补的人数
+
+    struct LatencyStats {
+        int promotions = 0;         // 成功递补的事务数
+        int promotedStudents = 0;
+        qint64 p50Us = 0;           // 名额释放到递补提交的延迟
+        qint64 p95Us = 0;
+        qint64 maxUs = 0;
+    };
+
+    // 加入后立即尝试递补一次，避免在排队前刚好有名额释放而错过
+    Database::WaitlistResult join(int studentId, int courseId);
+    bool leave(int studentId, int courseId);
+
+    int position(int studentId, int courseId);      // 从1开始，不在候补中返回0
+    int waitingCount(int courseId);
+
+    // 按空余名额递补，返回本次递补人数；该课程正在递补时只做标记，由正在运行的循环接着处理。
+    // 递补失败（锁等待超时等）时稍等重试，仍失败则由主线程稍后再递补
+    int promote(int courseId);
+
+    LatencyStats latencyStats() const;
+    void invalidate();
+
+private:
+    WaitlistService();
+    WaitlistService(const WaitlistService&) = delete;
+    WaitlistService& operator=(const WaitlistService&) = delete;
+
+    // 与 idx_waitlist_order 同序：优先级 → 申请时间 → 自增ID
+    struct Entry {
+        int priority;
+        qint64 requestedAtMs;
+        qint64 id;
+        int studentId;
+        bool operator<(const Entry& other) const
+        {
+            if (priority != other.priority) return priority < other.priority;
+            if (requestedAtMs != other.requestedAtMs) return requestedAtMs < other.requestedAtMs;
+            return id < other.id;
+        }
+    };
+
+    using Queue = std::set<Entry>;
+
+    const Queue& queueLocked(int courseId);             // 调用方持有 m_mutex
+    void reload(int courseId);
+    void recordLatency(qint64 us, int students);
+
+    mutable QMutex m_mutex;
+    QHash<int, Queue> m_queues;                         // 按需载入
+    QSet<int> m_promoting;                              // 正在递补的课程
+    QSet<int> m_pending;                                // 递补期间又有名额释放的课程
+
+    static constexpr int kRetryAttempts = 3;
+    static constexpr int kRetryDelayMs = 50;            // 按次数递增
+    static constexpr int kRescheduleMs = 5000;
+
+    static constexpr int kLatencySamples = 1024;
+    std::vector<qint64> m_latencyUs;                    // 环形缓冲
+    int m_latencyNext = 0;
+    int m_promotions = 0;
+    int m_promotedStudents = 0;
+};
+
+#endif // WAITLIST_H